@@ -0,0 +1,475 @@
+/**
+ * This file is part of the Zeppelin music player project.
+ * Copyright (c) 2013-2014 Zoltan Kovacs, Lajos Santa
+ * See http://zeppelin-player.com for more details.
+ */
+
+#include <codec/codecmanager.h>
+#include <codec/basecodec.h>
+#include <codec/sampleconverter.h>
+#include <filter/volume.h>
+#include <filter/resample.h>
+#include <filter/polyphase.h>
+#include <output/formatconverter.h>
+#include <config/config.h>
+
+#include <boost/program_options.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <vector>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#ifdef HAVE_MP3
+#include <mpg123.h>
+#include <codec/mp3.h>
+#endif
+
+#ifdef HAVE_FLAC
+#include <codec/flac.h>
+#endif
+
+#ifdef HAVE_OGG
+#include <codec/vorbis.h>
+#endif
+
+#ifdef HAVE_WAVPACK
+#include <codec/wavpack.h>
+#endif
+
+#ifdef HAVE_MONKEYSAUDIO
+#include <codec/mac.h>
+#endif
+
+// number of frames processed at once, it matches the decoding round of the player
+static const size_t s_frames = 8192;
+
+static std::string s_signals;
+static std::string s_output;
+static unsigned s_seconds = 60;
+static unsigned s_repeat = 3;
+
+// number of allocations made through operator new since the start of the program
+static std::atomic<size_t> s_allocations(0);
+
+// =====================================================================================================================
+void* operator new(size_t size)
+{
+    ++s_allocations;
+
+    void* p = malloc(size ? size : 1);
+
+    if (!p)
+	throw std::bad_alloc();
+
+    return p;
+}
+
+// =====================================================================================================================
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+/**
+ * Result of the best run of a benchmark.
+ */
+struct Result
+{
+    Result()
+	: m_rate(0), m_channels(0), m_frames(0), m_seconds(0.0), m_allocations(0)
+    {}
+
+    int m_rate;
+    int m_channels;
+    // number of processed input frames
+    size_t m_frames;
+    // wall clock time of the processing
+    double m_seconds;
+    size_t m_allocations;
+};
+
+// =====================================================================================================================
+static void printSkipped(std::ostream& out, const std::string& name, const std::string& reason)
+{
+    out << "{\"benchmark\":\"" << name << "\",\"skipped\":\"" << reason << "\"}" << std::endl;
+}
+
+// =====================================================================================================================
+static void printResult(std::ostream& out, const std::string& name, const Result& r)
+{
+    double audioSeconds = static_cast<double>(r.m_frames) / r.m_rate;
+
+    out << std::fixed << std::setprecision(6)
+	<< "{\"benchmark\":\"" << name << "\""
+	<< ",\"converter\":\"" << codec::SampleConverter().getName() << "\""
+	<< ",\"rate\":" << r.m_rate
+	<< ",\"channels\":" << r.m_channels
+	<< ",\"frames\":" << r.m_frames
+	<< ",\"seconds\":" << r.m_seconds
+	<< ",\"samples_per_second\":" << r.m_frames * r.m_channels / r.m_seconds
+	<< ",\"ns_per_frame\":" << r.m_seconds * 1e9 / r.m_frames
+	<< ",\"realtime\":" << audioSeconds / r.m_seconds
+	<< ",\"allocations_per_second\":" << r.m_allocations / audioSeconds
+	<< "}" << std::endl;
+}
+
+// =====================================================================================================================
+static double elapsed(const std::chrono::steady_clock::time_point& start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// =====================================================================================================================
+static bool runCodec(const codec::CodecManager& codecManager, const std::string& file, Result& best)
+{
+    for (unsigned i = 0; i < s_repeat; ++i)
+    {
+	std::shared_ptr<codec::BaseCodec> input = codecManager.create(file);
+
+	if (!input)
+	    return false;
+
+	// opening the file is not measured
+	input->open();
+
+	player::Format format = input->getFormat();
+	std::vector<float> buffer(s_frames * format.getChannels());
+
+	Result r;
+	r.m_rate = format.getRate();
+	r.m_channels = format.getChannels();
+
+	size_t allocations = s_allocations;
+	auto start = std::chrono::steady_clock::now();
+
+	size_t count;
+
+	while ((count = input->decodeInto(&buffer[0], s_frames)) > 0)
+	    r.m_frames += count;
+
+	r.m_seconds = elapsed(start);
+	r.m_allocations = s_allocations - allocations;
+
+	if (r.m_frames == 0)
+	    return false;
+
+	if (i == 0 || r.m_seconds < best.m_seconds)
+	    best = r;
+    }
+
+    return true;
+}
+
+// =====================================================================================================================
+static Result runFilter(filter::BaseFilter& filter, const std::vector<float>& signal, const player::Format& format)
+{
+    Result best;
+    std::vector<float> work;
+
+    filter.init();
+
+    for (unsigned i = 0; i < s_repeat; ++i)
+    {
+	// filters may work in place so every run starts from the original signal
+	work = signal;
+	filter.reset();
+
+	Result r;
+	r.m_rate = format.getRate();
+	r.m_channels = format.getChannels();
+
+	size_t frames = work.size() / format.getChannels();
+	size_t allocations = s_allocations;
+	auto start = std::chrono::steady_clock::now();
+
+	for (size_t pos = 0; pos < frames; pos += s_frames)
+	{
+	    float* samples = &work[pos * format.getChannels()];
+	    size_t count = std::min(s_frames, frames - pos);
+
+	    filter.run(samples, count, format);
+	}
+
+	r.m_frames = frames;
+	r.m_seconds = elapsed(start);
+	r.m_allocations = s_allocations - allocations;
+
+	if (i == 0 || r.m_seconds < best.m_seconds)
+	    best = r;
+    }
+
+    return best;
+}
+
+// =====================================================================================================================
+template <typename Convert>
+static Result runOutput(const std::vector<float>& signal, const player::Format& format, Convert convert)
+{
+    Result best;
+
+    for (unsigned i = 0; i < s_repeat; ++i)
+    {
+	Result r;
+	r.m_rate = format.getRate();
+	r.m_channels = format.getChannels();
+
+	size_t frames = signal.size() / format.getChannels();
+	size_t allocations = s_allocations;
+	auto start = std::chrono::steady_clock::now();
+
+	for (size_t pos = 0; pos < frames; pos += s_frames)
+	    convert(&signal[pos * format.getChannels()], std::min(s_frames, frames - pos) * format.getChannels());
+
+	r.m_frames = frames;
+	r.m_seconds = elapsed(start);
+	r.m_allocations = s_allocations - allocations;
+
+	if (i == 0 || r.m_seconds < best.m_seconds)
+	    best = r;
+    }
+
+    return best;
+}
+
+// =====================================================================================================================
+static std::vector<float> generateSignal(const player::Format& format, unsigned seconds)
+{
+    size_t frames = static_cast<size_t>(format.getRate()) * seconds;
+    std::vector<float> signal(frames * format.getChannels());
+
+    double phase = 0.0;
+    unsigned seed = 1;
+
+    for (size_t i = 0; i < frames; ++i)
+    {
+	// logarithmic sine sweep from 20Hz to 20kHz on the left channel, noise on the right one
+	double freq = 20.0 * pow(1000.0, static_cast<double>(i) / frames);
+	phase += 2 * M_PI * freq / format.getRate();
+
+	seed = seed * 1103515245 + 12345;
+
+	signal[i * format.getChannels()] = 0.5f * sin(phase);
+
+	for (int ch = 1; ch < format.getChannels(); ++ch)
+	    signal[i * format.getChannels() + ch] = 0.5f * ((seed >> 16) / 32768.0f - 1.0f);
+    }
+
+    return signal;
+}
+
+// =====================================================================================================================
+static void benchCodecs(std::ostream& out)
+{
+    codec::CodecManager codecManager;
+    std::vector<std::pair<std::string, std::string>> codecs;
+
+#ifdef HAVE_MP3
+    mpg123_init();
+    codecManager.registerCodec("mp3",  [](const std::string& file) { return std::make_shared<codec::Mp3>(file); });
+    codecs.push_back(std::make_pair("mp3", "mp3"));
+#endif
+#ifdef HAVE_FLAC
+    codecManager.registerCodec("flac", [](const std::string& file) { return std::make_shared<codec::Flac>(file); });
+    codecs.push_back(std::make_pair("flac", "flac"));
+#endif
+#ifdef HAVE_OGG
+    codecManager.registerCodec("ogg",  [](const std::string& file) { return std::make_shared<codec::Vorbis>(file); });
+    codecs.push_back(std::make_pair("ogg", "ogg"));
+#endif
+#ifdef HAVE_WAVPACK
+    codecManager.registerCodec("wv",   [](const std::string& file) { return std::make_shared<codec::WavPack>(file); });
+    codecs.push_back(std::make_pair("wavpack", "wv"));
+#endif
+#ifdef HAVE_MONKEYSAUDIO
+    codecManager.registerCodec("ape",  [](const std::string& file) { return std::make_shared<codec::Mac>(file); });
+    codecs.push_back(std::make_pair("monkeysaudio", "ape"));
+#endif
+
+    for (const auto& c : codecs)
+    {
+	std::string name = "codec/" + c.first;
+	std::string file = s_signals + "/signal." + c.second;
+
+	if (access(file.c_str(), R_OK) != 0)
+	{
+	    printSkipped(out, name, "missing signal file");
+	    continue;
+	}
+
+	Result r;
+
+	try
+	{
+	    if (!runCodec(codecManager, file, r))
+	    {
+		printSkipped(out, name, "no samples decoded");
+		continue;
+	    }
+	}
+	catch (const codec::CodecException& e)
+	{
+	    printSkipped(out, name, e.what());
+	    continue;
+	}
+
+	printResult(out, name, r);
+    }
+
+#ifdef HAVE_MP3
+    mpg123_exit();
+#endif
+}
+
+// =====================================================================================================================
+static void benchFilters(std::ostream& out)
+{
+    static const char* qualities[] = { "fastest", "medium", "best" };
+
+    player::Format format(44100, 2);
+    std::vector<float> signal = generateSignal(format, s_seconds);
+
+    config::Config config;
+
+    {
+	filter::Volume volume(config);
+	volume.setLevel(80);
+
+	printResult(out, "filter/volume", runFilter(volume, signal, format));
+    }
+
+    for (const char* quality : qualities)
+    {
+	config.m_raw["filter"]["resample"]["quality"] = quality;
+
+	for (int dstRate : { 48000, 96000 })
+	{
+	    std::ostringstream name;
+	    name << "filter/resample/" << quality << "/" << format.getRate() << "-" << dstRate;
+
+	    filter::Resample resample(format.getRate(), dstRate, config);
+
+	    try
+	    {
+		printResult(out, name.str(), runFilter(resample, signal, format));
+	    }
+	    catch (const filter::FilterException& e)
+	    {
+		printSkipped(out, name.str(), e.what());
+	    }
+
+	    // the built-in polyphase resampler with the same quality setting
+	    name.str("");
+	    name << "filter/polyphase/" << quality << "/" << format.getRate() << "-" << dstRate;
+
+	    filter::Polyphase polyphase(format.getRate(), dstRate, config);
+
+	    printResult(out, name.str(), runFilter(polyphase, signal, format));
+	}
+    }
+}
+
+// =====================================================================================================================
+static void benchOutput(std::ostream& out)
+{
+    player::Format format(44100, 2);
+    std::vector<float> signal = generateSignal(format, s_seconds);
+
+    // the conversion to the format of the device including the volume
+    output::FormatConverter converter;
+
+    std::vector<float> f32(s_frames * format.getChannels());
+    std::vector<int16_t> s16(s_frames * format.getChannels());
+    std::vector<uint8_t> s24(s_frames * format.getChannels() * 3);
+    std::vector<int32_t> s32(s_frames * format.getChannels());
+
+    printResult(out, "output/f32", runOutput(signal, format, [&](const float* samples, size_t count) {
+	converter.f32(samples, &f32[0], count, 0.8f);
+    }));
+    printResult(out, "output/s16", runOutput(signal, format, [&](const float* samples, size_t count) {
+	converter.s16(samples, &s16[0], count, 0.8f);
+    }));
+    printResult(out, "output/s24", runOutput(signal, format, [&](const float* samples, size_t count) {
+	converter.s24(samples, &s24[0], count, 0.8f);
+    }));
+    printResult(out, "output/s32", runOutput(signal, format, [&](const float* samples, size_t count) {
+	converter.s32(samples, &s32[0], count, 0.8f);
+    }));
+}
+
+// =====================================================================================================================
+static bool parseArgs(int argc, char** argv)
+{
+    boost::program_options::options_description desc;
+    desc.add_options()
+	("help,h", "output help message")
+	("signals,s", boost::program_options::value<std::string>(), "directory of the encoded test signals")
+	("output,o", boost::program_options::value<std::string>(), "file of the results (standard output by default)")
+	("seconds", boost::program_options::value<unsigned>(), "length of the generated filter input (60 by default)")
+	("repeat,r", boost::program_options::value<unsigned>(), "number of runs of each benchmark (3 by default)")
+    ;
+
+    boost::program_options::variables_map vm;
+    boost::program_options::store(boost::program_options::parse_command_line(argc, argv, desc), vm);
+    boost::program_options::notify(vm);
+
+    // display help if it was requested
+    if (vm.count("help"))
+    {
+	std::cout << desc << std::endl;
+	return false;
+    }
+
+    if (vm.count("signals"))
+	s_signals = vm["signals"].as<std::string>();
+    if (vm.count("output"))
+	s_output = vm["output"].as<std::string>();
+    if (vm.count("seconds"))
+	s_seconds = std::max(1u, vm["seconds"].as<unsigned>());
+    if (vm.count("repeat"))
+	s_repeat = std::max(1u, vm["repeat"].as<unsigned>());
+
+    return true;
+}
+
+// =====================================================================================================================
+int main(int argc, char** argv)
+{
+    if (!parseArgs(argc, argv))
+	return 1;
+
+    // results are written as one JSON object per line, log messages of the player go to the standard output
+    std::ofstream file;
+
+    if (!s_output.empty())
+    {
+	file.open(s_output.c_str(), std::ios::trunc);
+
+	if (!file)
+	{
+	    std::cerr << "unable to open " << s_output << std::endl;
+	    return 1;
+	}
+    }
+
+    std::ostream& out = s_output.empty() ? std::cout : file;
+
+    if (s_signals.empty())
+	std::cerr << "no signal directory was given, codecs are not measured" << std::endl;
+    else
+	benchCodecs(out);
+
+    benchFilters(out);
+    benchOutput(out);
+
+    return 0;
+}
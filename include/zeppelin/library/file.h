@@ -27,6 +27,8 @@ struct File
     std::string m_name;
     // size of the file in bytes
     int64_t m_size;
+    // last modification time of the file in nanoseconds since the epoch
+    int64_t m_mtime;
 
     int m_artistId;
     int m_albumId;
@@ -7,6 +7,9 @@
 #ifndef ZEPPELIN_LIBRARY_MUSICLIBRARY_H_INCLUDED
 #define ZEPPELIN_LIBRARY_MUSICLIBRARY_H_INCLUDED
 
+#include <string>
+#include <vector>
+
 namespace zeppelin
 {
 namespace library
@@ -17,10 +20,29 @@ class Storage;
 class MusicLibrary
 {
     public:
+	/// time spent on parsing the metadata of the files of a codec
+	struct ParseStatistics
+	{
+	    // the codec (the extension of the files)
+	    std::string m_codec;
+	    // number of parsed files, including the failed ones
+	    int m_files;
+	    // number of files without parsed metadata
+	    int m_failures;
+	    // sum and maximum of the parse times in milliseconds
+	    double m_totalTime;
+	    double m_maxTime;
+	    // the file with the maximum parse time
+	    std::string m_slowestFile;
+	};
+
 	struct Status
 	{
 	    bool m_scannerRunning;
 	    bool m_metaParserRunning;
+	    // number of files waiting for metadata parsing
+	    int m_metaParserQueue;
+	    std::vector<ParseStatistics> m_parseStatistics;
 	};
 
 	virtual ~MusicLibrary()
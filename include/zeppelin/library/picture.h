@@ -9,6 +9,10 @@
 
 #include <string>
 #include <vector>
+#include <memory>
+
+#include <stddef.h>
+#include <stdint.h>
 
 namespace zeppelin
 {
@@ -26,13 +30,36 @@ class Picture
 
 	Picture(const std::string& mimeType, const unsigned char* data, size_t size);
 	Picture(const std::string& mimeType, std::vector<unsigned char>&& data);
+	/// creates a picture stored in the media file at the given offset without loading its data
+	Picture(const std::string& mimeType, int64_t offset, size_t size);
+	/// creates a picture from a file of the picture store, the file is memory mapped
+	Picture(const std::string& mimeType, const std::string& path);
 
 	const std::string& getMimeType() const;
+	/// the data of the pictures of the picture store is copied at the first call, prefer getView() for them
 	const std::vector<unsigned char>& getData() const;
 
+	/// returns the data without copying it or nullptr if it is not loaded, valid while the picture exists
+	const unsigned char* getView() const;
+	/// returns the path of the file in the picture store or an empty string for the pictures kept in memory
+	const std::string& getPath() const;
+
+	/// returns false if only the location of the picture in the media file is known
+	bool isLoaded() const;
+	int64_t getOffset() const;
+	size_t getSize() const;
+
     private:
 	std::string m_mimeType;
-	std::vector<unsigned char> m_data;
+	mutable std::vector<unsigned char> m_data;
+
+	// location of the data in the media file, the offset is -1 for loaded pictures
+	int64_t m_offset;
+	size_t m_size;
+
+	// the mapped file of the picture store
+	std::string m_path;
+	std::shared_ptr<const unsigned char> m_view;
 };
 
 }
@@ -63,21 +63,41 @@ class Storage
 	// returns statistics about the music library
 	virtual Statistics getStatistics() = 0;
 
+	/**
+	 * Groups the following writes into transactions until endBatch() is called. Batches may be started by multiple
+	 * threads, the pending writes are committed when the last one ends. The pending writes can be read back before
+	 * they are committed.
+	 */
+	virtual void beginBatch() = 0;
+	/// ends a batch started by beginBatch()
+	virtual void endBatch() = 0;
+
 	/// returns the directory structure associated to the given ID
 	virtual std::vector<std::shared_ptr<Directory>> getDirectories(const std::vector<int>& ids) = 0;
 	/// lists the subdirectory IDs of the given directory
 	virtual std::vector<int> getSubdirectoryIdsOfDirectory(int id) = 0;
 	/// ensures that the given directory with the parent exists in the database and returns its ID
 	virtual int ensureDirectory(const std::string& name, int parentId) = 0;
+	/// returns the modification time of the directory recorded at its last scan or -1 if it was not scanned yet
+	virtual int64_t getDirectoryMtime(int id) = 0;
+	/// records the modification time of the directory after all of its entries were scanned
+	virtual void setDirectoryMtime(int id, int64_t mtime) = 0;
 
 	/**
-	 * Adds a new file to the storage.
-	 * @return true if this is a new file
+	 * Adds a new file to the storage or updates the size and modification time of an existing one.
+	 * @return true if this is a new file or it was modified since the last scan, i.e. its metadata has to be parsed
 	 */
 	virtual bool addFile(File& file) = 0;
 
 	/// clears the mark flag from all files
 	virtual void clearMark() = 0;
+	/// puts the mark on all files of the given directory
+	virtual void markFilesOfDirectory(int directoryId) = 0;
+
+	/// removes a file from the library
+	virtual void removeFile(int directoryId, const std::string& name) = 0;
+	/// removes a directory with all of its subdirectories and files from the library
+	virtual void removeDirectory(int id) = 0;
 	/// deletes those files from the database having no mark
 	virtual void deleteNonMarked() = 0;
 
@@ -90,6 +110,8 @@ class Storage
 	virtual std::vector<int> getFileIdsOfAlbum(int albumId) = 0;
 	/// returns the files of the given directory
 	virtual std::vector<int> getFileIdsOfDirectory(int directoryId) = 0;
+	/// returns the name, size and modification time of the files of the given directory
+	virtual std::vector<std::shared_ptr<File>> getFilesOfDirectory(int directoryId) = 0;
 
 	// Sets all metadata related fields of the file including length, sampling rate, etc.
 	virtual void setFileMetadata(const File& file) = 0;
@@ -102,7 +124,8 @@ class Storage
 	virtual std::vector<int> getAlbumIdsByArtist(int artistId) = 0;
 	/// returns the available albums from the database (without artist filtering)
 	virtual std::vector<std::shared_ptr<Album>> getAlbums(const std::vector<int>& ids) = 0;
-	/// returns the pictures associated to the given albums
+	/// returns the pictures associated to the given albums, the data of the pictures is read from the media files at
+	/// the first request
 	virtual std::map<int, std::map<Picture::Type, std::shared_ptr<Picture>>> getPicturesOfAlbums(const std::vector<int>& ids) = 0;
 
 	// creates a new playlist
@@ -8,6 +8,7 @@
 #define ZEPPELIN_CONTROLLER_H_INCLUDED
 
 #include <memory>
+#include <string>
 #include <vector>
 
 namespace zeppelin
@@ -46,6 +47,12 @@ class Controller
 	    unsigned m_position;
 	    // volume level (0 - 100)
 	    int m_volume;
+	    // sample format used by the output device (e.g. S16_LE)
+	    std::string m_sampleFormat;
+	    // quality of the resampler (e.g. best), empty if the samples are not resampled
+	    std::string m_resampleQuality;
+	    // decoding speed relative to the playback, 0 until it is measured
+	    float m_decoderHeadroom;
 	};
 
 	virtual ~Controller()
@@ -0,0 +1,20 @@
+#!/bin/bash
+
+# Generates the test signals with the available command line encoders and runs the benchmarks on them.
+# Codecs without an installed encoder are reported as skipped. Extra arguments are passed to the bench program.
+
+BENCH=${BENCH:-./zeppelin-bench}
+
+SIGNALS=$(mktemp -d)
+trap "rm -rf $SIGNALS" EXIT
+
+# 60 seconds of a sine sweep on the left channel and pink noise on the right one
+sox -q -n -r 44100 -b 16 -c 2 $SIGNALS/signal.wav synth 60 sine 20-20000 pinknoise vol 0.5 || exit 1
+
+command -v flac > /dev/null && flac -s -o $SIGNALS/signal.flac $SIGNALS/signal.wav
+command -v oggenc > /dev/null && oggenc -Q -o $SIGNALS/signal.ogg $SIGNALS/signal.wav
+command -v lame > /dev/null && lame --quiet -b 192 $SIGNALS/signal.wav $SIGNALS/signal.mp3
+command -v wavpack > /dev/null && wavpack -q $SIGNALS/signal.wav $SIGNALS/signal.wv
+command -v mac > /dev/null && mac $SIGNALS/signal.wav $SIGNALS/signal.ape -c2000 > /dev/null
+
+$BENCH --signals $SIGNALS "$@"
@@ -43,10 +43,12 @@ class BaseCodec
 	virtual player::Format getFormat() const = 0;
 
 	/**
-	 * Decodes the next part of the media stream.
-	 * @return false is returned at the end of the stream
+	 * Decodes the next part of the media stream into the buffer of the caller. The codec keeps decoding until the
+	 * buffer is full, so less frames are returned only at the end of the stream.
+	 * @param dst buffer with room for maxFrames frames of interleaved samples
+	 * @return the number of decoded frames, 0 is returned at the end of the stream
 	 */
-	virtual bool decode(float*& samples, size_t& count) = 0;
+	virtual size_t decodeInto(float* dst, size_t maxFrames) = 0;
 
 	// seeks to the given sample offset
 	virtual void seek(off_t sample) = 0;
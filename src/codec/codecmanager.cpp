@@ -8,6 +8,8 @@
 
 #include <zeppelin/logger.h>
 
+#include <cstring>
+
 using codec::CodecManager;
 
 // =====================================================================================================================
@@ -33,6 +35,18 @@ bool CodecManager::isMediaFile(const std::string& file) const
     return findCodec(file) != m_codecs.end();
 }
 
+// =====================================================================================================================
+bool CodecManager::isMediaFile(const char* file) const
+{
+    const char* p = strrchr(file, '.');
+
+    if (!p)
+	return false;
+
+    // only the extension is copied, it fits into the internal buffer of the string in most cases
+    return m_codecs.find(std::string(p + 1)) != m_codecs.end();
+}
+
 // =====================================================================================================================
 CodecManager::CodecMap::const_iterator CodecManager::findCodec(const std::string& file) const
 {
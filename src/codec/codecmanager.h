@@ -7,11 +7,12 @@
 #ifndef CODEC_CODECMANAGER_H_INCLUDED
 #define CODEC_CODECMANAGER_H_INCLUDED
 
-#include <boost/algorithm/string.hpp>
-
 #include <string>
 #include <unordered_map>
 #include <functional>
+#include <memory>
+
+#include <strings.h>
 
 namespace codec
 {
@@ -28,18 +29,32 @@ class CodecManager
 	virtual std::shared_ptr<BaseCodec> create(const std::string& file) const;
 
 	bool isMediaFile(const std::string& file) const;
+	// the same as above without copying the name of the file (e.g. for directory entries)
+	bool isMediaFile(const char* file) const;
 
     private:
+	// the extensions are case insensitive, they are hashed and compared without making lower case copies of them
 	struct Hasher
 	{
 	    size_t operator()(const std::string& s) const
-	    { return std::hash<std::string>()(boost::algorithm::to_lower_copy(s)); }
+	    {
+		// FNV-1a hash of the lower case characters
+		size_t h = 2166136261u;
+
+		for (char c : s)
+		{
+		    h ^= static_cast<unsigned char>(c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c);
+		    h *= 16777619u;
+		}
+
+		return h;
+	    }
 	};
 
 	struct Comparator
 	{
 	    bool operator()(const std::string& s1, const std::string& s2) const
-	    { return boost::iequals(s1, s2); }
+	    { return s1.size() == s2.size() && strncasecmp(s1.c_str(), s2.c_str(), s1.size()) == 0; }
 	};
 
 	typedef std::unordered_map<std::string,
@@ -11,6 +11,7 @@
 #include <zeppelin/logger.h>
 
 #include <cstring>
+#include <algorithm>
 
 using codec::Flac;
 
@@ -24,7 +25,11 @@ Flac::Flac(const std::string& file)
       m_channels(0),
       m_bps(0),
       m_scale(0),
-      m_error(false)
+      m_error(false),
+      m_dst(NULL),
+      m_dstFrames(0),
+      m_written(0),
+      m_pending(0)
 {
 }
 
@@ -188,38 +193,58 @@ std::unique_ptr<zeppelin::library::Metadata> Flac::readMetadata()
 }
 
 // =====================================================================================================================
-bool Flac::decode(float*& samples, size_t& count)
+size_t Flac::decodeInto(float* dst, size_t maxFrames)
 {
-    FLAC__StreamDecoderState state = FLAC__stream_decoder_get_state(m_decoder);
+    size_t frames = 0;
 
-    switch (state)
+    while (frames < maxFrames)
     {
-	case FLAC__STREAM_DECODER_END_OF_STREAM :
-	case FLAC__STREAM_DECODER_OGG_ERROR :
-	case FLAC__STREAM_DECODER_ABORTED :
-	case FLAC__STREAM_DECODER_MEMORY_ALLOCATION_ERROR :
-	    return false;
+	// use the samples left over from the previous call first
+	if (m_pending < m_samples.size())
+	{
+	    size_t count = std::min((m_samples.size() - m_pending) / 2, maxFrames - frames);
 
-	default :
-	    // decoding can be continued in the remaining states
+	    auto it = m_samples.begin() + m_pending;
+	    std::copy(it, it + count * 2, dst + frames * 2);
+	    m_pending += count * 2;
+	    frames += count;
+
+	    continue;
+	}
+
+	FLAC__StreamDecoderState state = FLAC__stream_decoder_get_state(m_decoder);
+
+	if (state == FLAC__STREAM_DECODER_END_OF_STREAM ||
+	    state == FLAC__STREAM_DECODER_OGG_ERROR ||
+	    state == FLAC__STREAM_DECODER_ABORTED ||
+	    state == FLAC__STREAM_DECODER_MEMORY_ALLOCATION_ERROR)
 	    break;
-    }
 
-    m_error = false;
-    m_samples.clear();
+	m_error = false;
+	m_dst = dst + frames * 2;
+	m_dstFrames = maxFrames - frames;
+	m_written = 0;
 
-    if (!FLAC__stream_decoder_process_single(m_decoder))
-	throw CodecException("stream decoding error");
+	bool ret = FLAC__stream_decoder_process_single(m_decoder);
 
-    samples = &m_samples[0];
-    count = m_samples.size() / 2;
+	frames += m_written;
+	m_dst = NULL;
+	m_dstFrames = 0;
 
-    return true;
+	if (!ret)
+	    throw CodecException("stream decoding error");
+    }
+
+    return frames;
 }
 
 // =====================================================================================================================
 void Flac::seek(off_t sample)
 {
+    // the decoder calls the write callback with the frame at the new position, it is kept in the pending buffer
+    m_samples.clear();
+    m_pending = 0;
+
     if (!FLAC__stream_decoder_seek_absolute(m_decoder, sample))
     {
 	LOG("flac: seek error");
@@ -227,32 +252,27 @@ void Flac::seek(off_t sample)
     }
 }
 
-// =====================================================================================================================
-static inline void convertSample(const FLAC__int32 in, float& out, unsigned scale)
-{
-    out = (float)in / scale;
-
-    if (out > 1.0f)
-	out = 1.0f;
-    else if (out < -1.0f)
-	out = -1.0f;
-}
-
 // =====================================================================================================================
 FLAC__StreamDecoderWriteStatus Flac::writeCallback(const FLAC__Frame* frame,
 						   const FLAC__int32* const buffer[])
 {
-    // reserve space to store the decoded samples
-    m_samples.resize(frame->header.blocksize * 2);
+    size_t frames = frame->header.blocksize;
+    size_t direct = std::min(frames, m_dstFrames);
 
-    size_t idx = 0;
+    // create interleaved samples right in the buffer of the caller as long as they fit
+    if (direct > 0)
+	m_converter.s32Planar(buffer, 2, m_dst, direct, m_scale);
 
-    // create an interleaved buffer of samples
-    for (size_t i = 0; i < frame->header.blocksize; ++i)
-    {
-	convertSample(buffer[0][i], m_samples[idx++], m_scale);
-	convertSample(buffer[1][i], m_samples[idx++], m_scale);
-    }
+    m_written = direct;
+
+    // keep the rest for the next decodeInto() call
+    const FLAC__int32* rest[] = { buffer[0] + direct, buffer[1] + direct };
+
+    m_samples.resize((frames - direct) * 2);
+    m_pending = 0;
+
+    if (frames > direct)
+	m_converter.s32Planar(rest, 2, &m_samples[0], frames - direct, m_scale);
 
     return FLAC__STREAM_DECODER_WRITE_STATUS_CONTINUE;
 }
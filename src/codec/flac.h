@@ -8,6 +8,7 @@
 #define CODEC_FLAC_H_INCLUDED
 
 #include "basecodec.h"
+#include "sampleconverter.h"
 
 #include <FLAC/stream_decoder.h>
 #include <FLAC/metadata.h>
@@ -27,7 +28,7 @@ class Flac : public BaseCodec
 
 	player::Format getFormat() const override;
 
-	bool decode(float*& samples, size_t& count) override;
+	size_t decodeInto(float* dst, size_t maxFrames) override;
 
 	void seek(off_t sample) override;
 
@@ -65,7 +66,16 @@ class Flac : public BaseCodec
 	unsigned m_scale;
 
 	bool m_error;
+	SampleConverter m_converter;
+
+	// buffer of the caller of decodeInto(), the write callback converts samples into it directly
+	float* m_dst;
+	size_t m_dstFrames;
+	size_t m_written;
+
+	// samples of the last decoded frame not fitting into the buffer of the caller
 	std::vector<float> m_samples;
+	size_t m_pending;
 };
 
 }
@@ -8,6 +8,8 @@
 
 #include <zeppelin/logger.h>
 
+#include <algorithm>
+
 #define DLLEXPORT
 #include <mac/NoWindows.h>
 #include <mac/MACLib.h>
@@ -54,6 +56,12 @@ void Mac::open()
     }
 
     m_bps = m_decompress->GetInfo(APE_INFO_BITS_PER_SAMPLE);
+
+    if (m_bps != 8 && m_bps != 16 && m_bps != 24 && m_bps != 32)
+    {
+	LOG("mac: unsupported bps: " << m_bps);
+	throw CodecException("unsupported BPS");
+    }
 }
 
 // =====================================================================================================================
@@ -63,66 +71,48 @@ player::Format Mac::getFormat() const
 }
 
 // =====================================================================================================================
-static inline void convertSample(int32_t in, float& out, unsigned scale)
-{
-    out = (float)in / scale;
-
-    if (out > 1.0f)
-	out = 1.0f;
-    else if (out < -1.0f)
-	out = -1.0f;
-}
-
-// =====================================================================================================================
-bool Mac::decode(float*& samples, size_t& count)
+size_t Mac::decodeInto(float* dst, size_t maxFrames)
 {
     const int blocks = 1024;
 
-    int retrieved;
     int32_t buf[blocks * m_channels];
+    size_t frames = 0;
 
-    m_decompress->GetData(reinterpret_cast<char*>(buf), blocks, &retrieved);
-
-    if (!retrieved)
-	return false;
-
-    m_samples.resize(retrieved * m_channels);
-
-    switch (m_bps)
+    while (frames < maxFrames)
     {
-	case 8 :
-	{
-	    int8_t* p = reinterpret_cast<int8_t*>(buf);
+	int retrieved;
 
-	    for (int i = 0; i < retrieved * m_channels; ++i)
-		convertSample(*p++, m_samples[i], 0x7f);
+	m_decompress->GetData(reinterpret_cast<char*>(buf), std::min<size_t>(blocks, maxFrames - frames), &retrieved);
 
+	if (!retrieved)
 	    break;
-	}
 
-	case 16 :
+	float* p = dst + frames * m_channels;
+	size_t count = retrieved * m_channels;
+
+	switch (m_bps)
 	{
-	    int16_t* p = reinterpret_cast<int16_t*>(buf);
+	    case 8 :
+		m_converter.s8(reinterpret_cast<int8_t*>(buf), p, count, 0x7f);
+		break;
 
-	    for (int i = 0; i < retrieved * m_channels; ++i)
-		convertSample(*p++, m_samples[i], 0x7fff);
+	    case 16 :
+		m_converter.s16(reinterpret_cast<int16_t*>(buf), p, count, 0x7fff);
+		break;
 
-	    break;
-	}
+	    case 24 :
+		m_converter.s24(reinterpret_cast<uint8_t*>(buf), p, count, 0x7fffff);
+		break;
 
-	case 32 :
-	{
-	    for (int i = 0; i < retrieved * m_channels; ++i)
-		convertSample(buf[i], m_samples[i], 0x7fffffff);
-
-	    break;
+	    case 32 :
+		m_converter.s32(buf, p, count, 0x7fffffff);
+		break;
 	}
-    }
 
-    samples = &m_samples[0];
-    count = retrieved;
+	frames += retrieved;
+    }
 
-    return true;
+    return frames;
 }
 
 // =====================================================================================================================
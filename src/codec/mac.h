@@ -8,6 +8,7 @@
 #define CODEC_MAC_H_INCLUDED
 
 #include "basecodec.h"
+#include "sampleconverter.h"
 
 #include <vector>
 
@@ -26,7 +27,7 @@ class Mac : public BaseCodec
 
 	player::Format getFormat() const override;
 
-	bool decode(float*& samples, size_t& count) override;
+	size_t decodeInto(float* dst, size_t maxFrames) override;
 
 	void seek(off_t sample) override;
 
@@ -39,7 +40,7 @@ class Mac : public BaseCodec
 	int m_channels;
 	int m_bps;
 
-	std::vector<float> m_samples;
+	SampleConverter m_converter;
 };
 
 }
@@ -5,6 +5,7 @@
  */
 
 #include "mp3.h"
+#include "mp3header.h"
 
 #include <zeppelin/logger.h>
 
@@ -43,6 +44,15 @@ void Mp3::open()
     // create handle
     create();
 
+    // ask for float samples, they are not available in fixed point builds of mpg123 though
+    if (!setupFormats(MPG123_ENC_FLOAT_32))
+    {
+	LOG("mp3: float output is not supported, using 16bit samples");
+
+	if (!setupFormats(MPG123_ENC_SIGNED_16))
+	    throw CodecException("unable to set output format");
+    }
+
     // issue the first mpg123_decode_frame() call, it will detect the file format only, no samples will be decoded
 
     off_t frame;
@@ -61,9 +71,9 @@ void Mp3::open()
 	throw CodecException("unsupported channels");
     }
 
-    if (m_format != MPG123_ENC_SIGNED_16)
+    if (m_format != MPG123_ENC_FLOAT_32 && m_format != MPG123_ENC_SIGNED_16)
     {
-	LOG("mp3: currently 16bit samples are supported only!");
+	LOG("mp3: unsupported sample format: " << m_format);
 	throw CodecException("unsupported BPS");
     }
 }
@@ -82,16 +92,26 @@ std::unique_ptr<zeppelin::library::Metadata> Mp3::readMetadata()
     // create handle
     create(true);
 
-    if (mpg123_scan(m_handle) != MPG123_OK)
-	throw CodecException("unable to scan media");
-
+    // only the tags and the first frame are parsed here
     if (mpg123_getformat(m_handle, &m_rate, &m_channels, NULL) != MPG123_OK)
 	throw CodecException("unable to get file format");
 
-    off_t samples = mpg123_length(m_handle);
+    off_t samples;
+    Mp3Header header;
+
+    // the length is taken from the headers if possible, scanning reads the whole file
+    if (header.read(m_file))
+	samples = header.getSamples();
+    else
+    {
+	if (mpg123_scan(m_handle) != MPG123_OK)
+	    throw CodecException("unable to scan media");
+
+	samples = mpg123_length(m_handle);
 
-    if (samples == MPG123_ERR)
-	throw CodecException("unable to get media length");
+	if (samples == MPG123_ERR)
+	    throw CodecException("unable to get media length");
+    }
 
     metadata->setFormat(m_channels, m_rate, 16);
     metadata->setLength(samples / m_rate);
@@ -111,45 +131,53 @@ std::unique_ptr<zeppelin::library::Metadata> Mp3::readMetadata()
 }
 
 // =====================================================================================================================
-bool Mp3::decode(float*& samples, size_t& count)
+size_t Mp3::decodeInto(float* dst, size_t maxFrames)
 {
-    off_t frame;
-    unsigned char* data;
-    size_t bytes;
+    bool floatMode = (m_format == MPG123_ENC_FLOAT_32);
+    size_t frameSize = m_channels * (floatMode ? sizeof(float) : sizeof(int16_t));
+    unsigned char* out;
+
+    if (floatMode)
+	// float samples are decoded right into the buffer of the caller
+	out = reinterpret_cast<unsigned char*>(dst);
+    else
+    {
+	m_buffer.resize(maxFrames * m_channels);
+	out = reinterpret_cast<unsigned char*>(&m_buffer[0]);
+    }
 
-    // decode the next frame
-    int r = mpg123_decode_frame(m_handle, &frame, &data, &bytes);
+    size_t size = maxFrames * frameSize;
+    size_t bytes = 0;
 
-    if (r != MPG123_OK)
+    // mpg123_read() decodes as many mp3 frames as needed to fill the buffer
+    while (bytes < size)
     {
-	if (r != MPG123_DONE)
-	    LOG("mp3: frame decoding error: " << r);
+	size_t done;
+	int r = mpg123_read(m_handle, out + bytes, size - bytes, &done);
 
-	return false;
-    }
+	bytes += done;
 
-    if ((bytes % (m_channels * sizeof(int16_t))) != 0)
-	throw CodecException("invalid number of decoded bytes");
+	if (r != MPG123_OK)
+	{
+	    if (r != MPG123_DONE)
+		LOG("mp3: frame decoding error: " << r);
 
-    int16_t* p = reinterpret_cast<int16_t*>(data);
-    count = bytes / (m_channels * sizeof(int16_t));
+	    break;
+	}
 
-    // convert samples
-    m_samples.resize(count * m_channels);
+	if (done == 0)
+	    break;
+    }
 
-    for (size_t i = 0; i < m_samples.size(); ++i)
-    {
-	m_samples[i] = (float)p[i] / 32767.0f;
+    if ((bytes % frameSize) != 0)
+	throw CodecException("invalid number of decoded bytes");
 
-	if (m_samples[i] > 1.0f)
-	    m_samples[i] = 1.0f;
-	else if (m_samples[i] < -1.0f)
-	    m_samples[i] = -1.0f;
-    }
+    size_t frames = bytes / frameSize;
 
-    samples = &m_samples[0];
+    if (!floatMode)
+	m_converter.s16(&m_buffer[0], dst, frames * m_channels, 32767.0f);
 
-    return true;
+    return frames;
 }
 
 // =====================================================================================================================
@@ -179,6 +207,24 @@ void Mp3::create(bool picture)
 	throw CodecException("unable to open file");
 }
 
+// =====================================================================================================================
+bool Mp3::setupFormats(int encoding)
+{
+    const long* rates;
+    size_t count;
+
+    mpg123_rates(&rates, &count);
+    mpg123_format_none(m_handle);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+	if (mpg123_format(m_handle, rates[i], MPG123_MONO | MPG123_STEREO, encoding) != MPG123_OK)
+	    return false;
+    }
+
+    return true;
+}
+
 // =====================================================================================================================
 static inline void readID3v1Field(const char* field, size_t length, std::string& s)
 {
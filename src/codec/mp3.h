@@ -8,11 +8,14 @@
 #define CODEC_MP3_H_INCLUDED
 
 #include "basecodec.h"
+#include "sampleconverter.h"
 
 #include <mpg123.h>
 
 #include <vector>
 
+#include <stdint.h>
+
 namespace codec
 {
 
@@ -26,7 +29,7 @@ class Mp3 : public BaseCodec
 
 	player::Format getFormat() const override;
 
-	bool decode(float*& samples, size_t& count) override;
+	size_t decodeInto(float* dst, size_t maxFrames) override;
 
 	void seek(off_t sample) override;
 
@@ -35,6 +38,8 @@ class Mp3 : public BaseCodec
     private:
 	// creates the mpg123 handle for the given file
 	void create(bool picture = false);
+	// makes the decoder produce samples with the given encoding
+	bool setupFormats(int encoding);
 
 	void processID3v1(zeppelin::library::Metadata& info, const mpg123_id3v1& id3);
 	void processID3v2(zeppelin::library::Metadata& info, const mpg123_id3v2& id3);
@@ -46,7 +51,9 @@ class Mp3 : public BaseCodec
 	int m_channels;
 	int m_format;
 
-	std::vector<float> m_samples;
+	SampleConverter m_converter;
+	// buffer of 16bit samples waiting for conversion
+	std::vector<int16_t> m_buffer;
 };
 
 }
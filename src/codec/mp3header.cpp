@@ -0,0 +1,271 @@
+/**
+ * This file is part of the Zeppelin music player project.
+ * Copyright (c) 2013-2014 Zoltan Kovacs, Lajos Santa
+ * See http://zeppelin-player.com for more details.
+ */
+
+#include "mp3header.h"
+
+#include <vector>
+#include <algorithm>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+using codec::Mp3Header;
+
+// number of bytes read from the beginning of the audio data, it contains a few frames even at the highest bitrate
+static const size_t s_readSize = 16 * 1024;
+
+// bitrates of layer III in kbit/s for MPEG 1 and MPEG 2/2.5
+static const int s_bitrates[2][15] = {
+    { 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320 },
+    { 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160 }
+};
+
+static const int s_rates[3] = { 44100, 48000, 32000 };
+
+// values of the version field of the frame header
+static const int MPEG25 = 0;
+static const int MPEG1 = 3;
+
+// =====================================================================================================================
+static inline uint32_t readBE32(const uint8_t* p)
+{
+    return (uint32_t(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+// =====================================================================================================================
+static inline uint32_t readLE32(const uint8_t* p)
+{
+    return (uint32_t(p[3]) << 24) | (p[2] << 16) | (p[1] << 8) | p[0];
+}
+
+// =====================================================================================================================
+Mp3Header::Mp3Header()
+    : m_source(NONE),
+      m_rate(0),
+      m_channels(0),
+      m_samples(0)
+{
+}
+
+// =====================================================================================================================
+bool Mp3Header::read(const std::string& file)
+{
+    int fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0)
+	return false;
+
+    struct stat st;
+
+    if (fstat(fd, &st) != 0)
+    {
+	close(fd);
+	return false;
+    }
+
+    int64_t start = 0;
+    int64_t end = st.st_size;
+
+    uint8_t tag[128];
+
+    // skip the ID3v2 tag at the beginning, its size is stored as a 28 bit syncsafe integer
+    if (pread(fd, tag, 10, 0) == 10 && memcmp(tag, "ID3", 3) == 0)
+    {
+	start = 10 + ((tag[6] & 0x7f) << 21) + ((tag[7] & 0x7f) << 14) + ((tag[8] & 0x7f) << 7) + (tag[9] & 0x7f);
+
+	// footer
+	if (tag[5] & 0x10)
+	    start += 10;
+    }
+
+    // ID3v1 tag at the end
+    if (end - start >= 128 && pread(fd, tag, 128, end - 128) == 128 && memcmp(tag, "TAG", 3) == 0)
+	end -= 128;
+
+    // APEv2 tag before the ID3v1 tag, the size in its footer does not contain the optional header
+    if (end - start >= 32 && pread(fd, tag, 32, end - 32) == 32 && memcmp(tag, "APETAGEX", 8) == 0)
+	end -= readLE32(tag + 12) + ((readLE32(tag + 20) & 0x80000000) ? 32 : 0);
+
+    if (end <= start)
+    {
+	close(fd);
+	return false;
+    }
+
+    std::vector<uint8_t> buffer(std::min<int64_t>(s_readSize, end - start));
+    ssize_t size = pread(fd, &buffer[0], buffer.size(), start);
+
+    close(fd);
+
+    if (size <= 0)
+	return false;
+
+    return parse(&buffer[0], size, end - start);
+}
+
+// =====================================================================================================================
+bool Mp3Header::parse(const uint8_t* data, size_t size, int64_t audioSize)
+{
+    m_source = NONE;
+
+    Frame frame;
+    size_t offset;
+
+    // find the first frame, a sync word is accepted only if it is followed by another frame (or the end of the data)
+    for (offset = 0; offset + 4 <= size; ++offset)
+    {
+	if (!decodeFrame(data + offset, frame))
+	    continue;
+
+	size_t next = offset + frame.m_length;
+	Frame nextFrame;
+
+	if (next + 4 > size || (decodeFrame(data + next, nextFrame) && nextFrame.m_rate == frame.m_rate))
+	    break;
+    }
+
+    if (offset + 4 > size)
+	return false;
+
+    m_rate = frame.m_rate;
+    m_channels = frame.m_channels;
+
+    if (parseXing(data + offset, size - offset, frame) || parseVbri(data + offset, size - offset, frame))
+	return true;
+
+    // the stream is CBR if all of the frames in the buffer have the same bitrate
+    for (size_t pos = offset; pos + 4 <= size; )
+    {
+	Frame f;
+
+	if (!decodeFrame(data + pos, f) || f.m_bitrate != frame.m_bitrate)
+	    return false;
+
+	pos += f.m_length;
+    }
+
+    if (audioSize <= static_cast<int64_t>(offset))
+	return false;
+
+    m_samples = (audioSize - offset) * 8 * m_rate / (frame.m_bitrate * 1000);
+    m_source = CBR;
+
+    return true;
+}
+
+// =====================================================================================================================
+auto Mp3Header::getSource() const -> Source
+{
+    return m_source;
+}
+
+// =====================================================================================================================
+int Mp3Header::getRate() const
+{
+    return m_rate;
+}
+
+// =====================================================================================================================
+int Mp3Header::getChannels() const
+{
+    return m_channels;
+}
+
+// =====================================================================================================================
+int64_t Mp3Header::getSamples() const
+{
+    return m_samples;
+}
+
+// =====================================================================================================================
+bool Mp3Header::decodeFrame(const uint8_t* p, Frame& frame)
+{
+    // sync word
+    if (p[0] != 0xff || (p[1] & 0xe0) != 0xe0)
+	return false;
+
+    int version = (p[1] >> 3) & 0x3;
+    int layer = (p[1] >> 1) & 0x3;
+    int bitrate = p[2] >> 4;
+    int rate = (p[2] >> 2) & 0x3;
+
+    // reserved version, not layer III, free format or invalid bitrate, reserved rate
+    if (version == 1 || layer != 1 || bitrate == 0 || bitrate == 15 || rate == 3)
+	return false;
+
+    bool mpeg1 = (version == MPEG1);
+
+    frame.m_version = version;
+    frame.m_bitrate = s_bitrates[mpeg1 ? 0 : 1][bitrate];
+    frame.m_rate = s_rates[rate] >> (mpeg1 ? 0 : (version == MPEG25 ? 2 : 1));
+    frame.m_channels = ((p[3] >> 6) == 3) ? 1 : 2;
+    frame.m_samples = mpeg1 ? 1152 : 576;
+    frame.m_length = (mpeg1 ? 144000 : 72000) * frame.m_bitrate / frame.m_rate + ((p[2] >> 1) & 0x1);
+
+    return true;
+}
+
+// =====================================================================================================================
+bool Mp3Header::parseXing(const uint8_t* p, size_t size, const Frame& frame)
+{
+    // the header is stored after the side information of the first frame
+    size_t offset;
+
+    if (frame.m_version == MPEG1)
+	offset = (frame.m_channels == 1) ? 4 + 17 : 4 + 32;
+    else
+	offset = (frame.m_channels == 1) ? 4 + 9 : 4 + 17;
+
+    if (offset + 12 > size)
+	return false;
+
+    const uint8_t* x = p + offset;
+
+    // Info is written by LAME for CBR streams
+    if (memcmp(x, "Xing", 4) != 0 && memcmp(x, "Info", 4) != 0)
+	return false;
+
+    // the number of frames is optional
+    if ((readBE32(x + 4) & 0x1) == 0)
+	return false;
+
+    uint32_t frames = readBE32(x + 8);
+
+    if (frames == 0)
+	return false;
+
+    m_samples = static_cast<int64_t>(frames) * frame.m_samples;
+    m_source = XING;
+
+    return true;
+}
+
+// =====================================================================================================================
+bool Mp3Header::parseVbri(const uint8_t* p, size_t size, const Frame& frame)
+{
+    // the header is written by the Fraunhofer encoder at a fixed position
+    size_t offset = 4 + 32;
+
+    if (offset + 18 > size)
+	return false;
+
+    const uint8_t* v = p + offset;
+
+    if (memcmp(v, "VBRI", 4) != 0)
+	return false;
+
+    uint32_t frames = readBE32(v + 14);
+
+    if (frames == 0)
+	return false;
+
+    m_samples = static_cast<int64_t>(frames) * frame.m_samples;
+    m_source = VBRI;
+
+    return true;
+}
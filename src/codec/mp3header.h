@@ -0,0 +1,85 @@
+/**
+ * This file is part of the Zeppelin music player project.
+ * Copyright (c) 2013-2014 Zoltan Kovacs, Lajos Santa
+ * See http://zeppelin-player.com for more details.
+ */
+
+#ifndef CODEC_MP3HEADER_H_INCLUDED
+#define CODEC_MP3HEADER_H_INCLUDED
+
+#include <string>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace codec
+{
+
+/**
+ * Determines the length of an MPEG layer III stream from its first frames without decoding the whole file.
+ *
+ * The number of frames is taken from the Xing/Info or the VBRI header of the first frame. Without such a header the
+ * stream is considered CBR if the frames at its beginning have the same bitrate and the length is computed from the
+ * size of the audio data. Otherwise (VBR without a header, free format bitrate, other layers) the length cannot be
+ * determined this way.
+ */
+class Mp3Header
+{
+    public:
+	enum Source
+	{
+	    NONE,
+	    XING,
+	    VBRI,
+	    CBR
+	};
+
+	Mp3Header();
+
+	/// reads the beginning of the file, returns false if the length cannot be determined from the headers
+	bool read(const std::string& file);
+
+	/**
+	 * Parses the beginning of the audio data (after the ID3v2 tag).
+	 * @param size the number of available bytes
+	 * @param audioSize the size of the audio data without the tags
+	 */
+	bool parse(const uint8_t* data, size_t size, int64_t audioSize);
+
+	Source getSource() const;
+
+	int getRate() const;
+	int getChannels() const;
+	/// returns the number of samples per channel
+	int64_t getSamples() const;
+
+    private:
+	struct Frame
+	{
+	    int m_version;
+	    int m_rate;
+	    int m_channels;
+	    // bitrate in kbit/s
+	    int m_bitrate;
+	    int m_samples;
+	    // length of the frame in bytes
+	    size_t m_length;
+	};
+
+	// decodes the 4 byte frame header, returns false if it is not a valid layer III header
+	static bool decodeFrame(const uint8_t* p, Frame& frame);
+
+	bool parseXing(const uint8_t* p, size_t size, const Frame& frame);
+	bool parseVbri(const uint8_t* p, size_t size, const Frame& frame);
+
+    private:
+	Source m_source;
+
+	int m_rate;
+	int m_channels;
+	int64_t m_samples;
+};
+
+}
+
+#endif
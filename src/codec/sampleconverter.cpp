@@ -0,0 +1,637 @@
+/**
+ * This file is part of the Zeppelin music player project.
+ * Copyright (c) 2013-2014 Zoltan Kovacs, Lajos Santa
+ * See http://zeppelin-player.com for more details.
+ */
+
+#include "sampleconverter.h"
+#include "basecodec.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CONVERTER_X86
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#define CONVERTER_NEON
+#include <arm_neon.h>
+#endif
+
+using codec::SampleConverter;
+
+namespace codec
+{
+
+struct ConverterKernels
+{
+    SampleConverter::Implementation m_impl;
+    const char* m_name;
+
+    void (*m_s8)(const int8_t* src, float* dst, size_t count, float scale);
+    void (*m_s16)(const int16_t* src, float* dst, size_t count, float scale);
+    void (*m_s32)(const int32_t* src, float* dst, size_t count, float scale);
+    // interleave the frames of two channels
+    void (*m_s32Stereo)(const int32_t* left, const int32_t* right, float* dst, size_t frames, float scale);
+    void (*m_f32Stereo)(const float* left, const float* right, float* dst, size_t frames);
+};
+
+}
+
+using codec::ConverterKernels;
+
+// =====================================================================================================================
+// scalar implementation, it is the reference of the vectorized ones and handles the tail of the buffers as well
+
+static inline float convertSample(int32_t in, float scale)
+{
+    float out = (float)in / scale;
+
+    if (out > 1.0f)
+	out = 1.0f;
+    else if (out < -1.0f)
+	out = -1.0f;
+
+    return out;
+}
+
+// =====================================================================================================================
+static inline float clampSample(float in)
+{
+    if (in > 1.0f)
+	return 1.0f;
+    else if (in < -1.0f)
+	return -1.0f;
+
+    return in;
+}
+
+// =====================================================================================================================
+template <typename T>
+static inline void convertScalar(const T* src, float* dst, size_t count, float scale)
+{
+    for (size_t i = 0; i < count; ++i)
+	dst[i] = convertSample(src[i], scale);
+}
+
+// =====================================================================================================================
+static inline void convertStereoScalar(const int32_t* left,
+				       const int32_t* right,
+				       float* dst,
+				       size_t frames,
+				       float scale)
+{
+    for (size_t i = 0; i < frames; ++i)
+    {
+	dst[i * 2] = convertSample(left[i], scale);
+	dst[i * 2 + 1] = convertSample(right[i], scale);
+    }
+}
+
+// =====================================================================================================================
+static inline void interleaveScalar(const float* left, const float* right, float* dst, size_t frames)
+{
+    for (size_t i = 0; i < frames; ++i)
+    {
+	dst[i * 2] = clampSample(left[i]);
+	dst[i * 2 + 1] = clampSample(right[i]);
+    }
+}
+
+// =====================================================================================================================
+static void scalarS8(const int8_t* src, float* dst, size_t count, float scale)
+{
+    convertScalar(src, dst, count, scale);
+}
+
+// =====================================================================================================================
+static void scalarS16(const int16_t* src, float* dst, size_t count, float scale)
+{
+    convertScalar(src, dst, count, scale);
+}
+
+// =====================================================================================================================
+static void scalarS32(const int32_t* src, float* dst, size_t count, float scale)
+{
+    convertScalar(src, dst, count, scale);
+}
+
+// =====================================================================================================================
+static void scalarS32Stereo(const int32_t* left, const int32_t* right, float* dst, size_t frames, float scale)
+{
+    convertStereoScalar(left, right, dst, frames, scale);
+}
+
+// =====================================================================================================================
+static void scalarF32Stereo(const float* left, const float* right, float* dst, size_t frames)
+{
+    interleaveScalar(left, right, dst, frames);
+}
+
+static const ConverterKernels s_scalar = {
+    SampleConverter::SCALAR, "scalar", scalarS8, scalarS16, scalarS32, scalarS32Stereo, scalarF32Stereo
+};
+
+#ifdef CONVERTER_X86
+
+// =====================================================================================================================
+// SSE2 implementation
+//
+// The division is kept (instead of multiplying by the reciprocal of the scale) because it makes the results bit
+// identical with the scalar code.
+
+#define TARGET_SSE2 __attribute__((target("sse2")))
+
+TARGET_SSE2 static inline __m128 sse2Clamp(__m128 in)
+{
+    return _mm_min_ps(_mm_max_ps(in, _mm_set1_ps(-1.0f)), _mm_set1_ps(1.0f));
+}
+
+// =====================================================================================================================
+TARGET_SSE2 static inline __m128 sse2Convert(__m128i in, __m128 scale)
+{
+    return sse2Clamp(_mm_div_ps(_mm_cvtepi32_ps(in), scale));
+}
+
+// =====================================================================================================================
+TARGET_SSE2 static void sse2S8(const int8_t* src, float* dst, size_t count, float scale)
+{
+    __m128 s = _mm_set1_ps(scale);
+    size_t i = 0;
+
+    for (; i + 16 <= count; i += 16)
+    {
+	__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+
+	// sign extend the bytes to 16 bits then to 32 bits by shifting them to the top and back
+	__m128i lo = _mm_srai_epi16(_mm_unpacklo_epi8(v, v), 8);
+	__m128i hi = _mm_srai_epi16(_mm_unpackhi_epi8(v, v), 8);
+
+	_mm_storeu_ps(dst + i, sse2Convert(_mm_srai_epi32(_mm_unpacklo_epi16(lo, lo), 16), s));
+	_mm_storeu_ps(dst + i + 4, sse2Convert(_mm_srai_epi32(_mm_unpackhi_epi16(lo, lo), 16), s));
+	_mm_storeu_ps(dst + i + 8, sse2Convert(_mm_srai_epi32(_mm_unpacklo_epi16(hi, hi), 16), s));
+	_mm_storeu_ps(dst + i + 12, sse2Convert(_mm_srai_epi32(_mm_unpackhi_epi16(hi, hi), 16), s));
+    }
+
+    convertScalar(src + i, dst + i, count - i, scale);
+}
+
+// =====================================================================================================================
+TARGET_SSE2 static void sse2S16(const int16_t* src, float* dst, size_t count, float scale)
+{
+    __m128 s = _mm_set1_ps(scale);
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8)
+    {
+	__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+
+	_mm_storeu_ps(dst + i, sse2Convert(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16), s));
+	_mm_storeu_ps(dst + i + 4, sse2Convert(_mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16), s));
+    }
+
+    convertScalar(src + i, dst + i, count - i, scale);
+}
+
+// =====================================================================================================================
+TARGET_SSE2 static void sse2S32(const int32_t* src, float* dst, size_t count, float scale)
+{
+    __m128 s = _mm_set1_ps(scale);
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4)
+	_mm_storeu_ps(dst + i, sse2Convert(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)), s));
+
+    convertScalar(src + i, dst + i, count - i, scale);
+}
+
+// =====================================================================================================================
+TARGET_SSE2 static void sse2S32Stereo(const int32_t* left, const int32_t* right, float* dst, size_t frames, float scale)
+{
+    __m128 s = _mm_set1_ps(scale);
+    size_t i = 0;
+
+    for (; i + 4 <= frames; i += 4)
+    {
+	__m128 l = sse2Convert(_mm_loadu_si128(reinterpret_cast<const __m128i*>(left + i)), s);
+	__m128 r = sse2Convert(_mm_loadu_si128(reinterpret_cast<const __m128i*>(right + i)), s);
+
+	_mm_storeu_ps(dst + i * 2, _mm_unpacklo_ps(l, r));
+	_mm_storeu_ps(dst + i * 2 + 4, _mm_unpackhi_ps(l, r));
+    }
+
+    convertStereoScalar(left + i, right + i, dst + i * 2, frames - i, scale);
+}
+
+// =====================================================================================================================
+TARGET_SSE2 static void sse2F32Stereo(const float* left, const float* right, float* dst, size_t frames)
+{
+    size_t i = 0;
+
+    for (; i + 4 <= frames; i += 4)
+    {
+	__m128 l = sse2Clamp(_mm_loadu_ps(left + i));
+	__m128 r = sse2Clamp(_mm_loadu_ps(right + i));
+
+	_mm_storeu_ps(dst + i * 2, _mm_unpacklo_ps(l, r));
+	_mm_storeu_ps(dst + i * 2 + 4, _mm_unpackhi_ps(l, r));
+    }
+
+    interleaveScalar(left + i, right + i, dst + i * 2, frames - i);
+}
+
+#undef TARGET_SSE2
+
+static const ConverterKernels s_sse2 = {
+    SampleConverter::SSE2, "sse2", sse2S8, sse2S16, sse2S32, sse2S32Stereo, sse2F32Stereo
+};
+
+// =====================================================================================================================
+// AVX2 implementation
+
+#define TARGET_AVX2 __attribute__((target("avx2")))
+
+TARGET_AVX2 static inline __m256 avx2Clamp(__m256 in)
+{
+    return _mm256_min_ps(_mm256_max_ps(in, _mm256_set1_ps(-1.0f)), _mm256_set1_ps(1.0f));
+}
+
+// =====================================================================================================================
+TARGET_AVX2 static inline __m256 avx2Convert(__m256i in, __m256 scale)
+{
+    return avx2Clamp(_mm256_div_ps(_mm256_cvtepi32_ps(in), scale));
+}
+
+// =====================================================================================================================
+TARGET_AVX2 static inline void avx2Interleave(__m256 l, __m256 r, float* dst)
+{
+    // unpacking works inside the 128 bit lanes, the lanes are put into the right order afterwards
+    __m256 lo = _mm256_unpacklo_ps(l, r);
+    __m256 hi = _mm256_unpackhi_ps(l, r);
+
+    _mm256_storeu_ps(dst, _mm256_permute2f128_ps(lo, hi, 0x20));
+    _mm256_storeu_ps(dst + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+}
+
+// =====================================================================================================================
+TARGET_AVX2 static void avx2S8(const int8_t* src, float* dst, size_t count, float scale)
+{
+    __m256 s = _mm256_set1_ps(scale);
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8)
+    {
+	__m128i v = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i));
+	_mm256_storeu_ps(dst + i, avx2Convert(_mm256_cvtepi8_epi32(v), s));
+    }
+
+    convertScalar(src + i, dst + i, count - i, scale);
+}
+
+// =====================================================================================================================
+TARGET_AVX2 static void avx2S16(const int16_t* src, float* dst, size_t count, float scale)
+{
+    __m256 s = _mm256_set1_ps(scale);
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8)
+    {
+	__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+	_mm256_storeu_ps(dst + i, avx2Convert(_mm256_cvtepi16_epi32(v), s));
+    }
+
+    convertScalar(src + i, dst + i, count - i, scale);
+}
+
+// =====================================================================================================================
+TARGET_AVX2 static void avx2S32(const int32_t* src, float* dst, size_t count, float scale)
+{
+    __m256 s = _mm256_set1_ps(scale);
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8)
+	_mm256_storeu_ps(dst + i, avx2Convert(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i)), s));
+
+    convertScalar(src + i, dst + i, count - i, scale);
+}
+
+// =====================================================================================================================
+TARGET_AVX2 static void avx2S32Stereo(const int32_t* left, const int32_t* right, float* dst, size_t frames, float scale)
+{
+    __m256 s = _mm256_set1_ps(scale);
+    size_t i = 0;
+
+    for (; i + 8 <= frames; i += 8)
+    {
+	__m256 l = avx2Convert(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(left + i)), s);
+	__m256 r = avx2Convert(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(right + i)), s);
+
+	avx2Interleave(l, r, dst + i * 2);
+    }
+
+    convertStereoScalar(left + i, right + i, dst + i * 2, frames - i, scale);
+}
+
+// =====================================================================================================================
+TARGET_AVX2 static void avx2F32Stereo(const float* left, const float* right, float* dst, size_t frames)
+{
+    size_t i = 0;
+
+    for (; i + 8 <= frames; i += 8)
+	avx2Interleave(avx2Clamp(_mm256_loadu_ps(left + i)), avx2Clamp(_mm256_loadu_ps(right + i)), dst + i * 2);
+
+    interleaveScalar(left + i, right + i, dst + i * 2, frames - i);
+}
+
+#undef TARGET_AVX2
+
+static const ConverterKernels s_avx2 = {
+    SampleConverter::AVX2, "avx2", avx2S8, avx2S16, avx2S32, avx2S32Stereo, avx2F32Stereo
+};
+
+#endif // CONVERTER_X86
+
+#ifdef CONVERTER_NEON
+
+// =====================================================================================================================
+// NEON implementation
+
+static inline float32x4_t neonClamp(float32x4_t in)
+{
+    return vminq_f32(vmaxq_f32(in, vdupq_n_f32(-1.0f)), vdupq_n_f32(1.0f));
+}
+
+// =====================================================================================================================
+static inline float32x4_t neonConvert(int32x4_t in, float32x4_t scale)
+{
+    return neonClamp(vdivq_f32(vcvtq_f32_s32(in), scale));
+}
+
+// =====================================================================================================================
+static void neonS16x8(int16x8_t v, float* dst, float32x4_t scale)
+{
+    vst1q_f32(dst, neonConvert(vmovl_s16(vget_low_s16(v)), scale));
+    vst1q_f32(dst + 4, neonConvert(vmovl_s16(vget_high_s16(v)), scale));
+}
+
+// =====================================================================================================================
+static void neonS8(const int8_t* src, float* dst, size_t count, float scale)
+{
+    float32x4_t s = vdupq_n_f32(scale);
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8)
+	neonS16x8(vmovl_s8(vld1_s8(src + i)), dst + i, s);
+
+    convertScalar(src + i, dst + i, count - i, scale);
+}
+
+// =====================================================================================================================
+static void neonS16(const int16_t* src, float* dst, size_t count, float scale)
+{
+    float32x4_t s = vdupq_n_f32(scale);
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8)
+	neonS16x8(vld1q_s16(src + i), dst + i, s);
+
+    convertScalar(src + i, dst + i, count - i, scale);
+}
+
+// =====================================================================================================================
+static void neonS32(const int32_t* src, float* dst, size_t count, float scale)
+{
+    float32x4_t s = vdupq_n_f32(scale);
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4)
+	vst1q_f32(dst + i, neonConvert(vld1q_s32(src + i), s));
+
+    convertScalar(src + i, dst + i, count - i, scale);
+}
+
+// =====================================================================================================================
+static void neonS32Stereo(const int32_t* left, const int32_t* right, float* dst, size_t frames, float scale)
+{
+    float32x4_t s = vdupq_n_f32(scale);
+    size_t i = 0;
+
+    for (; i + 4 <= frames; i += 4)
+    {
+	float32x4x2_t lr;
+	lr.val[0] = neonConvert(vld1q_s32(left + i), s);
+	lr.val[1] = neonConvert(vld1q_s32(right + i), s);
+
+	// store the two channels interleaved
+	vst2q_f32(dst + i * 2, lr);
+    }
+
+    convertStereoScalar(left + i, right + i, dst + i * 2, frames - i, scale);
+}
+
+// =====================================================================================================================
+static void neonF32Stereo(const float* left, const float* right, float* dst, size_t frames)
+{
+    size_t i = 0;
+
+    for (; i + 4 <= frames; i += 4)
+    {
+	float32x4x2_t lr;
+	lr.val[0] = neonClamp(vld1q_f32(left + i));
+	lr.val[1] = neonClamp(vld1q_f32(right + i));
+
+	vst2q_f32(dst + i * 2, lr);
+    }
+
+    interleaveScalar(left + i, right + i, dst + i * 2, frames - i);
+}
+
+static const ConverterKernels s_neon = {
+    SampleConverter::NEON, "neon", neonS8, neonS16, neonS32, neonS32Stereo, neonF32Stereo
+};
+
+#endif // CONVERTER_NEON
+
+// =====================================================================================================================
+static const ConverterKernels* getKernels(SampleConverter::Implementation impl)
+{
+    switch (impl)
+    {
+	case SampleConverter::SCALAR :
+	    return &s_scalar;
+
+#ifdef CONVERTER_X86
+	case SampleConverter::SSE2 :
+	    return &s_sse2;
+
+	case SampleConverter::AVX2 :
+	    return &s_avx2;
+#endif
+
+#ifdef CONVERTER_NEON
+	case SampleConverter::NEON :
+	    return &s_neon;
+#endif
+
+	default :
+	    return NULL;
+    }
+}
+
+// =====================================================================================================================
+static const ConverterKernels* detectKernels()
+{
+    static const SampleConverter::Implementation s_preferred[] = {
+	SampleConverter::AVX2,
+	SampleConverter::SSE2,
+	SampleConverter::NEON
+    };
+
+    for (SampleConverter::Implementation impl : s_preferred)
+    {
+	if (SampleConverter::isSupported(impl))
+	    return getKernels(impl);
+    }
+
+    return &s_scalar;
+}
+
+// =====================================================================================================================
+SampleConverter::SampleConverter()
+{
+    // the detection is performed only once
+    static const ConverterKernels* s_detected = detectKernels();
+
+    m_kernels = s_detected;
+}
+
+// =====================================================================================================================
+SampleConverter::SampleConverter(Implementation impl)
+{
+    if (!isSupported(impl))
+	throw CodecException("unsupported sample converter implementation");
+
+    m_kernels = getKernels(impl);
+}
+
+// =====================================================================================================================
+bool SampleConverter::isSupported(Implementation impl)
+{
+    if (!getKernels(impl))
+	return false;
+
+    switch (impl)
+    {
+#ifdef CONVERTER_X86
+	case SSE2 :
+	    __builtin_cpu_init();
+	    return __builtin_cpu_supports("sse2");
+
+	case AVX2 :
+	    __builtin_cpu_init();
+	    return __builtin_cpu_supports("avx2");
+#endif
+
+	default :
+	    // scalar and NEON (on AArch64) implementations are always available
+	    return true;
+    }
+}
+
+// =====================================================================================================================
+auto SampleConverter::getImplementation() const -> Implementation
+{
+    return m_kernels->m_impl;
+}
+
+// =====================================================================================================================
+const char* SampleConverter::getName() const
+{
+    return m_kernels->m_name;
+}
+
+// =====================================================================================================================
+void SampleConverter::s8(const int8_t* src, float* dst, size_t count, float scale) const
+{
+    m_kernels->m_s8(src, dst, count, scale);
+}
+
+// =====================================================================================================================
+void SampleConverter::s16(const int16_t* src, float* dst, size_t count, float scale) const
+{
+    m_kernels->m_s16(src, dst, count, scale);
+}
+
+// =====================================================================================================================
+void SampleConverter::s24(const uint8_t* src, float* dst, size_t count, float scale) const
+{
+    const size_t chunk = 256;
+    int32_t buffer[chunk];
+
+    // unpack the samples into 32 bit integers and convert them in chunks
+    while (count > 0)
+    {
+	size_t n = count < chunk ? count : chunk;
+
+	for (size_t i = 0; i < n; ++i, src += 3)
+	{
+	    // put the sample to the top of the integer and shift it back to get the sign extended value
+	    uint32_t v = (uint32_t)src[0] << 8 | (uint32_t)src[1] << 16 | (uint32_t)src[2] << 24;
+	    buffer[i] = (int32_t)v >> 8;
+	}
+
+	m_kernels->m_s32(buffer, dst, n, scale);
+
+	dst += n;
+	count -= n;
+    }
+}
+
+// =====================================================================================================================
+void SampleConverter::s32(const int32_t* src, float* dst, size_t count, float scale) const
+{
+    m_kernels->m_s32(src, dst, count, scale);
+}
+
+// =====================================================================================================================
+void SampleConverter::s32Planar(const int32_t* const* src,
+				unsigned channels,
+				float* dst,
+				size_t frames,
+				float scale) const
+{
+    switch (channels)
+    {
+	case 1 :
+	    m_kernels->m_s32(src[0], dst, frames, scale);
+	    break;
+
+	case 2 :
+	    m_kernels->m_s32Stereo(src[0], src[1], dst, frames, scale);
+	    break;
+
+	default :
+	    for (size_t i = 0; i < frames; ++i)
+	    {
+		for (unsigned ch = 0; ch < channels; ++ch)
+		    *dst++ = convertSample(src[ch][i], scale);
+	    }
+	    break;
+    }
+}
+
+// =====================================================================================================================
+void SampleConverter::f32Planar(const float* const* src, unsigned channels, float* dst, size_t frames) const
+{
+    switch (channels)
+    {
+	case 2 :
+	    m_kernels->m_f32Stereo(src[0], src[1], dst, frames);
+	    break;
+
+	default :
+	    for (size_t i = 0; i < frames; ++i)
+	    {
+		for (unsigned ch = 0; ch < channels; ++ch)
+		    *dst++ = clampSample(src[ch][i]);
+	    }
+	    break;
+    }
+}
@@ -0,0 +1,68 @@
+/**
+ * This file is part of the Zeppelin music player project.
+ * Copyright (c) 2013-2014 Zoltan Kovacs, Lajos Santa
+ * See http://zeppelin-player.com for more details.
+ */
+
+#ifndef CODEC_SAMPLECONVERTER_H_INCLUDED
+#define CODEC_SAMPLECONVERTER_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace codec
+{
+
+struct ConverterKernels;
+
+/**
+ * Converts integer samples decoded by the codecs to floats.
+ *
+ * Every integer sample is divided by the given scale and clamped to the -1.0 ... 1.0 range. The vectorized
+ * implementations produce exactly the same results as the scalar one, the best one supported by the CPU is selected at
+ * runtime.
+ */
+class SampleConverter
+{
+    public:
+	enum Implementation
+	{
+	    SCALAR,
+	    SSE2,
+	    AVX2,
+	    NEON
+	};
+
+	/// creates a converter using the best implementation supported by the CPU
+	SampleConverter();
+	/**
+	 * Creates a converter using the given implementation.
+	 * CodecException is thrown if the implementation is not supported by the CPU.
+	 */
+	SampleConverter(Implementation impl);
+
+	static bool isSupported(Implementation impl);
+
+	Implementation getImplementation() const;
+	const char* getName() const;
+
+	/// converts count interleaved samples
+	void s8(const int8_t* src, float* dst, size_t count, float scale) const;
+	void s16(const int16_t* src, float* dst, size_t count, float scale) const;
+	/// 24 bit samples are packed into 3 bytes in little endian order
+	void s24(const uint8_t* src, float* dst, size_t count, float scale) const;
+	void s32(const int32_t* src, float* dst, size_t count, float scale) const;
+
+	/// converts frames of planar samples (one buffer per channel) into interleaved ones
+	void s32Planar(const int32_t* const* src, unsigned channels, float* dst, size_t frames, float scale) const;
+	/// interleaves frames of planar float samples, they are only clamped without scaling
+	void f32Planar(const float* const* src, unsigned channels, float* dst, size_t frames) const;
+
+    private:
+	// function table of the selected implementation
+	const ConverterKernels* m_kernels;
+};
+
+}
+
+#endif
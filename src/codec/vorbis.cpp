@@ -10,8 +10,6 @@
 
 #include <zeppelin/logger.h>
 
-#include <endian.h>
-
 using codec::Vorbis;
 
 // =====================================================================================================================
@@ -60,67 +58,32 @@ player::Format Vorbis::getFormat() const
 }
 
 // =====================================================================================================================
-bool Vorbis::decode(float*& samples, size_t& count)
+size_t Vorbis::decodeInto(float* dst, size_t maxFrames)
 {
-    int bitstream;
-    char buf[BUFFER_SIZE];
-
-    long ret = ov_read(
-	&m_vf,
-	buf,
-	BUFFER_SIZE,
-#if __BYTE_ORDER == __LITTLE_ENDIAN
-	0,
-#elif __BYTE_ORDER == __BIG_ENDIAN
-	1,
-#else
-#error "invalid endian"
-#endif
-	2, /* 16 bit samples */
-	1, /* signed samples */
-	&bitstream);
+    size_t frames = 0;
 
-    switch (ret)
+    while (frames < maxFrames)
     {
-	case OV_HOLE :
-	case OV_EBADLINK :
-	    // TODO: treat OV_EBADLINK as an error?
-	    count = 0;
-	    return true;
-
-	case OV_EINVAL :
-	    // something invalid happened
-	    return false;
-
-	case 0 :
-	    // end of file
-	    return false;
-    }
+	int bitstream;
+	float** pcm;
 
-    // make sure we got valid amount of data
-    if (ret % (2 /* bytes per sample */ * m_channels) != 0)
-	throw CodecException("invalid amount of decoded data");
+	// decode float samples directly, they are returned in a separate buffer for each channel
+	long ret = ov_read_float(&m_vf, &pcm, maxFrames - frames, &bitstream);
 
-    // allocate buffer for float samples
-    m_samples.resize(ret / 2);
-
-    for (long i = 0; i < ret; i += 2)
-    {
-	int16_t* p = reinterpret_cast<int16_t*>(&buf[i]);
-	float f = *p / 32767.0f;
+	if (ret == OV_HOLE || ret == OV_EBADLINK)
+	    // TODO: treat OV_EBADLINK as an error?
+	    continue;
 
-	if (f > 1.0f)
-	    f = 1.0f;
-	else if (f < -1.0f)
-	    f = -1.0f;
+	if (ret <= 0)
+	    // end of file or something invalid happened
+	    break;
 
-	m_samples[i / 2] = f;
+	// append the samples to the interleaved buffer
+	m_converter.f32Planar(pcm, m_channels, dst + frames * m_channels, ret);
+	frames += ret;
     }
 
-    samples = &m_samples[0];
-    count = m_samples.size() / 2;
-
-    return true;
+    return frames;
 }
 
 // =====================================================================================================================
@@ -8,6 +8,7 @@
 #define CODEC_VORBIS_H_INCLUDED
 
 #include "basecodec.h"
+#include "sampleconverter.h"
 
 #include <vorbis/vorbisfile.h>
 
@@ -26,7 +27,7 @@ class Vorbis : public BaseCodec
 
 	player::Format getFormat() const override;
 
-	bool decode(float*& samples, size_t& count) override;
+	size_t decodeInto(float* dst, size_t maxFrames) override;
 
 	void seek(off_t sample) override;
 
@@ -40,9 +41,7 @@ class Vorbis : public BaseCodec
 	int m_rate;
 	int m_channels;
 
-	std::vector<float> m_samples;
-
-	static const size_t BUFFER_SIZE = 4096;
+	SampleConverter m_converter;
 };
 
 }
@@ -8,6 +8,8 @@
 
 #include <zeppelin/logger.h>
 
+#include <algorithm>
+
 using codec::WavPack;
 
 // =====================================================================================================================
@@ -68,14 +70,9 @@ player::Format WavPack::getFormat() const
 }
 
 // =====================================================================================================================
-bool WavPack::decode(float*& samples, size_t& count)
+size_t WavPack::decodeInto(float* dst, size_t maxFrames)
 {
-    bool ret = m_floatMode ? decodeFloat(count) : decodeInt(count);
-
-    if (ret)
-	samples = &m_samples[0];
-
-    return ret;
+    return m_floatMode ? decodeFloat(dst, maxFrames) : decodeInt(dst, maxFrames);
 }
 
 // =====================================================================================================================
@@ -104,42 +101,31 @@ std::unique_ptr<zeppelin::library::Metadata> WavPack::readMetadata()
 }
 
 // =====================================================================================================================
-bool WavPack::decodeInt(size_t& count)
+size_t WavPack::decodeInt(float* dst, size_t maxFrames)
 {
     int32_t buffer[4096];
+    size_t frames = 0;
 
-    count = WavpackUnpackSamples(m_context, buffer, sizeof(buffer) / sizeof(int32_t) / m_channels);
-
-    if (count == 0)
-	return false;
-
-    m_samples.resize(count * m_channels);
-
-    for (size_t i = 0; i < m_samples.size(); ++i)
+    while (frames < maxFrames)
     {
-	float f = (float)buffer[i] / m_scale;
+	size_t count = std::min(maxFrames - frames, sizeof(buffer) / sizeof(int32_t) / m_channels);
+
+	count = WavpackUnpackSamples(m_context, buffer, count);
 
-	if (f > 1.0f)
-	    f = 1.0f;
-	else if (f < -1.0f)
-	    f = -1.0f;
+	if (count == 0)
+	    break;
 
-	m_samples[i] = f;
+	m_converter.s32(buffer, dst + frames * m_channels, count * m_channels, m_scale);
+	frames += count;
     }
 
-    return true;
+    return frames;
 }
 
 // =====================================================================================================================
-bool WavPack::decodeFloat(size_t& count)
+size_t WavPack::decodeFloat(float* dst, size_t maxFrames)
 {
-    m_samples.resize(1024 * 2 /* 2 channels at most for now */);
-
-    // in float mode we can directly decode into the float buffer
-    count = WavpackUnpackSamples(
-	m_context,
-	reinterpret_cast<int32_t*>(&m_samples[0]),
-	m_samples.size() / m_channels);
-
-    return count > 0;
+    // in float mode we can directly decode into the buffer of the caller, less samples are unpacked only at the end
+    // of the file
+    return WavpackUnpackSamples(m_context, reinterpret_cast<int32_t*>(dst), maxFrames);
 }
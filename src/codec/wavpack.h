@@ -8,6 +8,7 @@
 #define CODEC_WAVPACK_H_INCLUDED
 
 #include "basecodec.h"
+#include "sampleconverter.h"
 
 #include <wavpack/wavpack.h>
 
@@ -26,15 +27,15 @@ class WavPack : public BaseCodec
 
 	player::Format getFormat() const override;
 
-	bool decode(float*& samples, size_t& count) override;
+	size_t decodeInto(float* dst, size_t maxFrames) override;
 
 	void seek(off_t sample) override;
 
 	std::unique_ptr<zeppelin::library::Metadata> readMetadata() override;
 
     private:
-	bool decodeInt(size_t& count);
-	bool decodeFloat(size_t& count);
+	size_t decodeInt(float* dst, size_t maxFrames);
+	size_t decodeFloat(float* dst, size_t maxFrames);
 
     private:
 	WavpackContext* m_context;
@@ -46,7 +47,7 @@ class WavPack : public BaseCodec
 
 	unsigned m_scale;
 
-	std::vector<float> m_samples;
+	SampleConverter m_converter;
 };
 
 }
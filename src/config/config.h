@@ -12,6 +12,8 @@
 #include <string>
 #include <vector>
 #include <unordered_map>
+#include <thread>
+#include <algorithm>
 
 namespace config
 {
@@ -25,14 +27,43 @@ struct Plugins
 
 struct Library
 {
+    Library()
+	: m_scannerThreads(4),
+	  m_metaParserThreads(std::max(1u, std::thread::hardware_concurrency())),
+	  m_watch(false)
+    {}
+
     std::vector<std::string> m_roots;
     std::string m_database;
+    // directory of the album pictures
+    std::string m_pictureDirectory;
+    // number of threads walking the directories in parallel
+    unsigned m_scannerThreads;
+    // number of threads parsing the metadata of the files
+    unsigned m_metaParserThreads;
+    // apply the changes of the directories to the library as they happen
+    bool m_watch;
+};
+
+struct Cache
+{
+    Cache()
+	: m_memoryLimit(64 * 1024 * 1024),
+	  m_diskLimit(512 * 1024 * 1024)
+    {}
+
+    // memory budget of the decoded sample cache in bytes, 0 turns off the cache
+    size_t m_memoryLimit;
+    // directory for blocks evicted from the memory, the disk tier is not used if it is empty
+    std::string m_directory;
+    size_t m_diskLimit;
 };
 
 struct Config
 {
     Plugins m_plugins;
     Library m_library;
+    Cache m_cache;
 
     Json::Value m_raw;
 };
@@ -48,6 +48,10 @@ config::Config Parser::parse() const
 
     parseLibrary(root["library"], cfg.m_library);
 
+    // cache section
+    if (root.isMember("cache") && root["cache"].isObject())
+	parseCache(root["cache"], cfg.m_cache);
+
     return cfg;
 }
 
@@ -108,4 +112,59 @@ void Parser::parseLibrary(const Json::Value& config, Library& library) const
     // database
     if (config.isMember("database") && config["database"].isString())
 	library.m_database = config["database"].asString();
+
+    // picture-directory
+    if (config.isMember("picture-directory") && config["picture-directory"].isString())
+	library.m_pictureDirectory = config["picture-directory"].asString();
+
+    // scanner-threads
+    if (config.isMember("scanner-threads"))
+    {
+	if (!config["scanner-threads"].isUInt() || config["scanner-threads"].asUInt() == 0)
+	    throw ConfigException("invalid scanner-threads for library");
+
+	library.m_scannerThreads = config["scanner-threads"].asUInt();
+    }
+
+    // metaparser-threads
+    if (config.isMember("metaparser-threads"))
+    {
+	if (!config["metaparser-threads"].isUInt() || config["metaparser-threads"].asUInt() == 0)
+	    throw ConfigException("invalid metaparser-threads for library");
+
+	library.m_metaParserThreads = config["metaparser-threads"].asUInt();
+    }
+
+    // watch
+    if (config.isMember("watch"))
+    {
+	if (!config["watch"].isBool())
+	    throw ConfigException("invalid watch for library");
+
+	library.m_watch = config["watch"].asBool();
+    }
+}
+
+// =====================================================================================================================
+void Parser::parseCache(const Json::Value& config, Cache& cache) const
+{
+    // limits are configured in megabytes
+    if (config.isMember("memory-limit"))
+    {
+	if (!config["memory-limit"].isUInt())
+	    throw ConfigException("invalid memory-limit for cache");
+
+	cache.m_memoryLimit = static_cast<size_t>(config["memory-limit"].asUInt()) * 1024 * 1024;
+    }
+
+    if (config.isMember("directory") && config["directory"].isString())
+	cache.m_directory = config["directory"].asString();
+
+    if (config.isMember("disk-limit"))
+    {
+	if (!config["disk-limit"].isUInt())
+	    throw ConfigException("invalid disk-limit for cache");
+
+	cache.m_diskLimit = static_cast<size_t>(config["disk-limit"].asUInt()) * 1024 * 1024;
+    }
 }
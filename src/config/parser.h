@@ -33,6 +33,7 @@ class Parser
     private:
 	void parsePlugins(const Json::Value& config, Plugins& plugins) const;
 	void parseLibrary(const Json::Value& config, Library& library) const;
+	void parseCache(const Json::Value& config, Cache& cache) const;
 
     private:
 	std::string m_file;
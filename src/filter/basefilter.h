@@ -41,6 +41,10 @@ class BaseFilter
 
 	virtual void run(float*& samples, size_t& count, const player::Format& format) = 0;
 
+	// drops the internal state of the filter belonging to the previous samples (e.g. after seeking)
+	virtual void reset()
+	{}
+
     protected:
 	// returns true in case of configuratio was set for this output
 	bool hasConfig() const;
@@ -0,0 +1,456 @@
+/**
+ * This file is part of the Zeppelin music player project.
+ * Copyright (c) 2013-2014 Zoltan Kovacs, Lajos Santa
+ * See http://zeppelin-player.com for more details.
+ */
+
+#include "polyphase.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define POLYPHASE_X86
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#define POLYPHASE_NEON
+#include <arm_neon.h>
+#endif
+
+using filter::Polyphase;
+using codec::SampleConverter;
+
+namespace filter
+{
+
+struct PolyphaseKernels
+{
+    const char* m_name;
+
+    // calculates one output frame from n interleaved input samples and the coefficients belonging to them
+    void (*m_dot)(const float* x, const float* h, size_t n, unsigned channels, float* out);
+};
+
+}
+
+using filter::PolyphaseKernels;
+
+// parameters of the filter table for the quality levels
+struct Quality
+{
+    unsigned m_taps;
+    // beta parameter of the Kaiser window
+    double m_beta;
+    // cutoff frequency relative to the lower Nyquist frequency of the two rates
+    double m_cutoff;
+};
+
+static const Quality s_fastest = { 16, 5.0, 0.80 };
+static const Quality s_medium = { 32, 7.0, 0.86 };
+static const Quality s_best = { 64, 9.0, 0.91 };
+
+// =====================================================================================================================
+static unsigned gcd(unsigned a, unsigned b)
+{
+    while (b != 0)
+    {
+	unsigned t = a % b;
+	a = b;
+	b = t;
+    }
+
+    return a;
+}
+
+// =====================================================================================================================
+// zeroth order modified Bessel function of the first kind used by the Kaiser window
+static double bessel0(double x)
+{
+    double sum = 1.0;
+    double term = 1.0;
+
+    for (int k = 1; k < 50 && term > sum * 1e-12; ++k)
+    {
+	term *= (x / (2.0 * k)) * (x / (2.0 * k));
+	sum += term;
+    }
+
+    return sum;
+}
+
+// =====================================================================================================================
+static void scalarDot(const float* x, const float* h, size_t n, unsigned channels, float* out)
+{
+    for (unsigned c = 0; c < channels; ++c)
+	out[c] = 0.0f;
+
+    for (size_t i = 0; i < n; i += channels)
+    {
+	for (unsigned c = 0; c < channels; ++c)
+	    out[c] += x[i + c] * h[i + c];
+    }
+}
+
+static const PolyphaseKernels s_scalar = { "scalar", scalarDot };
+
+#ifdef POLYPHASE_X86
+
+// =====================================================================================================================
+// SSE2 implementation
+
+#define TARGET_SSE2 __attribute__((target("sse2")))
+
+// sums the lanes belonging to the same channel without going through the memory
+TARGET_SSE2 static inline void sse2Reduce(__m128 acc, unsigned channels, float* out)
+{
+    if (channels == 4)
+    {
+	_mm_storeu_ps(out, acc);
+	return;
+    }
+
+    acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+
+    if (channels == 2)
+    {
+	_mm_storel_pi(reinterpret_cast<__m64*>(out), acc);
+	return;
+    }
+
+    _mm_store_ss(out, _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1)));
+}
+
+// =====================================================================================================================
+TARGET_SSE2 static void sse2Dot(const float* x, const float* h, size_t n, unsigned channels, float* out)
+{
+    // every lane has to belong to the same channel in each step
+    if (4 % channels != 0)
+    {
+	scalarDot(x, h, n, channels, out);
+	return;
+    }
+
+    // two accumulators to hide the latency of the additions
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8)
+    {
+	acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(x + i), _mm_loadu_ps(h + i)));
+	acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(x + i + 4), _mm_loadu_ps(h + i + 4)));
+    }
+
+    sse2Reduce(_mm_add_ps(acc0, acc1), channels, out);
+
+    for (; i < n; ++i)
+	out[i % channels] += x[i] * h[i];
+}
+
+#undef TARGET_SSE2
+
+static const PolyphaseKernels s_sse2 = { "sse2", sse2Dot };
+
+// =====================================================================================================================
+// AVX2 implementation
+
+#define TARGET_AVX2 __attribute__((target("avx2")))
+
+TARGET_AVX2 static void avx2Dot(const float* x, const float* h, size_t n, unsigned channels, float* out)
+{
+    if (8 % channels != 0)
+    {
+	scalarDot(x, h, n, channels, out);
+	return;
+    }
+
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    size_t i = 0;
+
+    for (; i + 16 <= n; i += 16)
+    {
+	acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(_mm256_loadu_ps(x + i), _mm256_loadu_ps(h + i)));
+	acc1 = _mm256_add_ps(acc1, _mm256_mul_ps(_mm256_loadu_ps(x + i + 8), _mm256_loadu_ps(h + i + 8)));
+    }
+
+    __m256 acc = _mm256_add_ps(acc0, acc1);
+
+    if (channels == 8)
+	_mm256_storeu_ps(out, acc);
+    else
+	sse2Reduce(_mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1)), channels, out);
+
+    for (; i < n; ++i)
+	out[i % channels] += x[i] * h[i];
+}
+
+#undef TARGET_AVX2
+
+static const PolyphaseKernels s_avx2 = { "avx2", avx2Dot };
+
+#endif // POLYPHASE_X86
+
+#ifdef POLYPHASE_NEON
+
+// =====================================================================================================================
+// NEON implementation
+
+// sums the lanes of the accumulators belonging to the same channel
+static inline void reduceLanes(const float* lanes, unsigned width, unsigned channels, float* out)
+{
+    for (unsigned c = 0; c < channels; ++c)
+	out[c] = 0.0f;
+
+    for (unsigned i = 0; i < width; i += channels)
+    {
+	for (unsigned c = 0; c < channels; ++c)
+	    out[c] += lanes[i + c];
+    }
+}
+
+// =====================================================================================================================
+static void neonDot(const float* x, const float* h, size_t n, unsigned channels, float* out)
+{
+    if (4 % channels != 0)
+    {
+	scalarDot(x, h, n, channels, out);
+	return;
+    }
+
+    float32x4_t acc0 = vdupq_n_f32(0.0f);
+    float32x4_t acc1 = vdupq_n_f32(0.0f);
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8)
+    {
+	acc0 = vmlaq_f32(acc0, vld1q_f32(x + i), vld1q_f32(h + i));
+	acc1 = vmlaq_f32(acc1, vld1q_f32(x + i + 4), vld1q_f32(h + i + 4));
+    }
+
+    float lanes[4];
+    vst1q_f32(lanes, vaddq_f32(acc0, acc1));
+    reduceLanes(lanes, 4, channels, out);
+
+    for (; i < n; ++i)
+	out[i % channels] += x[i] * h[i];
+}
+
+static const PolyphaseKernels s_neon = { "neon", neonDot };
+
+#endif // POLYPHASE_NEON
+
+// =====================================================================================================================
+static const PolyphaseKernels* getKernels(SampleConverter::Implementation impl)
+{
+    switch (impl)
+    {
+	case SampleConverter::SCALAR :
+	    return &s_scalar;
+
+#ifdef POLYPHASE_X86
+	case SampleConverter::SSE2 :
+	    return &s_sse2;
+
+	case SampleConverter::AVX2 :
+	    return &s_avx2;
+#endif
+
+#ifdef POLYPHASE_NEON
+	case SampleConverter::NEON :
+	    return &s_neon;
+#endif
+
+	default :
+	    return &s_scalar;
+    }
+}
+
+// =====================================================================================================================
+Polyphase::Polyphase(int srcRate, int dstRate, const config::Config& config)
+    : BaseFilter(config, "resample"),
+      m_srcRate(srcRate),
+      m_dstRate(dstRate),
+      m_quality(Resample::getQuality(config, "quality", Resample::BEST)),
+      m_up(1),
+      m_down(1),
+      m_taps(0),
+      m_channels(0),
+      m_phase(0),
+      m_kernels(getKernels(SampleConverter().getImplementation()))
+{
+}
+
+// =====================================================================================================================
+Polyphase::Polyphase(int srcRate, int dstRate, const config::Config& config, Resample::Quality quality)
+    : BaseFilter(config, "resample"),
+      m_srcRate(srcRate),
+      m_dstRate(dstRate),
+      m_quality(quality),
+      m_up(1),
+      m_down(1),
+      m_taps(0),
+      m_channels(0),
+      m_phase(0),
+      m_kernels(getKernels(SampleConverter().getImplementation()))
+{
+}
+
+// =====================================================================================================================
+Polyphase::Polyphase(int srcRate, int dstRate, const config::Config& config, SampleConverter::Implementation impl)
+    : BaseFilter(config, "resample"),
+      m_srcRate(srcRate),
+      m_dstRate(dstRate),
+      m_quality(Resample::getQuality(config, "quality", Resample::BEST)),
+      m_up(1),
+      m_down(1),
+      m_taps(0),
+      m_channels(0),
+      m_phase(0)
+{
+    if (!SampleConverter::isSupported(impl))
+	throw FilterException("unsupported polyphase resampler implementation");
+
+    m_kernels = getKernels(impl);
+}
+
+// =====================================================================================================================
+bool Polyphase::isSupported(int srcRate, int dstRate)
+{
+    if (srcRate <= 0 || dstRate <= 0)
+	return false;
+
+    unsigned g = gcd(srcRate, dstRate);
+
+    // the length of the filter is not increased for downsampling, so the ratio is limited in that direction too
+    return dstRate / g <= MAX_PHASES && srcRate <= dstRate * 8;
+}
+
+// =====================================================================================================================
+const char* Polyphase::getName() const
+{
+    return m_kernels->m_name;
+}
+
+// =====================================================================================================================
+void Polyphase::init()
+{
+    if (!isSupported(m_srcRate, m_dstRate))
+	throw FilterException("unsupported resampling ratio");
+
+    unsigned g = gcd(m_srcRate, m_dstRate);
+    m_up = m_dstRate / g;
+    m_down = m_srcRate / g;
+
+    const Quality* quality = &s_best;
+
+    if (m_quality == Resample::FASTEST)
+	quality = &s_fastest;
+    else if (m_quality == Resample::MEDIUM)
+	quality = &s_medium;
+
+    m_taps = quality->m_taps;
+
+    // the cutoff is lowered below the Nyquist frequency of the output in case of downsampling
+    double fc = quality->m_cutoff * std::min(1.0, static_cast<double>(m_up) / m_down);
+    double center = m_taps / 2 - 1;
+    double norm = bessel0(quality->m_beta);
+
+    m_coeffs.resize(m_up * m_taps);
+
+    for (unsigned p = 0; p < m_up; ++p)
+    {
+	float* h = &m_coeffs[p * m_taps];
+	double sum = 0.0;
+
+	for (unsigned k = 0; k < m_taps; ++k)
+	{
+	    // distance of the input frame from the position of the output frame
+	    double x = k - center - static_cast<double>(p) / m_up;
+	    double t = x / (m_taps / 2);
+
+	    double sinc = x == 0.0 ? 1.0 : sin(M_PI * fc * x) / (M_PI * fc * x);
+	    double window = std::abs(t) >= 1.0 ? 0.0 : bessel0(quality->m_beta * sqrt(1.0 - t * t)) / norm;
+
+	    double v = fc * sinc * window;
+
+	    h[k] = v;
+	    sum += v;
+	}
+
+	// every phase is normalized to unity gain to avoid modulating the DC level
+	for (unsigned k = 0; k < m_taps; ++k)
+	    h[k] /= sum;
+    }
+
+    m_channels = 0;
+    m_table.clear();
+}
+
+// =====================================================================================================================
+void Polyphase::run(float*& samples, size_t& count, const player::Format& format)
+{
+    unsigned channels = format.getChannels();
+
+    if (channels != m_channels)
+	setChannels(channels);
+
+    // append the new frames to the ones kept from the previous round
+    m_input.insert(m_input.end(), samples, samples + count * channels);
+
+    size_t frames = m_input.size() / channels;
+    size_t maxFrames = frames * m_up / m_down + 1;
+
+    // the output buffer is grown only, it is not shrunk between the rounds
+    if (m_samples.size() < maxFrames * channels)
+	m_samples.resize(maxFrames * channels);
+
+    size_t n = m_taps * channels;
+    size_t pos = 0;
+    size_t out = 0;
+
+    while (pos + m_taps <= frames)
+    {
+	m_kernels->m_dot(&m_input[pos * channels], &m_table[m_phase * n], n, channels, &m_samples[out * channels]);
+	++out;
+
+	// step to the next output frame avoiding divisions, the ratio is limited so only a few iterations are needed
+	m_phase += m_down;
+
+	while (m_phase >= m_up)
+	{
+	    m_phase -= m_up;
+	    ++pos;
+	}
+    }
+
+    // keep the frames needed for the next output frame, the limited downsampling ratio makes sure pos <= frames
+    m_input.erase(m_input.begin(), m_input.begin() + pos * channels);
+
+    samples = &m_samples[0];
+    count = out;
+}
+
+// =====================================================================================================================
+void Polyphase::reset()
+{
+    m_phase = 0;
+
+    // the first output frame is aligned to the first input frame
+    m_input.assign((m_taps / 2 - 1) * m_channels, 0.0f);
+}
+
+// =====================================================================================================================
+void Polyphase::setChannels(unsigned channels)
+{
+    m_channels = channels;
+    m_table.resize(m_coeffs.size() * channels);
+
+    for (size_t i = 0; i < m_coeffs.size(); ++i)
+    {
+	for (unsigned c = 0; c < channels; ++c)
+	    m_table[i * channels + c] = m_coeffs[i];
+    }
+
+    reset();
+}
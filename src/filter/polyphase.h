@@ -0,0 +1,92 @@
+/**
+ * This file is part of the Zeppelin music player project.
+ * Copyright (c) 2013-2014 Zoltan Kovacs, Lajos Santa
+ * See http://zeppelin-player.com for more details.
+ */
+
+#ifndef FILTER_POLYPHASE_H_INCLUDED
+#define FILTER_POLYPHASE_H_INCLUDED
+
+#include "basefilter.h"
+#include "resample.h"
+
+#include <codec/sampleconverter.h>
+
+#include <vector>
+
+namespace filter
+{
+
+struct PolyphaseKernels;
+
+/**
+ * Resampler using a polyphase FIR filter for rational ratios with a small number of phases (e.g. the 44.1 and 48 kHz
+ * families of rates).
+ *
+ * The windowed sinc filter table of every phase is computed at initialization, so converting a frame costs a single
+ * dot product. The dot products are vectorized with the implementation selected the same way as for
+ * codec::SampleConverter. The quality levels are the same as the ones of the libsamplerate based resampler.
+ */
+class Polyphase : public BaseFilter
+{
+    public:
+	/// creates a resampler with the quality set in the configuration
+	Polyphase(int srcRate, int dstRate, const config::Config& config);
+	Polyphase(int srcRate, int dstRate, const config::Config& config, Resample::Quality quality);
+	/**
+	 * Creates a resampler using the given implementation of the dot products.
+	 * FilterException is thrown if the implementation is not supported by the CPU.
+	 */
+	Polyphase(int srcRate, int dstRate, const config::Config& config, codec::SampleConverter::Implementation impl);
+
+	// returns true if the ratio of the rates can be handled by the filter
+	static bool isSupported(int srcRate, int dstRate);
+
+	const char* getName() const;
+
+	void init() override;
+	void run(float*& samples, size_t& count, const player::Format& format) override;
+	void reset() override;
+
+    private:
+	// builds the filter table of every phase for the given number of channels
+	void setChannels(unsigned channels);
+
+    private:
+	// the maximum number of phases (i.e. the upsampling factor of the reduced ratio)
+	static const unsigned MAX_PHASES = 640;
+
+	int m_srcRate;
+	int m_dstRate;
+
+	Resample::Quality m_quality;
+
+	// reduced resampling ratio, m_up output frames are produced from m_down input frames
+	unsigned m_up;
+	unsigned m_down;
+
+	// number of input frames used for one output frame
+	unsigned m_taps;
+
+	// filter coefficients of the phases (m_taps values per phase)
+	std::vector<float> m_coeffs;
+
+	// the coefficients repeated for each channel to match the layout of the interleaved samples
+	std::vector<float> m_table;
+	unsigned m_channels;
+
+	// phase of the next output frame
+	unsigned m_phase;
+
+	// input frames not consumed yet followed by the new ones
+	std::vector<float> m_input;
+	// buffer for resampled output
+	std::vector<float> m_samples;
+
+	// function table of the selected implementation
+	const PolyphaseKernels* m_kernels;
+};
+
+}
+
+#endif
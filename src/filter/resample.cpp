@@ -5,6 +5,7 @@
  */
 
 #include "resample.h"
+#include "polyphase.h"
 
 #include <zeppelin/logger.h>
 
@@ -17,6 +18,17 @@ Resample::Resample(int srcRate, int dstRate, const config::Config& config)
     : BaseFilter(config, "resample"),
       m_srcRate(srcRate),
       m_dstRate(dstRate),
+      m_quality(getQuality(config, "quality", BEST)),
+      m_src(NULL)
+{
+}
+
+// =====================================================================================================================
+Resample::Resample(int srcRate, int dstRate, const config::Config& config, Quality quality)
+    : BaseFilter(config, "resample"),
+      m_srcRate(srcRate),
+      m_dstRate(dstRate),
+      m_quality(quality),
       m_src(NULL)
 {
 }
@@ -28,13 +40,70 @@ Resample::~Resample()
 	src_delete(m_src);
 }
 
+// =====================================================================================================================
+std::shared_ptr<filter::BaseFilter> Resample::create(int srcRate,
+						     int dstRate,
+						     const config::Config& config,
+						     Quality quality)
+{
+    const Json::Value& cfg = config.m_raw["filter"]["resample"];
+
+    if (cfg.isObject() && cfg.get("engine", "").asString() == "polyphase")
+    {
+	if (Polyphase::isSupported(srcRate, dstRate))
+	    return std::make_shared<Polyphase>(srcRate, dstRate, config, quality);
+
+	LOG("resample: ratio is not supported by the polyphase resampler, using libsamplerate");
+    }
+
+    return std::make_shared<Resample>(srcRate, dstRate, config, quality);
+}
+
+// =====================================================================================================================
+auto Resample::getQuality(const config::Config& config, const std::string& option, Quality def) -> Quality
+{
+    const Json::Value& cfg = config.m_raw["filter"]["resample"];
+
+    if (!cfg.isObject() || !cfg.isMember(option))
+	return def;
+
+    const std::string& quality = cfg[option].asString();
+
+    if (quality == "best")
+	return BEST;
+    else if (quality == "medium")
+	return MEDIUM;
+    else if (quality == "fastest")
+	return FASTEST;
+
+    LOG("resample: invalid " << option << ": " << quality);
+
+    return def;
+}
+
+// =====================================================================================================================
+const char* Resample::getQualityName(Quality quality)
+{
+    switch (quality)
+    {
+	case FASTEST :
+	    return "fastest";
+
+	case MEDIUM :
+	    return "medium";
+
+	default :
+	    return "best";
+    }
+}
+
 // =====================================================================================================================
 void Resample::init()
 {
     int error;
 
     // TODO: remove hardcoded channel count
-    m_src = src_new(getQuality(), 2, &error);
+    m_src = src_new(getConverterType(), 2, &error);
 
     if (!m_src)
 	throw FilterException("m_src is not present");
@@ -50,8 +119,11 @@ void Resample::init()
 // =====================================================================================================================
 void Resample::run(float*& samples, size_t& count, const player::Format& format)
 {
-    // prepare the output buffer to be able to store all of the samples
-    m_samples.resize(count * ceil(m_data.src_ratio) * format.getChannels());
+    // prepare the output buffer to be able to store all of the samples, it is grown only to avoid reallocations
+    size_t size = count * ceil(m_data.src_ratio) * format.getChannels();
+
+    if (m_samples.size() < size)
+	m_samples.resize(size);
 
     m_data.data_in = samples;
     m_data.input_frames = count;
@@ -66,27 +138,23 @@ void Resample::run(float*& samples, size_t& count, const player::Format& format)
 }
 
 // =====================================================================================================================
-int Resample::getQuality() const
+void Resample::reset()
 {
-    // use the best quality if there is no configuration
-    if (!hasConfig())
-	return SRC_SINC_BEST_QUALITY;
-
-    const Json::Value& cfg = getConfig();
-
-    if (!cfg.isMember("quality"))
-	return SRC_SINC_BEST_QUALITY;
-
-    const std::string& quality = cfg["quality"].asString();
+    src_reset(m_src);
+}
 
-    if (quality == "best")
-	return SRC_SINC_BEST_QUALITY;
-    else if (quality == "medium")
-	return SRC_SINC_MEDIUM_QUALITY;
-    else if (quality == "fastest")
-	return SRC_SINC_FASTEST;
+// =====================================================================================================================
+int Resample::getConverterType() const
+{
+    switch (m_quality)
+    {
+	case FASTEST :
+	    return SRC_SINC_FASTEST;
 
-    LOG("resample: invalid quality: " << quality);
+	case MEDIUM :
+	    return SRC_SINC_MEDIUM_QUALITY;
 
-    return SRC_SINC_BEST_QUALITY;
+	default :
+	    return SRC_SINC_BEST_QUALITY;
+    }
 }
@@ -11,6 +11,7 @@
 
 #include <samplerate.h>
 
+#include <memory>
 #include <vector>
 
 namespace filter
@@ -19,14 +20,41 @@ namespace filter
 class Resample : public BaseFilter
 {
     public:
+	enum Quality
+	{
+	    FASTEST,
+	    MEDIUM,
+	    BEST
+	};
+
+	/// creates a resampler with the quality set in the configuration
 	Resample(int srcRate, int dstRate, const config::Config& config);
+	Resample(int srcRate, int dstRate, const config::Config& config, Quality quality);
 	virtual ~Resample();
 
+	/**
+	 * Creates the resampler selected by the "engine" option of the configuration. The built-in polyphase resampler
+	 * is used only for the ratios it supports, libsamplerate is used otherwise.
+	 */
+	static std::shared_ptr<BaseFilter> create(int srcRate,
+						  int dstRate,
+						  const config::Config& config,
+						  Quality quality);
+
+	/**
+	 * Returns the quality set by the given option of the resample configuration.
+	 * The default value is returned if the option is not set or it is invalid.
+	 */
+	static Quality getQuality(const config::Config& config, const std::string& option, Quality def);
+	static const char* getQualityName(Quality quality);
+
 	void init() override;
 	void run(float*& samples, size_t& count, const player::Format& format) override;
+	void reset() override;
 
     private:
-	int getQuality() const;
+	// returns the libsamplerate converter belonging to the quality
+	int getConverterType() const;
 
     private:
 	// source sampling rate
@@ -34,6 +62,8 @@ class Resample : public BaseFilter
 	// destination sampling rate
 	int m_dstRate;
 
+	Quality m_quality;
+
 	SRC_STATE* m_src;
 	SRC_DATA m_data;
 
@@ -38,6 +38,12 @@ bool Volume::setLevel(int level)
     return true;
 }
 
+// =====================================================================================================================
+float Volume::getGain() const
+{
+    return m_level;
+}
+
 // =====================================================================================================================
 void Volume::init()
 {
@@ -22,6 +22,9 @@ class Volume : public BaseFilter
 	int getLevel() const;
 	bool setLevel(int level);
 
+	/// returns the value the samples are multiplied with at the current level
+	float getGain() const;
+
 	void init() override;
 	void run(float*& samples, size_t& count, const player::Format& format) override;
 
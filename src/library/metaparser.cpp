@@ -6,6 +6,7 @@
 
 #include "metaparser.h"
 #include "musiclibrary.h"
+#include "tagreader.h"
 
 #include <codec/codecmanager.h>
 #include <codec/basecodec.h>
@@ -14,12 +15,25 @@
 #include <zeppelin/logger.h>
 #include <zeppelin/library/storage.h>
 
+#include <chrono>
+#include <algorithm>
+
+#include <ctype.h>
+
 using library::MetaParser;
 
+// maximum number of files waiting for parsing
+static const size_t s_maxQueued = 1024;
+
+// files taking longer to parse are logged (in milliseconds)
+static const double s_slowFileTime = 1000.0;
+
 // =====================================================================================================================
 MetaParser::MetaParser(const codec::CodecManager& codecManager,
-		       zeppelin::library::Storage& storage)
-    : m_running(false),
+		       zeppelin::library::Storage& storage,
+		       unsigned threads)
+    : m_busy(0),
+      m_threads(threads),
       m_storage(storage),
       m_codecManager(codecManager)
 {
@@ -29,13 +43,38 @@ MetaParser::MetaParser(const codec::CodecManager& codecManager,
 bool MetaParser::isRunning() const
 {
     thread::BlockLock bl(m_mutex);
-    return m_running;
+    return !m_files.empty() || m_busy > 0;
+}
+
+// =====================================================================================================================
+size_t MetaParser::getQueueSize() const
+{
+    thread::BlockLock bl(m_mutex);
+    return m_files.size();
+}
+
+// =====================================================================================================================
+std::vector<zeppelin::library::MusicLibrary::ParseStatistics> MetaParser::getStatistics() const
+{
+    std::vector<zeppelin::library::MusicLibrary::ParseStatistics> stats;
+
+    thread::BlockLock bl(m_statMutex);
+
+    for (const auto& s : m_statistics)
+	stats.push_back(s.second);
+
+    return stats;
 }
 
 // =====================================================================================================================
 void MetaParser::add(const std::shared_ptr<zeppelin::library::File>& file)
 {
     thread::BlockLock bl(m_mutex);
+
+    // wait for the workers if the queue is full
+    while (m_files.size() >= s_maxQueued)
+	m_spaceCond.wait(m_mutex);
+
     m_files.push_back(file);
     m_cond.signal();
 }
@@ -43,48 +82,89 @@ void MetaParser::add(const std::shared_ptr<zeppelin::library::File>& file)
 // =====================================================================================================================
 void MetaParser::run()
 {
-    // initially fill work queue with files from the database having no metadata...
+    for (unsigned i = 0; i < m_threads; ++i)
     {
-	thread::BlockLock bl(m_mutex);
-
-	auto files = m_storage.getFilesWithoutMetadata();
-	for (const auto& f : files)
-	    m_files.push_back(f);
+	m_workers.emplace_back(new Worker(*this));
+	m_workers.back()->start();
     }
 
+    // fill the work queue with the files from the database having no metadata yet
+    auto files = m_storage.getFilesWithoutMetadata();
+
+    for (const auto& f : files)
+	add(f);
+}
+
+// =====================================================================================================================
+void MetaParser::work()
+{
+    // a batch of storage writes is kept open while there are files to parse
+    bool batch = false;
+
     while (1)
     {
 	std::shared_ptr<zeppelin::library::File> file;
 
 	m_mutex.lock();
 
-	while (m_files.empty())
+	// commit the metadata of the parsed files before waiting for new ones
+	if (m_files.empty() && batch)
 	{
-	    m_running = false;
-	    m_cond.wait(m_mutex);
+	    m_mutex.unlock();
+	    m_storage.endBatch();
+	    batch = false;
+	    m_mutex.lock();
 	}
 
+	while (m_files.empty())
+	    m_cond.wait(m_mutex);
+
 	file = m_files.front();
 	m_files.pop_front();
-	m_running = true;
+	++m_busy;
+	m_spaceCond.signal();
 
 	m_mutex.unlock();
 
-	if (parse(*file))
+	if (!batch)
+	{
+	    m_storage.beginBatch();
+	    batch = true;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	bool success = parse(*file);
+	double time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	if (success)
 	    m_storage.setFileMetadata(*file);
+
+	updateStatistics(*file, success, time);
+
+	thread::BlockLock bl(m_mutex);
+	--m_busy;
     }
 }
 
 // =====================================================================================================================
 bool MetaParser::parse(zeppelin::library::File& file)
 {
-    LOG("metaparser: parsing: " << file.m_path << "/" << file.m_name);
+    std::string path = file.m_path + "/" + file.m_name;
 
-    std::shared_ptr<codec::BaseCodec> codec = m_codecManager.create(file.m_path + "/" + file.m_name);
+    LOG("metaparser: parsing: " << path);
+
+    std::shared_ptr<codec::BaseCodec> codec = m_codecManager.create(path);
 
     if (!codec)
 	return false;
 
+    // the tags are read directly from the file if possible, creating a decoder is much more expensive
+    TagReader reader(path);
+    file.m_metadata = reader.read();
+
+    if (file.m_metadata)
+	return true;
+
     try
     {
 	file.m_metadata = codec->readMetadata();
@@ -95,5 +175,56 @@ bool MetaParser::parse(zeppelin::library::File& file)
 	return false;
     }
 
+    // the codecs of APE and WavPack files read the stream information only
+    reader.readTags(*file.m_metadata);
+
     return true;
 }
+
+// =====================================================================================================================
+void MetaParser::updateStatistics(const zeppelin::library::File& file, bool success, double time)
+{
+    std::string path = file.m_path + "/" + file.m_name;
+
+    if (time >= s_slowFileTime)
+	LOG("metaparser: slow file: " << path << " (" << time << " ms)");
+
+    // the files are grouped by their extension the same way as the codecs are selected
+    std::string codec;
+    size_t dot = file.m_name.rfind('.');
+
+    if (dot != std::string::npos)
+    {
+	codec = file.m_name.substr(dot + 1);
+	std::transform(codec.begin(), codec.end(), codec.begin(), ::tolower);
+    }
+
+    thread::BlockLock bl(m_statMutex);
+
+    auto it = m_statistics.find(codec);
+
+    if (it == m_statistics.end())
+    {
+	it = m_statistics.insert(std::make_pair(codec, zeppelin::library::MusicLibrary::ParseStatistics())).first;
+	it->second.m_codec = codec;
+	it->second.m_files = 0;
+	it->second.m_failures = 0;
+	it->second.m_totalTime = 0.0;
+	it->second.m_maxTime = 0.0;
+    }
+
+    zeppelin::library::MusicLibrary::ParseStatistics& stat = it->second;
+
+    ++stat.m_files;
+
+    if (!success)
+	++stat.m_failures;
+
+    stat.m_totalTime += time;
+
+    if (time > stat.m_maxTime)
+    {
+	stat.m_maxTime = time;
+	stat.m_slowestFile = path;
+    }
+}
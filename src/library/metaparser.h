@@ -5,7 +5,11 @@
 #include <thread/mutex.h>
 #include <thread/condition.h>
 
+#include <zeppelin/library/musiclibrary.h>
+
 #include <deque>
+#include <vector>
+#include <map>
 #include <memory>
 
 namespace zeppelin
@@ -27,30 +31,70 @@ namespace library
 
 class MusicLibrary;
 
+/**
+ * Parses the metadata of the files of the library.
+ *
+ * The files are parsed by a pool of worker threads. The queue of the files is bounded, add() blocks while it is full
+ * to slow down the scanner instead of keeping the files of a big import in the memory. The metadata is written to the
+ * storage in batches while there are files to parse.
+ */
 class MetaParser : public thread::Thread
 {
     public:
 	MetaParser(const codec::CodecManager& codecManager,
-		   zeppelin::library::Storage& storage);
+		   zeppelin::library::Storage& storage,
+		   unsigned threads);
 
 	// returns whether metadata parsing is running
 	bool isRunning() const;
+	// returns the number of files waiting for parsing
+	size_t getQueueSize() const;
+	// returns the parse times of the files by codec
+	std::vector<zeppelin::library::MusicLibrary::ParseStatistics> getStatistics() const;
 
 	void add(const std::shared_ptr<zeppelin::library::File>& file);
 
 	void run() override;
 
     private:
+	class Worker : public thread::Thread
+	{
+	    public:
+		Worker(MetaParser& metaParser)
+		    : m_metaParser(metaParser)
+		{}
+
+		void run() override
+		{ m_metaParser.work(); }
+
+	    private:
+		MetaParser& m_metaParser;
+	};
+
+	// main loop of the worker threads
+	void work();
+
 	bool parse(zeppelin::library::File& file);
 
+	void updateStatistics(const zeppelin::library::File& file, bool success, double time);
+
     private:
 	std::deque<std::shared_ptr<zeppelin::library::File>> m_files;
+	// number of files being parsed by the workers
+	unsigned m_busy;
 
-	thread::Mutex m_mutex;
+	mutable thread::Mutex m_mutex;
+	// signalled when a file is added to the queue
 	thread::Condition m_cond;
+	// signalled when a file is taken from the queue
+	thread::Condition m_spaceCond;
+
+	unsigned m_threads;
+	std::vector<std::unique_ptr<Worker>> m_workers;
 
-	// indicates whether metadata parsing is currently running
-	bool m_running;
+	// parse statistics by codec
+	std::map<std::string, zeppelin::library::MusicLibrary::ParseStatistics> m_statistics;
+	mutable thread::Mutex m_statMutex;
 
 	zeppelin::library::Storage& m_storage;
 
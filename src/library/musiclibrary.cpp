@@ -15,12 +15,18 @@ MusicLibraryImpl::MusicLibraryImpl(const codec::CodecManager& codecManager,
 				   zeppelin::library::Storage& storage,
 				   const config::Library& config)
     : m_roots(config.m_roots),
-      m_scanner(codecManager, storage, *this),
-      m_metaParser(codecManager, storage),
+      m_scanner(codecManager, storage, *this, config.m_scannerThreads),
+      m_metaParser(codecManager, storage, config.m_metaParserThreads),
       m_storage(storage)
 {
     m_scanner.start();
     m_metaParser.start();
+
+    if (config.m_watch)
+    {
+	m_watcher.reset(new Watcher(codecManager, storage, m_scanner, m_metaParser, m_roots));
+	m_watcher->start();
+    }
 }
 
 // =====================================================================================================================
@@ -29,6 +35,8 @@ auto MusicLibraryImpl::getStatus() -> Status
     Status status;
     status.m_scannerRunning = m_scanner.isRunning();
     status.m_metaParserRunning = m_metaParser.isRunning();
+    status.m_metaParserQueue = m_metaParser.getQueueSize();
+    status.m_parseStatistics = m_metaParser.getStatistics();
     return status;
 }
 
@@ -63,10 +71,18 @@ void MusicLibraryImpl::scanningFinished()
     m_storage.deleteNonMarked();
 }
 
+// =====================================================================================================================
+void MusicLibraryImpl::directoryFound(int id, const std::string& path)
+{
+    // watch the directories from their first scan
+    if (m_watcher)
+	m_watcher->add(id, path);
+}
+
 // =====================================================================================================================
 void MusicLibraryImpl::musicFound(const std::shared_ptr<zeppelin::library::File>& file)
 {
-    // add the file into the library and start metadata parsing if it is a new one
+    // add the file into the library and start metadata parsing if it is a new or modified one
     if (m_storage.addFile(*file))
 	m_metaParser.add(file);
 }
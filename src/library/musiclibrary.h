@@ -9,6 +9,7 @@
 
 #include "scanner.h"
 #include "metaparser.h"
+#include "watcher.h"
 
 #include <codec/codecmanager.h>
 #include <config/config.h>
@@ -34,6 +35,7 @@ class MusicLibraryImpl : public zeppelin::library::MusicLibrary,
 
 	void scanningStarted() override;
 	void scanningFinished() override;
+	void directoryFound(int id, const std::string& path) override;
 	void musicFound(const std::shared_ptr<zeppelin::library::File>& file) override;
 
     private:
@@ -42,6 +44,8 @@ class MusicLibraryImpl : public zeppelin::library::MusicLibrary,
 
 	Scanner m_scanner;
 	MetaParser m_metaParser;
+	// only created if watching is enabled
+	std::unique_ptr<Watcher> m_watcher;
 
 	/// music library storage
 	zeppelin::library::Storage& m_storage;
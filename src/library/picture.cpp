@@ -8,11 +8,18 @@
 
 #include <cstring>
 
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
 using zeppelin::library::Picture;
 
 // =====================================================================================================================
 Picture::Picture(const std::string& mimeType, const unsigned char* data, size_t size)
-    : m_mimeType(mimeType)
+    : m_mimeType(mimeType),
+      m_offset(-1),
+      m_size(size)
 {
     m_data.resize(size);
     memcpy(&m_data[0], data, size);
@@ -21,8 +28,48 @@ Picture::Picture(const std::string& mimeType, const unsigned char* data, size_t
 // =====================================================================================================================
 Picture::Picture(const std::string& mimeType, std::vector<unsigned char>&& data)
     : m_mimeType(mimeType),
-      m_data(std::move(data))
+      m_data(std::move(data)),
+      m_offset(-1),
+      m_size(m_data.size())
+{
+}
+
+// =====================================================================================================================
+Picture::Picture(const std::string& mimeType, int64_t offset, size_t size)
+    : m_mimeType(mimeType),
+      m_offset(offset),
+      m_size(size)
+{
+}
+
+// =====================================================================================================================
+Picture::Picture(const std::string& mimeType, const std::string& path)
+    : m_mimeType(mimeType),
+      m_offset(-1),
+      m_size(0),
+      m_path(path)
 {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0)
+	return;
+
+    struct stat st;
+
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+    {
+	size_t size = st.st_size;
+	void* p = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+	if (p != MAP_FAILED)
+	{
+	    m_view.reset(static_cast<const unsigned char*>(p),
+			 [size](const unsigned char* view) { munmap(const_cast<unsigned char*>(view), size); });
+	    m_size = size;
+	}
+    }
+
+    close(fd);
 }
 
 // =====================================================================================================================
@@ -34,5 +81,41 @@ const std::string& Picture::getMimeType() const
 // =====================================================================================================================
 const std::vector<unsigned char>& Picture::getData() const
 {
+    if (m_data.empty() && m_view)
+	m_data.assign(m_view.get(), m_view.get() + m_size);
+
     return m_data;
 }
+
+// =====================================================================================================================
+const unsigned char* Picture::getView() const
+{
+    if (m_view)
+	return m_view.get();
+
+    return m_data.empty() ? nullptr : &m_data[0];
+}
+
+// =====================================================================================================================
+const std::string& Picture::getPath() const
+{
+    return m_path;
+}
+
+// =====================================================================================================================
+bool Picture::isLoaded() const
+{
+    return m_offset == -1;
+}
+
+// =====================================================================================================================
+int64_t Picture::getOffset() const
+{
+    return m_offset;
+}
+
+// =====================================================================================================================
+size_t Picture::getSize() const
+{
+    return m_size;
+}
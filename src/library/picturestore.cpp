@@ -0,0 +1,161 @@
+/**
+ * This file is part of the Zeppelin music player project.
+ * Copyright (c) 2013-2014 Zoltan Kovacs, Lajos Santa
+ * See http://zeppelin-player.com for more details.
+ */
+
+#include "picturestore.h"
+
+#include <zeppelin/logger.h>
+
+#include <vector>
+#include <cstring>
+#include <cstdio>
+
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+using library::PictureStore;
+
+// =====================================================================================================================
+void PictureStore::open(const std::string& directory)
+{
+    m_directory = directory;
+}
+
+// =====================================================================================================================
+std::string PictureStore::add(const unsigned char* data, size_t size, const std::string& mimeType)
+{
+    // the directory is created when the first picture is stored
+    if (mkdir(m_directory.c_str(), 0755) != 0 && errno != EEXIST)
+    {
+	LOG("picturestore: unable to create " << m_directory);
+	return std::string();
+    }
+
+    // FNV-1a hash of the content
+    uint64_t h = 14695981039346656037ull;
+
+    for (size_t i = 0; i < size; ++i)
+    {
+	h ^= data[i];
+	h *= 1099511628211ull;
+    }
+
+    char hash[17];
+    snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(h));
+
+    // the subtype of the MIME type is used as the extension of the file (image/jpeg -> jpeg)
+    std::string extension;
+    std::string::size_type slash = mimeType.find('/');
+
+    if (slash != std::string::npos)
+    {
+	for (size_t i = slash + 1; i < mimeType.size() && isalnum(static_cast<unsigned char>(mimeType[i])); ++i)
+	    extension += tolower(static_cast<unsigned char>(mimeType[i]));
+    }
+
+    if (extension.empty())
+	extension = "bin";
+
+    // the name is extended in the unlikely case of a hash collision
+    for (int i = 0; ; ++i)
+    {
+	std::string name = std::string(hash) + (i > 0 ? "-" + std::to_string(i) : "") + "." + extension;
+	std::string path = getPath(name);
+
+	struct stat st;
+
+	if (stat(path.c_str(), &st) == 0)
+	{
+	    if (isStored(path, data, size))
+		return name;
+
+	    continue;
+	}
+
+	// the picture is written to a temporary file first, readers never see a partially written one
+	std::string tmp = path + ".XXXXXX";
+	std::vector<char> tmpPath(tmp.begin(), tmp.end());
+	tmpPath.push_back('\0');
+
+	int fd = mkstemp(&tmpPath[0]);
+
+	if (fd < 0)
+	{
+	    LOG("picturestore: unable to create " << tmp);
+	    return std::string();
+	}
+
+	bool success = fchmod(fd, 0644) == 0;
+
+	for (size_t written = 0; success && written < size; )
+	{
+	    ssize_t r = write(fd, data + written, size - written);
+
+	    if (r <= 0)
+		success = false;
+	    else
+		written += r;
+	}
+
+	close(fd);
+
+	if (!success || rename(&tmpPath[0], path.c_str()) != 0)
+	{
+	    LOG("picturestore: unable to write " << path);
+	    unlink(&tmpPath[0]);
+	    return std::string();
+	}
+
+	return name;
+    }
+}
+
+// =====================================================================================================================
+std::string PictureStore::getPath(const std::string& name) const
+{
+    return m_directory + "/" + name;
+}
+
+// =====================================================================================================================
+bool PictureStore::isStored(const std::string& path, const unsigned char* data, size_t size)
+{
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0)
+	return false;
+
+    struct stat st;
+
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) != size)
+    {
+	close(fd);
+	return false;
+    }
+
+    if (size == 0)
+    {
+	close(fd);
+	return true;
+    }
+
+    void* p = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    close(fd);
+
+    if (p == MAP_FAILED)
+	return false;
+
+    bool same = memcmp(p, data, size) == 0;
+
+    munmap(p, size);
+
+    return same;
+}
@@ -0,0 +1,43 @@
+/**
+ * This file is part of the Zeppelin music player project.
+ * Copyright (c) 2013-2014 Zoltan Kovacs, Lajos Santa
+ * See http://zeppelin-player.com for more details.
+ */
+
+#ifndef LIBRARY_PICTURESTORE_H_INCLUDED
+#define LIBRARY_PICTURESTORE_H_INCLUDED
+
+#include <string>
+
+#include <stddef.h>
+
+namespace library
+{
+
+/**
+ * Stores the album pictures as files of a directory named by the hash of their content.
+ *
+ * Albums sharing the same picture use the same file. The pictures are handed out as memory mapped files instead of
+ * copying them through the database.
+ */
+class PictureStore
+{
+    public:
+	void open(const std::string& directory);
+
+	/// stores the picture unless it is already stored, returns the name of its file or an empty string on error
+	std::string add(const unsigned char* data, size_t size, const std::string& mimeType);
+
+	std::string getPath(const std::string& name) const;
+
+    private:
+	// returns whether the file exists with the given content
+	static bool isStored(const std::string& path, const unsigned char* data, size_t size);
+
+    private:
+	std::string m_directory;
+};
+
+}
+
+#endif
@@ -8,21 +8,32 @@
 
 #include <codec/codecmanager.h>
 #include <thread/blocklock.h>
+#include <utils/mtime.h>
 
 #include <zeppelin/logger.h>
 #include <zeppelin/library/storage.h>
 
 #include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 
 using library::Scanner;
 
+// the modification time of a directory is recorded only if it is older than this (in nanoseconds), some filesystems
+// store the timestamps with the resolution of a second
+static const int64_t s_mtimeGranularity = 1000000000;
+
 // =====================================================================================================================
 Scanner::Scanner(const codec::CodecManager& codecManager,
 		 zeppelin::library::Storage& storage,
-		 ScannerListener& listener)
-    : m_storage(storage),
+		 ScannerListener& listener,
+		 unsigned threads)
+    : m_pending(0),
+      m_idle(0),
+      m_threads(threads),
+      m_storage(storage),
       m_listener(listener),
       m_running(false),
       m_codecManager(codecManager)
@@ -50,6 +61,15 @@ void Scanner::scan()
     m_cond.signal();
 }
 
+// =====================================================================================================================
+void Scanner::rescan(int id, const std::string& path)
+{
+    thread::BlockLock bl(m_mutex);
+    m_rescans.push_back({id, path});
+    m_commands.push_back(RESCAN);
+    m_cond.signal();
+}
+
 // =====================================================================================================================
 void Scanner::run()
 {
@@ -68,86 +88,271 @@ void Scanner::run()
 	switch (cmd)
 	{
 	    case SCAN :
+	    {
+		std::deque<Directory> paths;
+
+		{
+		    thread::BlockLock bl(m_mutex);
+		    paths.swap(m_paths);
+		}
+
+		// the writes of the scanning are committed in a few transactions
+		m_storage.beginBatch();
+
 		m_listener.scanningStarted();
 		m_running = true;
-		scanDirectories();
+
+		// get the ID of the root directories
+		for (auto& p : paths)
+		    p.m_id = m_storage.ensureDirectory(p.m_path, -1);
+
+		scanDirectories(paths);
 		m_listener.scanningFinished();
 		m_running = false;
+
+		m_storage.endBatch();
 		break;
+	    }
+
+	    case RESCAN :
+	    {
+		std::deque<Directory> dirs;
+
+		{
+		    thread::BlockLock bl(m_mutex);
+		    dirs.swap(m_rescans);
+		}
+
+		m_storage.beginBatch();
+		m_running = true;
+		scanDirectories(dirs);
+		m_running = false;
+		m_storage.endBatch();
+		break;
+	    }
 	}
     }
 }
 
 // =====================================================================================================================
-void Scanner::scanDirectories()
+void Scanner::scanDirectories(const std::deque<Directory>& dirs)
 {
-    std::deque<Directory> paths;
+    // the workers are started at the first scan
+    while (m_workers.size() < m_threads)
+    {
+	m_workers.emplace_back(new Worker(*this));
+	m_workers.back()->start();
+    }
+
+    thread::BlockLock bl(m_workMutex);
 
+    // the roots are scanned in parallel as well
+    for (const auto& d : dirs)
     {
-	thread::BlockLock bl(m_mutex);
-	paths = m_paths;
-	m_paths.clear();
+	m_work.push_back(d);
+	++m_pending;
+	m_workCond.signal();
     }
 
-    // get the ID of the root directories
-    for (auto& p : paths)
-	p.m_id = m_storage.ensureDirectory(p.m_path, -1);
+    while (m_pending > 0)
+	m_doneCond.wait(m_workMutex);
+}
 
-    while (!paths.empty())
+// =====================================================================================================================
+void Scanner::work()
+{
+    while (1)
     {
-	Directory path = paths.front();
-	paths.pop_front();
+	Directory dir;
+
+	{
+	    thread::BlockLock bl(m_workMutex);
+
+	    ++m_idle;
+
+	    while (m_work.empty())
+		m_workCond.wait(m_workMutex);
+
+	    --m_idle;
 
-	scanDirectory(path, paths);
+	    dir = m_work.front();
+	    m_work.pop_front();
+	}
+
+	int fd = open(dir.m_path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+	if (fd < 0)
+	    LOG("scanner: unable to open: " << dir.m_path);
+	else
+	    scanDirectory(fd, dir);
+
+	thread::BlockLock bl(m_workMutex);
+
+	if (--m_pending == 0)
+	    m_doneCond.signal();
     }
 }
 
 // =====================================================================================================================
-void Scanner::scanDirectory(const Directory& path, std::deque<Directory>& paths)
+void Scanner::scanDirectory(int fd, const Directory& dir)
 {
-    LOG("scanner: scanning: " << path.m_path);
+    struct stat st;
+
+    if (fstat(fd, &st) != 0)
+    {
+	LOG("scanner: unable to stat: " << dir.m_path);
+	close(fd);
+	return;
+    }
+
+    {
+	thread::BlockLock bl(m_listenerMutex);
+	m_listener.directoryFound(dir.m_id, dir.m_path);
+    }
 
-    // open the directory
-    DIR* dir = opendir(path.m_path.c_str());
+    // the entries of the directory did not change since the last scan
+    if (m_storage.getDirectoryMtime(dir.m_id) == utils::getMtime(st))
+    {
+	checkDirectory(fd, dir);
+	close(fd);
+	return;
+    }
 
-    if (!dir)
+    LOG("scanner: scanning: " << dir.m_path);
+
+    DIR* d = fdopendir(fd);
+
+    if (!d)
     {
-	LOG("scanner: unable to open: " << path.m_path);
+	LOG("scanner: unable to open: " << dir.m_path);
+	close(fd);
 	return;
     }
 
     // iterate through directory entries
     struct dirent* ent;
 
-    while ((ent = readdir(dir)) != NULL)
+    while ((ent = readdir(d)) != NULL)
     {
-	std::string name = ent->d_name;
+	const char* name = ent->d_name;
 
-	if (name == "." || name == "..")
+	if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
 	    continue;
 
-	struct stat st;
-	std::string p = path.m_path + "/" + name;
-
-	if (stat(p.c_str(), &st) != 0)
-	    continue;
+	struct stat entSt;
+	bool statDone = false;
+	unsigned char type = ent->d_type;
 
-	if (S_ISDIR(st.st_mode))
+	// the type is not provided by some filesystems and symbolic links are followed like before
+	if (type == DT_UNKNOWN || type == DT_LNK)
 	{
-	    int directoryId = m_storage.ensureDirectory(name, path.m_id);
-	    paths.push_back({directoryId, p});
+	    if (fstatat(dirfd(d), name, &entSt, 0) != 0)
+		continue;
+
+	    type = S_ISDIR(entSt.st_mode) ? DT_DIR : DT_REG;
+	    statDone = true;
 	}
+
+	if (type == DT_DIR)
+	    subdirectoryFound(dirfd(d), dir, name);
 	else if (m_codecManager.isMediaFile(name))
 	{
-	    std::shared_ptr<zeppelin::library::File> file = std::make_shared<zeppelin::library::File>(-1);
-	    file->m_directoryId = path.m_id;
-	    file->m_path = path.m_path;
-	    file->m_name = name;
-	    file->m_size = st.st_size;
+	    if (!statDone && fstatat(dirfd(d), name, &entSt, 0) != 0)
+		continue;
 
-	    m_listener.musicFound(file);
+	    fileFound(dir, name, entSt);
 	}
     }
 
-    closedir(dir);
+    closedir(d);
+
+    // The modification time read before the entries is recorded, so the directory is scanned again next time if it
+    // was modified meanwhile. The timestamps of the filesystem are coarser than their unit, so a modification made
+    // right after reading it could keep the same time. A recent one is not recorded to scan the directory again.
+    int64_t mtime = utils::getMtime(st);
+
+    if (utils::getCurrentMtime() - mtime >= s_mtimeGranularity)
+	m_storage.setDirectoryMtime(dir.m_id, mtime);
+}
+
+// =====================================================================================================================
+void Scanner::checkDirectory(int fd, const Directory& dir)
+{
+    // the files are marked at once, only the modified ones are passed to the listener
+    m_storage.markFilesOfDirectory(dir.m_id);
+
+    for (const auto& file : m_storage.getFilesOfDirectory(dir.m_id))
+    {
+	struct stat st;
+
+	if (fstatat(fd, file->m_name.c_str(), &st, 0) != 0)
+	    continue;
+
+	if (st.st_size != file->m_size || utils::getMtime(st) != file->m_mtime)
+	    fileFound(dir, file->m_name.c_str(), st);
+    }
+
+    std::vector<int> ids = m_storage.getSubdirectoryIdsOfDirectory(dir.m_id);
+
+    // subdirectories may have been modified even if their parent was not
+    if (!ids.empty())
+    {
+	for (const auto& sub : m_storage.getDirectories(ids))
+	    subdirectoryFound(fd, dir, sub->m_name.c_str());
+    }
+}
+
+// =====================================================================================================================
+void Scanner::subdirectoryFound(int fd, const Directory& dir, const char* name)
+{
+    Directory sub = {m_storage.ensureDirectory(name, dir.m_id), dir.m_path + "/" + name};
+
+    if (shareDirectory(sub))
+	return;
+
+    // scan the subdirectory right away if the other workers are busy
+    int subFd = openat(fd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+    if (subFd < 0)
+    {
+	LOG("scanner: unable to open: " << sub.m_path);
+	return;
+    }
+
+    scanDirectory(subFd, sub);
+}
+
+// =====================================================================================================================
+void Scanner::fileFound(const Directory& dir, const char* name, const struct stat& st)
+{
+    std::shared_ptr<zeppelin::library::File> file = std::make_shared<zeppelin::library::File>(-1);
+    file->m_directoryId = dir.m_id;
+    file->m_path = dir.m_path;
+    file->m_name = name;
+    file->m_size = st.st_size;
+    file->m_mtime = utils::getMtime(st);
+
+    musicFound(file);
+}
+
+// =====================================================================================================================
+bool Scanner::shareDirectory(const Directory& dir)
+{
+    thread::BlockLock bl(m_workMutex);
+
+    if (m_idle <= m_work.size())
+	return false;
+
+    m_work.push_back(dir);
+    ++m_pending;
+    m_workCond.signal();
+
+    return true;
+}
+
+// =====================================================================================================================
+void Scanner::musicFound(const std::shared_ptr<zeppelin::library::File>& file)
+{
+    thread::BlockLock bl(m_listenerMutex);
+    m_listener.musicFound(file);
 }
@@ -13,9 +13,12 @@
 
 #include <string>
 #include <deque>
+#include <vector>
 #include <memory>
 #include <atomic>
 
+#include <sys/stat.h>
+
 namespace zeppelin
 {
 namespace library
@@ -33,6 +36,10 @@ class CodecManager;
 namespace library
 {
 
+/**
+ * Receives the results of the scanner. The calls of the listener are serialized even if the directories are scanned
+ * by multiple threads.
+ */
 class ScannerListener
 {
     public:
@@ -42,15 +49,30 @@ class ScannerListener
 	virtual void scanningStarted() = 0;
 	virtual void scanningFinished() = 0;
 
+	// called before the entries of a directory are checked
+	virtual void directoryFound(int id, const std::string& path) = 0;
 	virtual void musicFound(const std::shared_ptr<zeppelin::library::File>& file) = 0;
 };
 
+/**
+ * Walks the directory trees of the library.
+ *
+ * The directories are scanned by a pool of worker threads. A worker scans the subdirectories it finds depth-first
+ * relative to the descriptor of their parent, they are handed over to the other workers only if some of them are idle.
+ * The type of the entries is taken from the directory itself where the filesystem provides it, so only the media files
+ * (and the entries of unknown type) are stat'ed.
+ *
+ * Rescans are incremental: the entries of a directory are read only if its modification time changed since the last
+ * scan. Otherwise the files and subdirectories known by the storage are checked, and only the files with a different
+ * size or modification time are reported to the listener.
+ */
 class Scanner : public thread::Thread
 {
     public:
 	Scanner(const codec::CodecManager& codecManager,
 		zeppelin::library::Storage& storage,
-		ScannerListener& listener);
+		ScannerListener& listener,
+		unsigned threads);
 
 	// returns whether scanner is currently running
 	bool isRunning() const;
@@ -59,11 +81,28 @@ class Scanner : public thread::Thread
 
 	// starts directory scanning
 	void scan();
+	/**
+	 * Scans a directory of the storage and its subdirectories for new and modified files. Unlike scan(), the
+	 * listener is not notified about the start and the end of the scanning, so missing files are not removed.
+	 */
+	void rescan(int id, const std::string& path);
 
 	void run() override;
 
     private:
-	void scanDirectories();
+	class Worker : public thread::Thread
+	{
+	    public:
+		Worker(Scanner& scanner)
+		    : m_scanner(scanner)
+		{}
+
+		void run() override
+		{ m_scanner.work(); }
+
+	    private:
+		Scanner& m_scanner;
+	};
 
 	struct Directory
 	{
@@ -73,12 +112,30 @@ class Scanner : public thread::Thread
 	    std::string m_path;
 	};
 
-	void scanDirectory(const Directory& path, std::deque<Directory>& paths);
+	void scanDirectories(const std::deque<Directory>& dirs);
+
+	// main loop of the worker threads
+	void work();
+
+	// scans the directory opened as fd, the descriptor is closed at the end
+	void scanDirectory(int fd, const Directory& dir);
+	// checks the known entries of a directory that was not modified since the last scan
+	void checkDirectory(int fd, const Directory& dir);
+
+	// scans the subdirectory of the directory opened as fd
+	void subdirectoryFound(int fd, const Directory& dir, const char* name);
+	void fileFound(const Directory& dir, const char* name, const struct stat& st);
+
+	// puts the directory into the shared queue if there is an idle worker to scan it
+	bool shareDirectory(const Directory& dir);
+
+	void musicFound(const std::shared_ptr<zeppelin::library::File>& file);
 
     private:
 	enum Command
 	{
-	    SCAN
+	    SCAN,
+	    RESCAN
 	};
 
 	// command queue
@@ -86,10 +143,30 @@ class Scanner : public thread::Thread
 
 	// list of paths that will be scanned
 	std::deque<Directory> m_paths;
+	// directories of the storage that will be rescanned
+	std::deque<Directory> m_rescans;
 
 	thread::Mutex m_mutex;
 	thread::Condition m_cond;
 
+	// directories waiting for a worker
+	std::deque<Directory> m_work;
+	// number of directories queued or being scanned by the workers
+	size_t m_pending;
+	// number of workers waiting for a directory
+	unsigned m_idle;
+
+	thread::Mutex m_workMutex;
+	thread::Condition m_workCond;
+	// signalled when all of the directories are scanned
+	thread::Condition m_doneCond;
+
+	unsigned m_threads;
+	std::vector<std::unique_ptr<Worker>> m_workers;
+
+	// serializes the calls of the listener
+	thread::Mutex m_listenerMutex;
+
 	zeppelin::library::Storage& m_storage;
 	ScannerListener& m_listener;
 
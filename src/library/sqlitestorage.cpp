@@ -8,19 +8,31 @@
 
 #include <config/config.h>
 #include <thread/blocklock.h>
+#include <utils/mtime.h>
 
 #include <zeppelin/logger.h>
 
 #include <sstream>
 #include <cstring>
 
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
 using zeppelin::library::Picture;
 
 using library::SqliteStorage;
 
+// limits of the transactions of the batches
+static const int s_maxBatchWrites = 1000;
+static const std::chrono::milliseconds s_maxBatchTime(1000);
+
 // =====================================================================================================================
 SqliteStorage::SqliteStorage()
-    : m_db(NULL)
+    : m_db(NULL),
+      m_batches(0),
+      m_transaction(false),
+      m_writes(0)
 {
 }
 
@@ -37,6 +49,8 @@ void SqliteStorage::open(const config::Library& config)
     if (sqlite3_open(config.m_database.empty() ? "library.db" : config.m_database.c_str(), &m_db) != SQLITE_OK)
 	throw zeppelin::library::StorageException("unable to open database");
 
+    m_pictureStore.open(config.m_pictureDirectory.empty() ? "pictures" : config.m_pictureDirectory);
+
     // turn synchronous mode off and store journal data in memory to speed-up SQLite
     execute("PRAGMA synchronous = OFF");
     execute("PRAGMA journal_mode = MEMORY");
@@ -65,8 +79,13 @@ void SqliteStorage::open(const config::Library& config)
 	    type TEXT,
 	    mimetype TEXT,
 	    data BLOB,
+	    hash TEXT DEFAULT NULL,
+	    file_id INTEGER DEFAULT NULL,
+	    data_offset INTEGER DEFAULT NULL,
+	    data_length INTEGER DEFAULT NULL,
 	    UNIQUE(album_id, type),
-	    FOREIGN KEY(album_id) REFERENCES albums(id) ON DELETE CASCADE))");
+	    FOREIGN KEY(album_id) REFERENCES albums(id) ON DELETE CASCADE,
+	    FOREIGN KEY(file_id) REFERENCES files(id) ON DELETE SET NULL))");
 
     // directories
     execute(
@@ -75,6 +94,7 @@ void SqliteStorage::open(const config::Library& config)
             parent_id INTEGER DEFAULT NULL,
             name TEXT,
             mark INTEGER DEFAULT 1,
+            mtime INTEGER DEFAULT NULL,
             UNIQUE(parent_id, name),
             FOREIGN KEY(parent_id) REFERENCES directories(id)))");
 
@@ -88,6 +108,7 @@ void SqliteStorage::open(const config::Library& config)
 	    path TEXT,
 	    name TEXT,
 	    size INTEGER,
+	    mtime INTEGER DEFAULT NULL,
 	    length INTEGER DEFAULT NULL,
 	    title TEXT DEFAULT NULL,
 	    year INTEGER DEFAULT NULL,
@@ -103,6 +124,19 @@ void SqliteStorage::open(const config::Library& config)
 	    FOREIGN KEY(directory_id) REFERENCES directories(id)))");
     execute("CREATE INDEX IF NOT EXISTS files_artist_id ON files(artist_id)");
     execute("CREATE INDEX IF NOT EXISTS files_album_id ON files(album_id)");
+    execute("CREATE INDEX IF NOT EXISTS files_directory_id ON files(directory_id)");
+
+    // modification times used by incremental scans were not stored by older versions
+    ensureColumn("directories", "mtime", "INTEGER DEFAULT NULL");
+    ensureColumn("files", "mtime", "INTEGER DEFAULT NULL");
+
+    // older versions stored the data of the pictures during the scan instead of their location in the media files
+    ensureColumn("album_pictures", "file_id", "INTEGER DEFAULT NULL REFERENCES files(id) ON DELETE SET NULL");
+    ensureColumn("album_pictures", "data_offset", "INTEGER DEFAULT NULL");
+    ensureColumn("album_pictures", "data_length", "INTEGER DEFAULT NULL");
+    // the data of the pictures is moved to the picture store from the databases of older versions on request
+    ensureColumn("album_pictures", "hash", "TEXT DEFAULT NULL");
+    execute("CREATE INDEX IF NOT EXISTS album_pictures_file_id ON album_pictures(file_id)");
 
     // playlists
     execute(
@@ -121,14 +155,23 @@ void SqliteStorage::open(const config::Library& config)
     prepareStatement(&m_getDirectory, "SELECT id FROM directories WHERE parent_id IS ? and NAME = ?");
     prepareStatement(&m_addDirectory, "INSERT INTO directories(parent_id, name) VALUES(?, ?)");
     prepareStatement(&m_getSubdirectoryIds, "SELECT id FROM directories WHERE parent_id = ?");
-
-    prepareStatement(&m_newFile, "INSERT OR IGNORE INTO files(path, name, size, directory_id) VALUES(?, ?, ?, ?)");
-    prepareStatement(&m_getFileByPath, "SELECT id FROM files WHERE path = ? AND name = ?");
+    prepareStatement(&m_getDirectoryMtime, "SELECT mtime FROM directories WHERE id = ?");
+    prepareStatement(&m_setDirectoryMtime, "UPDATE directories SET mtime = ? WHERE id = ?");
+
+    prepareStatement(&m_newFile,
+		     "INSERT OR IGNORE INTO files(path, name, size, mtime, directory_id) VALUES(?, ?, ?, ?, ?)");
+    // the metadata of a modified file is cleared to have it parsed again even if the player is restarted meanwhile
+    prepareStatement(&m_updateFile,
+		     R"(UPDATE files
+			SET size = ?, mtime = ?, length = CASE WHEN ? THEN NULL ELSE length END, mark = 1
+			WHERE id = ?)");
+    prepareStatement(&m_getFileByPath, "SELECT id, size, mtime FROM files WHERE path = ? AND name = ?");
     prepareStatement(&m_getFilesWithoutMeta, "SELECT id, directory_id, path, name FROM files WHERE length IS NULL");
     // 'name' is used in ORDER BY to try to keep the order of tracks inside an album according to file naming because
     // it may contain information about the index of the track
     prepareStatement(&m_getFileIdsOfAlbum, "SELECT id FROM files WHERE album_id = ?");
     prepareStatement(&m_getFileIdsOfDirectory, "SELECT id FROM files WHERE directory_id = ?");
+    prepareStatement(&m_getFilesOfDirectory, "SELECT id, path, name, size, mtime FROM files WHERE directory_id = ?");
     prepareStatement(&m_getFileStatistics, "SELECT COUNT(id), SUM(length), SUM(size) FROM files");
 
     prepareStatement(&m_setFileMark, "UPDATE files SET mark = 1 WHERE id = ?");
@@ -141,7 +184,15 @@ void SqliteStorage::open(const config::Library& config)
                      R"(UPDATE files
                         SET artist_id = ?, album_id = ?, title = ?, year = ?, track_index = ?
                         WHERE id = ?)");
-    prepareStatement(&m_addAlbumPicture, "INSERT OR IGNORE INTO album_pictures(album_id, type, mimetype, data) VALUES(?, ?, ?, ?)");
+    prepareStatement(&m_addAlbumPicture,
+		     "INSERT OR IGNORE INTO album_pictures(mimetype, hash, file_id, data_offset, data_length, "
+		     "album_id, type) VALUES(?, ?, ?, ?, ?, ?, ?)");
+    prepareStatement(&m_setAlbumPicture,
+		     "UPDATE album_pictures SET mimetype = ?, hash = ?, file_id = ?, data_offset = ?, data_length = ? "
+		     "WHERE album_id = ? AND type = ? AND hash IS NULL AND data IS NULL AND "
+		     "(file_id IS NULL OR file_id = ?)");
+    prepareStatement(&m_getAlbumPictureData, "SELECT data FROM album_pictures WHERE id = ?");
+    prepareStatement(&m_setAlbumPictureHash, "UPDATE album_pictures SET hash = ?, data = NULL WHERE id = ?");
 
     // artists
     prepareStatement(&m_addArtist, "INSERT OR IGNORE INTO artists(name) VALUES(?)");
@@ -164,9 +215,21 @@ void SqliteStorage::open(const config::Library& config)
     // mark
     prepareStatement(&m_clearFileMarks, "UPDATE files SET mark = 0");
     prepareStatement(&m_clearDirectoryMarks, "UPDATE directories SET mark = 0");
+    prepareStatement(&m_markFilesOfDirectory, "UPDATE files SET mark = 1 WHERE directory_id = ?");
 
     prepareStatement(&m_deleteNonMarkedFiles, "DELETE FROM files WHERE mark = 0");
     prepareStatement(&m_deleteNonMarkedDirectories, "DELETE FROM directories WHERE mark = 0");
+
+    // removing files and directories
+    prepareStatement(&m_removeFile, "DELETE FROM files WHERE directory_id = ? AND name = ?");
+    prepareStatement(&m_removeFilesOfTree,
+		     R"(WITH RECURSIVE tree(id) AS (
+			    SELECT ? UNION ALL SELECT directories.id FROM directories JOIN tree ON parent_id = tree.id)
+			DELETE FROM files WHERE directory_id IN tree)");
+    prepareStatement(&m_removeTree,
+		     R"(WITH RECURSIVE tree(id) AS (
+			    SELECT ? UNION ALL SELECT directories.id FROM directories JOIN tree ON parent_id = tree.id)
+			DELETE FROM directories WHERE id IN tree)");
 }
 
 // =====================================================================================================================
@@ -199,6 +262,22 @@ zeppelin::library::Statistics SqliteStorage::getStatistics()
     return stat;
 }
 
+// =====================================================================================================================
+void SqliteStorage::beginBatch()
+{
+    thread::BlockLock bl(m_mutex);
+    ++m_batches;
+}
+
+// =====================================================================================================================
+void SqliteStorage::endBatch()
+{
+    thread::BlockLock bl(m_mutex);
+
+    if (--m_batches == 0 && m_transaction)
+	commit();
+}
+
 // =====================================================================================================================
 std::vector<std::shared_ptr<zeppelin::library::Directory>> SqliteStorage::getDirectories(const std::vector<int>& ids)
 {
@@ -250,6 +329,7 @@ std::vector<int> SqliteStorage::getSubdirectoryIdsOfDirectory(int id)
 int SqliteStorage::ensureDirectory(const std::string& name, int parentId)
 {
     thread::BlockLock bl(m_mutex);
+    batchWrite();
 
     int id;
 
@@ -286,23 +366,82 @@ int SqliteStorage::ensureDirectory(const std::string& name, int parentId)
     return sqlite3_last_insert_rowid(m_db);
 }
 
+// =====================================================================================================================
+int64_t SqliteStorage::getDirectoryMtime(int id)
+{
+    thread::BlockLock bl(m_mutex);
+
+    StatementHolder stmt(m_getDirectoryMtime);
+    stmt.bindInt(1, id);
+
+    if (stmt.step() == SQLITE_ROW && !stmt.isNull(0))
+	return stmt.getInt64(0);
+
+    return -1;
+}
+
+// =====================================================================================================================
+void SqliteStorage::setDirectoryMtime(int id, int64_t mtime)
+{
+    thread::BlockLock bl(m_mutex);
+    batchWrite();
+
+    StatementHolder stmt(m_setDirectoryMtime);
+    stmt.bindInt64(1, mtime);
+    stmt.bindInt(2, id);
+    stmt.step();
+}
+
 // =====================================================================================================================
 bool SqliteStorage::addFile(zeppelin::library::File& file)
 {
     thread::BlockLock bl(m_mutex);
+    batchWrite();
+
+    int id = -1;
+    int64_t size;
+    int64_t mtime;
 
     // first check whether the file already exists
-    int id = getFileIdByPath(file.m_path, file.m_name);
+    {
+	StatementHolder stmt(m_getFileByPath);
+	stmt.bindText(1, file.m_path);
+	stmt.bindText(2, file.m_name);
+
+	if (stmt.step() == SQLITE_ROW)
+	{
+	    id = stmt.getInt(0);
+	    size = stmt.getInt64(1);
+	    mtime = stmt.isNull(2) ? -1 : stmt.getInt64(2);
+	}
+    }
 
     // the file was found ...
     if (id != -1)
     {
-	// set mark on the file
-	StatementHolder stmt(m_setFileMark);
-	stmt.bindInt(1, id);
+	file.m_id = id;
+
+	// set mark on the file if it was not modified
+	if (size == file.m_size && mtime == file.m_mtime)
+	{
+	    StatementHolder stmt(m_setFileMark);
+	    stmt.bindInt(1, id);
+	    stmt.step();
+
+	    return false;
+	}
+
+	// the modification time of files added by older versions is recorded without parsing them again
+	bool modified = size != file.m_size || mtime != -1;
+
+	StatementHolder stmt(m_updateFile);
+	stmt.bindInt64(1, file.m_size);
+	stmt.bindInt64(2, file.m_mtime);
+	stmt.bindInt(3, modified);
+	stmt.bindInt(4, id);
 	stmt.step();
 
-	return false;
+	return modified;
     }
 
     // add the new file
@@ -311,7 +450,8 @@ bool SqliteStorage::addFile(zeppelin::library::File& file)
 	stmt.bindText(1, file.m_path);
 	stmt.bindText(2, file.m_name);
 	stmt.bindInt64(3, file.m_size);
-	stmt.bindInt(4, file.m_directoryId);
+	stmt.bindInt64(4, file.m_mtime);
+	stmt.bindInt(5, file.m_directoryId);
 	stmt.step();
     }
 
@@ -325,6 +465,7 @@ bool SqliteStorage::addFile(zeppelin::library::File& file)
 void SqliteStorage::clearMark()
 {
     thread::BlockLock bl(m_mutex);
+    batchWrite();
 
     sqlite3_step(m_clearFileMarks);
     sqlite3_reset(m_clearFileMarks);
@@ -332,10 +473,22 @@ void SqliteStorage::clearMark()
     sqlite3_reset(m_clearDirectoryMarks);
 }
 
+// =====================================================================================================================
+void SqliteStorage::markFilesOfDirectory(int directoryId)
+{
+    thread::BlockLock bl(m_mutex);
+    batchWrite();
+
+    StatementHolder stmt(m_markFilesOfDirectory);
+    stmt.bindInt(1, directoryId);
+    stmt.step();
+}
+
 // =====================================================================================================================
 void SqliteStorage::deleteNonMarked()
 {
     thread::BlockLock bl(m_mutex);
+    batchWrite();
 
     sqlite3_step(m_deleteNonMarkedFiles);
     sqlite3_reset(m_deleteNonMarkedFiles);
@@ -343,6 +496,38 @@ void SqliteStorage::deleteNonMarked()
     sqlite3_reset(m_deleteNonMarkedDirectories);
 }
 
+// =====================================================================================================================
+void SqliteStorage::removeFile(int directoryId, const std::string& name)
+{
+    thread::BlockLock bl(m_mutex);
+    batchWrite();
+
+    StatementHolder stmt(m_removeFile);
+    stmt.bindInt(1, directoryId);
+    stmt.bindText(2, name);
+    stmt.step();
+}
+
+// =====================================================================================================================
+void SqliteStorage::removeDirectory(int id)
+{
+    thread::BlockLock bl(m_mutex);
+    batchWrite();
+
+    // the files are removed first because of the foreign key of the directories
+    {
+	StatementHolder stmt(m_removeFilesOfTree);
+	stmt.bindInt(1, id);
+	stmt.step();
+    }
+
+    {
+	StatementHolder stmt(m_removeTree);
+	stmt.bindInt(1, id);
+	stmt.step();
+    }
+}
+
 // =====================================================================================================================
 std::vector<std::shared_ptr<zeppelin::library::File>> SqliteStorage::getFilesWithoutMetadata()
 {
@@ -441,6 +626,30 @@ std::vector<int> SqliteStorage::getFileIdsOfDirectory(int directoryId)
     return fileIds;
 }
 
+// =====================================================================================================================
+std::vector<std::shared_ptr<zeppelin::library::File>> SqliteStorage::getFilesOfDirectory(int directoryId)
+{
+    std::vector<std::shared_ptr<zeppelin::library::File>> files;
+
+    thread::BlockLock bl(m_mutex);
+
+    StatementHolder stmt(m_getFilesOfDirectory);
+    stmt.bindInt(1, directoryId);
+
+    while (stmt.step() == SQLITE_ROW)
+    {
+	std::shared_ptr<zeppelin::library::File> file = std::make_shared<zeppelin::library::File>(stmt.getInt(0));
+	file->m_directoryId = directoryId;
+	file->m_path = stmt.getText(1);
+	file->m_name = stmt.getText(2);
+	file->m_size = stmt.getInt64(3);
+	file->m_mtime = stmt.isNull(4) ? -1 : stmt.getInt64(4);
+	files.push_back(file);
+    }
+
+    return files;
+}
+
 // =====================================================================================================================
 void SqliteStorage::setFileMetadata(const zeppelin::library::File& file)
 {
@@ -448,6 +657,7 @@ void SqliteStorage::setFileMetadata(const zeppelin::library::File& file)
 	throw zeppelin::library::StorageException("file has no metadata");
 
     thread::BlockLock bl(m_mutex);
+    batchWrite();
 
     int artistId = getArtistId(*file.m_metadata);
     int albumId = getAlbumId(artistId, *file.m_metadata);
@@ -471,23 +681,51 @@ void SqliteStorage::setFileMetadata(const zeppelin::library::File& file)
 
     if (albumId != -1)
     {
-	// add pictures
+	// add pictures, only their location is stored for the pictures of the tag reader, the data is moved to the
+	// picture store on the first request
 	for (auto& it : file.m_metadata->getPictures())
 	{
-	    StatementHolder stmt(m_addAlbumPicture);
-	    stmt.bindInt(1, albumId);
-	    switch (it.first)
+	    const Picture& picture = *it.second;
+	    std::string hash;
+
+	    // the pictures loaded by the codecs are stored right away
+	    if (picture.isLoaded())
+	    {
+		hash = m_pictureStore.add(picture.getView(), picture.getSize(), picture.getMimeType());
+
+		if (hash.empty())
+		    continue;
+	    }
+
+	    // the location is updated if the file was modified or removed before the data was loaded
+	    for (sqlite3_stmt* s : { m_setAlbumPicture, m_addAlbumPicture })
 	    {
-		case Picture::FrontCover :
-		    stmt.bindText(2, "frontcover");
-		    break;
-		case Picture::BackCover :
-		    stmt.bindText(2, "backcover");
-		    break;
+		StatementHolder stmt(s);
+		stmt.bindText(1, picture.getMimeType());
+
+		if (picture.isLoaded())
+		{
+		    stmt.bindText(2, hash);
+		    stmt.bindNull(3);
+		    stmt.bindNull(4);
+		    stmt.bindNull(5);
+		}
+		else
+		{
+		    stmt.bindNull(2);
+		    stmt.bindInt(3, file.m_id);
+		    stmt.bindInt64(4, picture.getOffset());
+		    stmt.bindInt64(5, picture.getSize());
+		}
+
+		stmt.bindInt(6, albumId);
+		stmt.bindText(7, getPictureType(it.first));
+
+		if (s == m_setAlbumPicture)
+		    stmt.bindInt(8, file.m_id);
+
+		stmt.step();
 	    }
-	    stmt.bindText(3, it.second->getMimeType());
-	    stmt.bindBlob(4, it.second->getData());
-	    stmt.step();
 	}
     }
 }
@@ -499,6 +737,7 @@ void SqliteStorage::updateFileMetadata(const zeppelin::library::File& file)
 	throw zeppelin::library::StorageException("file has no metadata");
 
     thread::BlockLock bl(m_mutex);
+    singleWrite();
 
     int artistId = getArtistId(*file.m_metadata);
     int albumId = getAlbumId(artistId, *file.m_metadata);
@@ -604,30 +843,129 @@ std::map<int, std::map<Picture::Type, std::shared_ptr<Picture>>> SqliteStorage::
     if (ids.empty())
 	return result;
 
+    // pictures not moved to the picture store yet
+    struct PendingPicture
+    {
+	int m_id;
+	int m_albumId;
+	Picture::Type m_type;
+	std::string m_mimeType;
+	// data stored in the database by older versions
+	std::vector<unsigned char> m_data;
+	// location of the data in the media file
+	std::string m_file;
+	int64_t m_offset;
+	int64_t m_length;
+	int64_t m_size;
+	int64_t m_mtime;
+	// name of the file in the picture store
+	std::string m_hash;
+    };
+
+    std::vector<PendingPicture> pending;
+
     std::ostringstream query;
-    query << "SELECT album_id, type, mimetype, data FROM album_pictures WHERE album_id IN (";
+    query << "SELECT p.id, p.album_id, p.type, p.mimetype, p.hash, p.data IS NOT NULL, p.data_offset, p.data_length, "
+	  << "files.path, files.name, files.size, files.mtime "
+	  << "FROM album_pictures AS p LEFT JOIN files ON files.id = p.file_id WHERE p.album_id IN (";
     serializeIntList(query, ids);
     query << ")";
 
-    thread::BlockLock bl(m_mutex);
+    {
+	thread::BlockLock bl(m_mutex);
 
-    StatementHolder stmt(m_db, query.str());
+	StatementHolder stmt(m_db, query.str());
 
-    while (stmt.step() == SQLITE_ROW)
+	while (stmt.step() == SQLITE_ROW)
+	{
+	    int albumId = stmt.getInt(1);
+	    std::string type = stmt.getText(2);
+	    Picture::Type pictureType;
+
+	    if (type == "frontcover")
+		pictureType = Picture::FrontCover;
+	    else if (type == "backcover")
+		pictureType = Picture::BackCover;
+	    else
+		continue;
+
+	    // the file of the picture store is mapped, the data is not copied
+	    if (!stmt.isNull(4))
+	    {
+		auto picture = std::make_shared<Picture>(stmt.getText(3), m_pictureStore.getPath(stmt.getText(4)));
+
+		if (picture->getView())
+		{
+		    result[albumId][pictureType] = picture;
+		    continue;
+		}
+
+		LOG("storage: picture " << stmt.getText(4) << " is missing from the picture store");
+	    }
+
+	    PendingPicture p;
+	    p.m_id = stmt.getInt(0);
+	    p.m_albumId = albumId;
+	    p.m_type = pictureType;
+	    p.m_mimeType = stmt.getText(3);
+
+	    if (stmt.getInt(5))
+	    {
+		StatementHolder data(m_getAlbumPictureData);
+		data.bindInt(1, p.m_id);
+
+		if (data.step() == SQLITE_ROW)
+		    data.getBlob(0, p.m_data);
+	    }
+	    // the picture is skipped if its file was removed before the data was loaded
+	    else if (!stmt.isNull(8))
+	    {
+		p.m_file = stmt.getText(8) + "/" + stmt.getText(9);
+		p.m_offset = stmt.getInt64(6);
+		p.m_length = stmt.getInt64(7);
+		p.m_size = stmt.getInt64(10);
+		p.m_mtime = stmt.isNull(11) ? -1 : stmt.getInt64(11);
+	    }
+	    else
+		continue;
+
+	    pending.push_back(std::move(p));
+	}
+    }
+
+    // the media files and the picture store are accessed without locking the database
+    for (auto it = pending.begin(); it != pending.end(); )
     {
-	std::map<Picture::Type, std::shared_ptr<Picture>>& pictures = result[stmt.getInt(0) /* album ID */];
+	bool loaded = !it->m_data.empty() ||
+		      readPicture(it->m_file, it->m_offset, it->m_length, it->m_size, it->m_mtime, it->m_data);
+
+	if (loaded)
+	    it->m_hash = m_pictureStore.add(&it->m_data[0], it->m_data.size(), it->m_mimeType);
+
+	if (it->m_hash.empty())
+	{
+	    it = pending.erase(it);
+	    continue;
+	}
 
-	std::vector<unsigned char> data;
-	stmt.getBlob(3, data);
+	result[it->m_albumId][it->m_type] = std::make_shared<Picture>(it->m_mimeType,
+								      m_pictureStore.getPath(it->m_hash));
+	++it;
+    }
 
-	std::shared_ptr<Picture> picture = std::make_shared<Picture>(stmt.getText(2), std::move(data));
+    if (pending.empty())
+	return result;
 
-	std::string type = stmt.getText(1);
+    // the picture is stored once, albums having the same picture share the file of the picture store
+    thread::BlockLock bl(m_mutex);
+    batchWrite();
 
-	if (type == "frontcover")
-	    pictures[Picture::FrontCover] = picture;
-	else if (type == "backcover")
-	    pictures[Picture::BackCover] = picture;
+    for (const auto& p : pending)
+    {
+	StatementHolder stmt(m_setAlbumPictureHash);
+	stmt.bindText(1, p.m_hash);
+	stmt.bindInt(2, p.m_id);
+	stmt.step();
     }
 
     return result;
@@ -637,6 +975,7 @@ std::map<int, std::map<Picture::Type, std::shared_ptr<Picture>>> SqliteStorage::
 int SqliteStorage::createPlaylist(const std::string& name)
 {
     thread::BlockLock bl(m_mutex);
+    singleWrite();
 
     StatementHolder stmt(m_createPlaylist);
     stmt.bindText(1, name);
@@ -649,6 +988,7 @@ int SqliteStorage::createPlaylist(const std::string& name)
 void SqliteStorage::deletePlaylist(int id)
 {
     thread::BlockLock bl(m_mutex);
+    singleWrite();
 
     StatementHolder stmt(m_deletePlaylist);
     stmt.bindInt(1, id);
@@ -662,6 +1002,7 @@ int SqliteStorage::addPlaylistItem(int id, const std::string& type, int itemId)
 	return -1;
 
     thread::BlockLock bl(m_mutex);
+    singleWrite();
 
     StatementHolder stmt(m_addPlaylistItem);
     stmt.bindInt(1, id);
@@ -676,6 +1017,7 @@ int SqliteStorage::addPlaylistItem(int id, const std::string& type, int itemId)
 void SqliteStorage::deletePlaylistItem(int id)
 {
     thread::BlockLock bl(m_mutex);
+    singleWrite();
 
     StatementHolder stmt(m_deletePlaylistItem);
     stmt.bindInt(1, id);
@@ -731,6 +1073,44 @@ void SqliteStorage::execute(const std::string& sql)
 	throw zeppelin::library::StorageException("unable to execute query");
 }
 
+// =====================================================================================================================
+void SqliteStorage::batchWrite()
+{
+    // the transaction is committed from time to time to keep the loss small if the player is stopped meanwhile
+    if (m_transaction &&
+	(m_writes >= s_maxBatchWrites || std::chrono::steady_clock::now() - m_transactionStart >= s_maxBatchTime))
+	commit();
+
+    // writes outside of the batches are committed one by one
+    if (m_batches == 0)
+	return;
+
+    if (!m_transaction)
+    {
+	execute("BEGIN");
+	m_transaction = true;
+	m_writes = 0;
+	m_transactionStart = std::chrono::steady_clock::now();
+    }
+
+    ++m_writes;
+}
+
+// =====================================================================================================================
+void SqliteStorage::singleWrite()
+{
+    // the next write of the batches starts a new transaction
+    if (m_transaction)
+	commit();
+}
+
+// =====================================================================================================================
+void SqliteStorage::commit()
+{
+    m_transaction = false;
+    execute("COMMIT");
+}
+
 // =====================================================================================================================
 void SqliteStorage::prepareStatement(sqlite3_stmt** stmt, const std::string& sql)
 {
@@ -739,16 +1119,22 @@ void SqliteStorage::prepareStatement(sqlite3_stmt** stmt, const std::string& sql
 }
 
 // =====================================================================================================================
-int SqliteStorage::getFileIdByPath(const std::string& path, const std::string& name)
+void SqliteStorage::ensureColumn(const std::string& table, const std::string& column, const std::string& definition)
 {
-    StatementHolder stmt(m_getFileByPath);
-    stmt.bindText(1, path);
-    stmt.bindText(2, name);
+    {
+	StatementHolder stmt(m_db, "PRAGMA table_info(" + table + ")");
 
-    if (stmt.step() == SQLITE_ROW)
-	return stmt.getInt(0);
+	// the second column of the result is the name of the column
+	while (stmt.step() == SQLITE_ROW)
+	{
+	    if (stmt.getText(1) == column)
+		return;
+	}
+    }
 
-    return -1;
+    LOG("storage: adding column " << column << " to table " << table);
+
+    execute("ALTER TABLE " + table + " ADD COLUMN " + column + " " + definition);
 }
 
 // =====================================================================================================================
@@ -801,6 +1187,55 @@ int SqliteStorage::getAlbumId(int artistId, const zeppelin::library::Metadata& m
     }
 }
 
+// =====================================================================================================================
+const char* SqliteStorage::getPictureType(Picture::Type type)
+{
+    switch (type)
+    {
+	case Picture::FrontCover :
+	    return "frontcover";
+	case Picture::BackCover :
+	    return "backcover";
+    }
+
+    return "";
+}
+
+// =====================================================================================================================
+bool SqliteStorage::readPicture(const std::string& file,
+				int64_t offset,
+				int64_t length,
+				int64_t size,
+				int64_t mtime,
+				std::vector<unsigned char>& data)
+{
+    int fd = ::open(file.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0)
+    {
+	LOG("storage: unable to open " << file << " to load picture");
+	return false;
+    }
+
+    // the stored location is not valid if the file was modified since it was parsed
+    struct stat st;
+
+    if (fstat(fd, &st) != 0 || st.st_size != size || (mtime != -1 && utils::getMtime(st) != mtime) ||
+	offset < 0 || length <= 0 || offset + length > size)
+    {
+	LOG("storage: " << file << " was modified since its picture was found");
+	close(fd);
+	return false;
+    }
+
+    data.resize(length);
+    ssize_t r = pread(fd, &data[0], length, offset);
+
+    close(fd);
+
+    return r == length;
+}
+
 // =====================================================================================================================
 void SqliteStorage::serializeIntList(std::ostringstream& stream, const std::vector<int>& list)
 {
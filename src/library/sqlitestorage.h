@@ -7,12 +7,16 @@
 #ifndef LIBRARY_SQLITESTORAGE_H_INCLUDED
 #define LIBRARY_SQLITESTORAGE_H_INCLUDED
 
+#include "picturestore.h"
+
 #include <zeppelin/library/storage.h>
 
 #include <thread/mutex.h>
 
 #include <sqlite3.h>
 
+#include <chrono>
+
 namespace config
 {
 struct Library;
@@ -34,13 +38,22 @@ class SqliteStorage : public zeppelin::library::Storage
 
 	zeppelin::library::Statistics getStatistics() override;
 
+	void beginBatch() override;
+	void endBatch() override;
+
 	std::vector<std::shared_ptr<zeppelin::library::Directory>> getDirectories(const std::vector<int>& ids) override;
 	std::vector<int> getSubdirectoryIdsOfDirectory(int id) override;
 	int ensureDirectory(const std::string& name, int parentId) override;
+	int64_t getDirectoryMtime(int id) override;
+	void setDirectoryMtime(int id, int64_t mtime) override;
 
 	bool addFile(zeppelin::library::File& file) override;
 
 	void clearMark() override;
+	void markFilesOfDirectory(int directoryId) override;
+
+	void removeFile(int directoryId, const std::string& name) override;
+	void removeDirectory(int id) override;
 	void deleteNonMarked() override;
 
 	std::vector<std::shared_ptr<zeppelin::library::File>> getFilesWithoutMetadata() override;
@@ -48,6 +61,7 @@ class SqliteStorage : public zeppelin::library::Storage
 	std::vector<std::shared_ptr<zeppelin::library::File>> getFiles(const std::vector<int>& ids) override;
 	std::vector<int> getFileIdsOfAlbum(int albumId) override;
 	std::vector<int> getFileIdsOfDirectory(int directoryId) override;
+	std::vector<std::shared_ptr<zeppelin::library::File>> getFilesOfDirectory(int directoryId) override;
 
 	void setFileMetadata(const zeppelin::library::File& file) override;
 	void updateFileMetadata(const zeppelin::library::File& file) override;
@@ -66,12 +80,31 @@ class SqliteStorage : public zeppelin::library::Storage
 
     private:
 	void execute(const std::string& sql);
+
+	// called before the writes, starts a transaction for the batches and commits it if it is big or old enough
+	void batchWrite();
+	/**
+	 * Called before the writes made outside of the batches (e.g. editing a playlist). The open transaction of the
+	 * batches is committed, so the write is committed right away instead of joining it.
+	 */
+	void singleWrite();
+	void commit();
 	void prepareStatement(sqlite3_stmt** stmt, const std::string& sql);
+	// adds the column to a table created by an older version
+	void ensureColumn(const std::string& table, const std::string& column, const std::string& definition);
 
-	int getFileIdByPath(const std::string& path, const std::string& name);
 	int getArtistId(const zeppelin::library::Metadata& metadata);
 	int getAlbumId(int artistId, const zeppelin::library::Metadata& metadata);
 
+	static const char* getPictureType(zeppelin::library::Picture::Type type);
+	// loads a picture from the media file if the file was not modified since it was parsed
+	static bool readPicture(const std::string& file,
+				int64_t offset,
+				int64_t length,
+				int64_t size,
+				int64_t mtime,
+				std::vector<unsigned char>& data);
+
 	static void serializeIntList(std::ostringstream& stream, const std::vector<int>& list);
 
     private:
@@ -115,13 +148,17 @@ class SqliteStorage : public zeppelin::library::Storage
 	sqlite3_stmt* m_getDirectory;
 	sqlite3_stmt* m_addDirectory;
 	sqlite3_stmt* m_getSubdirectoryIds;
+	sqlite3_stmt* m_getDirectoryMtime;
+	sqlite3_stmt* m_setDirectoryMtime;
 
 	sqlite3_stmt* m_newFile;
+	sqlite3_stmt* m_updateFile;
 
 	sqlite3_stmt* m_getFileByPath;
 	sqlite3_stmt* m_getFilesWithoutMeta;
 	sqlite3_stmt* m_getFileIdsOfAlbum;
 	sqlite3_stmt* m_getFileIdsOfDirectory;
+	sqlite3_stmt* m_getFilesOfDirectory;
 	sqlite3_stmt* m_getFileStatistics;
 
 	sqlite3_stmt* m_setFileMark;
@@ -130,6 +167,9 @@ class SqliteStorage : public zeppelin::library::Storage
 	sqlite3_stmt* m_setFileMeta;
 	sqlite3_stmt* m_updateFileMeta;
 	sqlite3_stmt* m_addAlbumPicture;
+	sqlite3_stmt* m_setAlbumPicture;
+	sqlite3_stmt* m_getAlbumPictureData;
+	sqlite3_stmt* m_setAlbumPictureHash;
 
 	/// artist handling
 	sqlite3_stmt* m_addArtist;
@@ -151,11 +191,27 @@ class SqliteStorage : public zeppelin::library::Storage
 	/// mark handling
 	sqlite3_stmt* m_clearFileMarks;
 	sqlite3_stmt* m_clearDirectoryMarks;
+	sqlite3_stmt* m_markFilesOfDirectory;
+
+	sqlite3_stmt* m_removeFile;
+	sqlite3_stmt* m_removeFilesOfTree;
+	sqlite3_stmt* m_removeTree;
 	sqlite3_stmt* m_deleteNonMarkedFiles;
 	sqlite3_stmt* m_deleteNonMarkedDirectories;
 
+	// number of the batches in progress
+	int m_batches;
+	// a transaction is open for the writes of the batches
+	bool m_transaction;
+	// number of writes in the open transaction
+	int m_writes;
+	std::chrono::steady_clock::time_point m_transactionStart;
+
 	// mutex for the music database
 	thread::Mutex m_mutex;
+
+	// the data of the album pictures is kept outside of the database
+	PictureStore m_pictureStore;
 };
 
 }
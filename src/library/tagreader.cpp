@@ -0,0 +1,1031 @@
+/**
+ * This file is part of the Zeppelin music player project.
+ * Copyright (c) 2013-2014 Zoltan Kovacs, Lajos Santa
+ * See http://zeppelin-player.com for more details.
+ */
+
+#include "tagreader.h"
+#include "vorbismetadata.h"
+
+#include <codec/mp3header.h>
+
+#include <boost/locale.hpp>
+#include <boost/algorithm/string/trim.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+using library::TagReader;
+
+// minimum size of the mapped windows of the file
+static const size_t s_windowSize = 64 * 1024;
+
+// number of bytes parsed from the beginning of MP3 audio data, the same amount as codec::Mp3Header::read() uses
+static const size_t s_mp3HeadSize = 16 * 1024;
+
+// the header of the last Ogg page is in this region at the end of the file as a page is at most 65307 bytes long
+static const size_t s_oggTailSize = 68 * 1024;
+
+// Ogg header packets are not reassembled above this size
+static const size_t s_maxOggPacket = 16 * 1024 * 1024;
+
+// FLAC metadata block types
+static const int FLAC_STREAMINFO = 0;
+static const int FLAC_VORBIS_COMMENT = 4;
+static const int FLAC_PICTURE = 6;
+
+// picture types of ID3v2 and FLAC
+static const int PICTURE_FRONT_COVER = 3;
+static const int PICTURE_BACK_COVER = 4;
+
+// the text fields of the metadata stored by all of the tag formats
+enum Field
+{
+    ARTIST,
+    ALBUM,
+    TITLE,
+    YEAR,
+    TRACK
+};
+
+// =====================================================================================================================
+static inline uint32_t readBE32(const uint8_t* p)
+{
+    return (uint32_t(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+// =====================================================================================================================
+static inline uint32_t readBE24(const uint8_t* p)
+{
+    return (p[0] << 16) | (p[1] << 8) | p[2];
+}
+
+// =====================================================================================================================
+static inline uint32_t readLE32(const uint8_t* p)
+{
+    return (uint32_t(p[3]) << 24) | (p[2] << 16) | (p[1] << 8) | p[0];
+}
+
+// =====================================================================================================================
+static inline int64_t readLE64(const uint8_t* p)
+{
+    return static_cast<int64_t>((uint64_t(readLE32(p + 4)) << 32) | readLE32(p));
+}
+
+// =====================================================================================================================
+static inline uint32_t readSyncsafe(const uint8_t* p)
+{
+    return ((p[0] & 0x7f) << 21) | ((p[1] & 0x7f) << 14) | ((p[2] & 0x7f) << 7) | (p[3] & 0x7f);
+}
+
+// =====================================================================================================================
+static void setField(zeppelin::library::Metadata& metadata, Field field, const std::string& value)
+{
+    std::string v = boost::algorithm::trim_copy(value);
+
+    // tags are read in the order of increasing priority, empty values do not overwrite the ones already found
+    if (v.empty())
+	return;
+
+    switch (field)
+    {
+	case ARTIST :
+	    metadata.setArtist(v);
+	    break;
+
+	case ALBUM :
+	    metadata.setAlbum(v);
+	    break;
+
+	case TITLE :
+	    metadata.setTitle(v);
+	    break;
+
+	case YEAR :
+	{
+	    // dates like 2014-05-01 are accepted as well
+	    int year = atoi(v.c_str());
+
+	    if (year > 0)
+		metadata.setYear(year);
+
+	    break;
+	}
+
+	case TRACK :
+	{
+	    // the track number may be followed by the number of tracks (3/12)
+	    int track = atoi(v.c_str());
+
+	    if (track > 0)
+		metadata.setTrackIndex(track);
+
+	    break;
+	}
+    }
+}
+
+// =====================================================================================================================
+static bool getPictureType(int type, zeppelin::library::Picture::Type& pictureType)
+{
+    switch (type)
+    {
+	case PICTURE_FRONT_COVER :
+	    pictureType = zeppelin::library::Picture::FrontCover;
+	    return true;
+
+	case PICTURE_BACK_COVER :
+	    pictureType = zeppelin::library::Picture::BackCover;
+	    return true;
+
+	default :
+	    // do nothing with the remaining pictures ...
+	    return false;
+    }
+}
+
+// =====================================================================================================================
+static std::string guessMimeType(const uint8_t* data, size_t size)
+{
+    if (size >= 3 && memcmp(data, "\xff\xd8\xff", 3) == 0)
+	return "image/jpeg";
+    if (size >= 4 && memcmp(data, "\x89PNG", 4) == 0)
+	return "image/png";
+    if (size >= 3 && memcmp(data, "GIF", 3) == 0)
+	return "image/gif";
+
+    return "application/octet-stream";
+}
+
+// =====================================================================================================================
+static std::string decodeID3v1Field(const uint8_t* field, size_t length)
+{
+    const uint8_t* end = static_cast<const uint8_t*>(memchr(field, 0, length));
+
+    if (!end)
+	end = field + length;
+
+    return boost::locale::conv::to_utf<char>(reinterpret_cast<const char*>(field),
+					     reinterpret_cast<const char*>(end),
+					     "ISO-8859-1");
+}
+
+// =====================================================================================================================
+// decodes a terminated string of an ID3v2 frame, p is moved after the terminator
+static std::string decodeID3v2Text(int encoding, const uint8_t*& p, const uint8_t* end)
+{
+    const char* charset;
+    size_t width = 1;
+
+    switch (encoding)
+    {
+	case 0 :
+	    charset = "ISO-8859-1";
+	    break;
+
+	case 1 :
+	    // UTF-16 with byte order mark, little endian is assumed without it
+	    width = 2;
+	    charset = "UTF-16LE";
+
+	    if (end - p >= 2 && p[0] == 0xfe && p[1] == 0xff)
+	    {
+		charset = "UTF-16BE";
+		p += 2;
+	    }
+	    else if (end - p >= 2 && p[0] == 0xff && p[1] == 0xfe)
+		p += 2;
+
+	    break;
+
+	case 2 :
+	    width = 2;
+	    charset = "UTF-16BE";
+	    break;
+
+	case 3 :
+	    charset = "UTF-8";
+	    break;
+
+	default :
+	    p = end;
+	    return std::string();
+    }
+
+    const uint8_t* begin = p;
+
+    while (static_cast<size_t>(end - p) >= width && (p[0] != 0 || (width == 2 && p[1] != 0)))
+	p += width;
+
+    const uint8_t* stop = p;
+
+    // skip the terminator
+    p = (static_cast<size_t>(end - p) >= width) ? p + width : end;
+
+    if (encoding == 3)
+	return std::string(begin, stop);
+
+    return boost::locale::conv::to_utf<char>(reinterpret_cast<const char*>(begin),
+					     reinterpret_cast<const char*>(stop),
+					     charset);
+}
+
+// =====================================================================================================================
+// removes the unsynchronisation of ID3v2 data (0xff 0x00 -> 0xff)
+static std::vector<uint8_t> resynchronise(const uint8_t* p, size_t size)
+{
+    std::vector<uint8_t> data;
+    data.reserve(size);
+
+    for (size_t i = 0; i < size; ++i)
+    {
+	data.push_back(p[i]);
+
+	if (p[i] == 0xff && i + 1 < size && p[i + 1] == 0x00)
+	    ++i;
+    }
+
+    return data;
+}
+
+// =====================================================================================================================
+static bool parseVorbisComment(library::VorbisMetadata& metadata, const uint8_t* p, size_t size)
+{
+    if (size < 4)
+	return false;
+
+    // vendor string
+    size_t pos = 4 + readLE32(p);
+
+    if (pos > size || size - pos < 4)
+	return false;
+
+    uint32_t count = readLE32(p + pos);
+    pos += 4;
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+	if (size - pos < 4)
+	    return false;
+
+	uint32_t length = readLE32(p + pos);
+	pos += 4;
+
+	if (length > size - pos)
+	    return false;
+
+	metadata.setVorbisComment(std::string(p + pos, p + pos + length));
+	pos += length;
+    }
+
+    return true;
+}
+
+// =====================================================================================================================
+TagReader::TagReader(const std::string& file)
+    : m_file(file),
+      m_fd(-1),
+      m_size(0),
+      m_map(NULL),
+      m_mapOffset(0),
+      m_mapLength(0)
+{
+    m_fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+
+    struct stat st;
+
+    if (m_fd >= 0 && fstat(m_fd, &st) == 0)
+	m_size = st.st_size;
+}
+
+// =====================================================================================================================
+TagReader::~TagReader()
+{
+    unmap();
+
+    if (m_fd >= 0)
+	close(m_fd);
+}
+
+// =====================================================================================================================
+std::unique_ptr<zeppelin::library::Metadata> TagReader::read()
+{
+    std::string::size_type p = m_file.rfind('.');
+
+    if (m_fd < 0 || p == std::string::npos)
+	return nullptr;
+
+    // the format is selected by the extension the same way as the codecs
+    const char* extension = m_file.c_str() + p + 1;
+
+    if (strcasecmp(extension, "mp3") == 0)
+    {
+	std::unique_ptr<zeppelin::library::Metadata> metadata(new zeppelin::library::Metadata("mp3"));
+
+	if (readMp3(*metadata))
+	    return metadata;
+    }
+    else if (strcasecmp(extension, "flac") == 0)
+    {
+	std::unique_ptr<library::VorbisMetadata> metadata(new library::VorbisMetadata("flac"));
+
+	if (readFlac(*metadata))
+	    return std::move(metadata);
+    }
+    else if (strcasecmp(extension, "ogg") == 0)
+    {
+	std::unique_ptr<library::VorbisMetadata> metadata(new library::VorbisMetadata("ogg"));
+
+	if (readOgg(*metadata))
+	    return std::move(metadata);
+    }
+
+    return nullptr;
+}
+
+// =====================================================================================================================
+void TagReader::readTags(zeppelin::library::Metadata& metadata)
+{
+    zeppelin::library::Metadata tags(metadata.getCodec());
+
+    readFooterTags(tags);
+
+    if (metadata.getArtist().empty())
+	metadata.setArtist(tags.getArtist());
+    if (metadata.getAlbum().empty())
+	metadata.setAlbum(tags.getAlbum());
+    if (metadata.getTitle().empty())
+	metadata.setTitle(tags.getTitle());
+    if (metadata.getYear() == 0)
+	metadata.setYear(tags.getYear());
+    if (metadata.getTrackIndex() == 0)
+	metadata.setTrackIndex(tags.getTrackIndex());
+
+    for (const auto& picture : tags.getPictures())
+    {
+	if (metadata.getPictures().find(picture.first) == metadata.getPictures().end())
+	    metadata.addPicture(picture.first, picture.second);
+    }
+}
+
+// =====================================================================================================================
+bool TagReader::readMp3(zeppelin::library::Metadata& metadata)
+{
+    int64_t start = getID3v2Size();
+
+    // ID3v2 has the highest priority so it is parsed last
+    int64_t end = readFooterTags(metadata);
+
+    if (start > 0)
+    {
+	const uint8_t* tag = map(0, start);
+
+	if (tag)
+	    parseID3v2(metadata, tag, start);
+    }
+
+    if (end <= start)
+	return false;
+
+    // the length is computed from the first frames, files without a VBR header are left to the decoder
+    size_t size = std::min<int64_t>(s_mp3HeadSize, end - start);
+    const uint8_t* data = map(start, size);
+
+    codec::Mp3Header header;
+
+    if (!data || !header.parse(data, size, end - start))
+	return false;
+
+    metadata.setFormat(header.getChannels(), header.getRate(), 16);
+    metadata.setLength(header.getSamples() / header.getRate());
+
+    return true;
+}
+
+// =====================================================================================================================
+bool TagReader::readFlac(library::VorbisMetadata& metadata)
+{
+    // an ID3v2 tag is skipped by libFLAC as well
+    int64_t offset = getID3v2Size();
+    const uint8_t* p = map(offset, 4);
+
+    if (!p || memcmp(p, "fLaC", 4) != 0)
+	return false;
+
+    offset += 4;
+
+    bool streamInfo = false;
+    bool last = false;
+
+    while (!last)
+    {
+	p = map(offset, 4);
+
+	if (!p)
+	    return false;
+
+	last = p[0] & 0x80;
+	int type = p[0] & 0x7f;
+	uint32_t length = readBE24(p + 1);
+
+	offset += 4;
+
+	switch (type)
+	{
+	    case FLAC_STREAMINFO :
+	    {
+		if (length < 18 || !(p = map(offset, length)))
+		    return false;
+
+		// 20 bits of sample rate, 3 bits of channels, 5 bits of bits per sample and 36 bits of total samples
+		int rate = (p[10] << 12) | (p[11] << 4) | (p[12] >> 4);
+		int channels = ((p[12] >> 1) & 0x7) + 1;
+		int bits = (((p[12] & 0x1) << 4) | (p[13] >> 4)) + 1;
+		int64_t samples = (int64_t(p[13] & 0xf) << 32) | readBE32(p + 14);
+
+		if (rate == 0)
+		    return false;
+
+		metadata.setFormat(channels, rate, bits);
+		metadata.setLength(samples / rate);
+		streamInfo = true;
+
+		break;
+	    }
+
+	    case FLAC_VORBIS_COMMENT :
+		if ((p = map(offset, length)))
+		    parseVorbisComment(metadata, p, length);
+		break;
+
+	    case FLAC_PICTURE :
+		if ((p = map(offset, length)))
+		    parseFlacPicture(metadata, p, length);
+		break;
+	}
+
+	offset += length;
+    }
+
+    return streamInfo;
+}
+
+// =====================================================================================================================
+bool TagReader::readOgg(library::VorbisMetadata& metadata)
+{
+    std::vector<std::string> packets;
+    uint32_t serial;
+
+    // identification and comment header
+    if (!readOggPackets(packets, 2, serial))
+	return false;
+
+    const uint8_t* id = reinterpret_cast<const uint8_t*>(packets[0].data());
+
+    if (packets[0].size() < 16 || memcmp(id, "\x01vorbis", 7) != 0)
+	return false;
+
+    int channels = id[11];
+    uint32_t rate = readLE32(id + 12);
+
+    if (channels == 0 || rate == 0)
+	return false;
+
+    const uint8_t* comment = reinterpret_cast<const uint8_t*>(packets[1].data());
+
+    if (packets[1].size() < 7 || memcmp(comment, "\x03vorbis", 7) != 0)
+	return false;
+
+    parseVorbisComment(metadata, comment + 7, packets[1].size() - 7);
+
+    // the granule position of the last page is the number of samples
+    int64_t samples = getLastGranule(serial);
+
+    if (samples < 0)
+	return false;
+
+    metadata.setFormat(channels, rate, 16);
+    metadata.setLength(samples / rate);
+
+    return true;
+}
+
+// =====================================================================================================================
+int64_t TagReader::readFooterTags(zeppelin::library::Metadata& metadata)
+{
+    int64_t end = m_size;
+
+    // the APEv2 tag is placed before the ID3v1 tag and has higher priority
+    if (parseID3v1(metadata))
+	end -= 128;
+
+    int64_t ape = parseApe(metadata, end);
+
+    if (ape >= 0)
+	end = ape;
+
+    return end;
+}
+
+// =====================================================================================================================
+int64_t TagReader::getID3v2Size()
+{
+    const uint8_t* p = map(0, 10);
+
+    if (!p || memcmp(p, "ID3", 3) != 0)
+	return 0;
+
+    int64_t size = 10 + readSyncsafe(p + 6);
+
+    // footer
+    if (p[5] & 0x10)
+	size += 10;
+
+    return std::min(size, m_size);
+}
+
+// =====================================================================================================================
+void TagReader::parseID3v2(zeppelin::library::Metadata& metadata, const uint8_t* tag, size_t size)
+{
+    int version = tag[3];
+    int flags = tag[5];
+
+    if (version < 2 || version > 4)
+	return;
+
+    const uint8_t* p = tag + 10;
+    const uint8_t* end = tag + std::min<size_t>(size, 10 + readSyncsafe(tag + 6));
+
+    // the unsynchronisation of version 2.2 and 2.3 is applied to the whole tag
+    std::vector<uint8_t> data;
+
+    if ((flags & 0x80) && version < 4)
+    {
+	data = resynchronise(p, end - p);
+
+	if (data.empty())
+	    return;
+
+	p = &data[0];
+	end = p + data.size();
+    }
+
+    // extended header, its size contains itself only in version 2.4
+    if ((flags & 0x40) && version > 2)
+    {
+	if (end - p < 4)
+	    return;
+
+	size_t length = (version == 3) ? readBE32(p) + 4 : readSyncsafe(p);
+
+	if (length > static_cast<size_t>(end - p))
+	    return;
+
+	p += length;
+    }
+
+    size_t idLength = (version == 2) ? 3 : 4;
+    size_t headerLength = (version == 2) ? 6 : 10;
+
+    while (static_cast<size_t>(end - p) >= headerLength && p[0] != 0)
+    {
+	std::string id(p, p + idLength);
+	size_t length;
+	int frameFlags = 0;
+
+	if (version == 2)
+	    length = readBE24(p + 3);
+	else
+	{
+	    length = (version == 3) ? readBE32(p + 4) : readSyncsafe(p + 4);
+	    frameFlags = (p[8] << 8) | p[9];
+	}
+
+	p += headerLength;
+
+	if (length > static_cast<size_t>(end - p))
+	    break;
+
+	const uint8_t* frame = p;
+	p += length;
+
+	std::vector<uint8_t> frameData;
+
+	if (version == 3)
+	{
+	    // compressed and encrypted frames are skipped
+	    if (frameFlags & 0x00c0)
+		continue;
+
+	    // group identifier
+	    if (frameFlags & 0x0020)
+	    {
+		if (length < 1)
+		    continue;
+
+		++frame;
+		--length;
+	    }
+	}
+	else if (version == 4)
+	{
+	    if (frameFlags & 0x000c)
+		continue;
+
+	    // group identifier and data length indicator
+	    size_t skip = ((frameFlags & 0x0040) ? 1 : 0) + ((frameFlags & 0x0001) ? 4 : 0);
+
+	    if (length < skip)
+		continue;
+
+	    frame += skip;
+	    length -= skip;
+
+	    if (frameFlags & 0x0002)
+	    {
+		frameData = resynchronise(frame, length);
+		frame = frameData.empty() ? frame : &frameData[0];
+		length = frameData.size();
+	    }
+	}
+
+	// the frames of version 2.2 have shorter identifiers
+	if (version == 2)
+	{
+	    static const char* s_frames[][2] = {
+		{ "TT2", "TIT2" }, { "TP1", "TPE1" }, { "TAL", "TALB" }, { "TYE", "TYER" }, { "TRK", "TRCK" }
+	    };
+
+	    for (const auto& f : s_frames)
+	    {
+		if (id == f[0])
+		    id = f[1];
+	    }
+	}
+
+	parseID3v2Frame(metadata, id, frame, length);
+    }
+}
+
+// =====================================================================================================================
+void TagReader::parseID3v2Frame(zeppelin::library::Metadata& metadata,
+				const std::string& id,
+				const uint8_t* data,
+				size_t size)
+{
+    if (size < 1)
+	return;
+
+    int encoding = data[0];
+    const uint8_t* p = data + 1;
+    const uint8_t* end = data + size;
+
+    if (id == "TIT2")
+	setField(metadata, TITLE, decodeID3v2Text(encoding, p, end));
+    else if (id == "TPE1")
+	setField(metadata, ARTIST, decodeID3v2Text(encoding, p, end));
+    else if (id == "TALB")
+	setField(metadata, ALBUM, decodeID3v2Text(encoding, p, end));
+    else if (id == "TYER" || id == "TDRC")
+	setField(metadata, YEAR, decodeID3v2Text(encoding, p, end));
+    else if (id == "TRCK")
+	setField(metadata, TRACK, decodeID3v2Text(encoding, p, end));
+    else if (id == "APIC" || id == "PIC")
+    {
+	std::string mimeType;
+
+	// version 2.2 stores a 3 character image format instead of the MIME type
+	if (id == "PIC")
+	{
+	    if (end - p < 3)
+		return;
+
+	    std::string format(p, p + 3);
+	    std::transform(format.begin(), format.end(), format.begin(), ::tolower);
+	    mimeType = "image/" + (format == "jpg" ? std::string("jpeg") : format);
+	    p += 3;
+	}
+	else
+	    mimeType = decodeID3v2Text(0, p, end);
+
+	zeppelin::library::Picture::Type type;
+
+	if (p >= end || !getPictureType(*p++, type))
+	    return;
+
+	// description
+	decodeID3v2Text(encoding, p, end);
+
+	if (p >= end)
+	    return;
+
+	if (mimeType.find('/') == std::string::npos)
+	    mimeType = guessMimeType(p, end - p);
+
+	metadata.addPicture(type, createPicture(mimeType, p, end - p));
+    }
+}
+
+// =====================================================================================================================
+void TagReader::parseFlacPicture(zeppelin::library::Metadata& metadata, const uint8_t* p, size_t size)
+{
+    zeppelin::library::Picture::Type type;
+
+    if (size < 8 || !getPictureType(readBE32(p), type))
+	return;
+
+    size_t pos = 4;
+
+    uint32_t mimeLength = readBE32(p + pos);
+    pos += 4;
+
+    if (mimeLength > size - pos || size - pos - mimeLength < 4)
+	return;
+
+    std::string mimeType(p + pos, p + pos + mimeLength);
+    pos += mimeLength;
+
+    // description, followed by the width, height, color depth and the number of colors
+    uint32_t descriptionLength = readBE32(p + pos);
+    pos += 4;
+
+    if (descriptionLength > size - pos || size - pos - descriptionLength < 16 + 4)
+	return;
+
+    pos += descriptionLength + 16;
+
+    uint32_t length = readBE32(p + pos);
+    pos += 4;
+
+    if (length > size - pos)
+	return;
+
+    metadata.addPicture(type, createPicture(mimeType, p + pos, length));
+}
+
+// =====================================================================================================================
+bool TagReader::parseID3v1(zeppelin::library::Metadata& metadata)
+{
+    const uint8_t* p = map(m_size - 128, 128);
+
+    if (!p || memcmp(p, "TAG", 3) != 0)
+	return false;
+
+    setField(metadata, TITLE, decodeID3v1Field(p + 3, 30));
+    setField(metadata, ARTIST, decodeID3v1Field(p + 33, 30));
+    setField(metadata, ALBUM, decodeID3v1Field(p + 63, 30));
+    setField(metadata, YEAR, decodeID3v1Field(p + 93, 4));
+
+    // track index could be filled from ID3v1.1 data, but it is skipped the same way as in the MP3 codec
+
+    return true;
+}
+
+// =====================================================================================================================
+int64_t TagReader::parseApe(zeppelin::library::Metadata& metadata, int64_t end)
+{
+    const uint8_t* p = map(end - 32, 32);
+
+    if (!p || memcmp(p, "APETAGEX", 8) != 0)
+	return -1;
+
+    // the size contains the items and the footer but not the optional header
+    uint32_t size = readLE32(p + 12);
+    uint32_t count = readLE32(p + 16);
+    bool header = readLE32(p + 20) & 0x80000000;
+
+    if (size < 32 || size + (header ? 32 : 0) > end)
+	return -1;
+
+    int64_t start = end - size;
+    size -= 32;
+
+    if (size > 0 && (p = map(start, size)))
+    {
+	size_t pos = 0;
+
+	for (uint32_t i = 0; i < count && size - pos >= 8; ++i)
+	{
+	    uint32_t length = readLE32(p + pos);
+	    uint32_t flags = readLE32(p + pos + 4);
+	    pos += 8;
+
+	    const uint8_t* keyEnd = static_cast<const uint8_t*>(memchr(p + pos, 0, size - pos));
+
+	    if (!keyEnd)
+		break;
+
+	    std::string key(p + pos, keyEnd);
+	    pos = keyEnd - p + 1;
+
+	    if (length > size - pos)
+		break;
+
+	    const uint8_t* value = p + pos;
+	    pos += length;
+
+	    switch ((flags >> 1) & 0x3)
+	    {
+		// UTF-8 text, only the first value of a list is used
+		case 0 :
+		{
+		    std::string text(value, value + length);
+		    text = text.c_str();
+
+		    if (strcasecmp(key.c_str(), "Artist") == 0)
+			setField(metadata, ARTIST, text);
+		    else if (strcasecmp(key.c_str(), "Album") == 0)
+			setField(metadata, ALBUM, text);
+		    else if (strcasecmp(key.c_str(), "Title") == 0)
+			setField(metadata, TITLE, text);
+		    else if (strcasecmp(key.c_str(), "Year") == 0)
+			setField(metadata, YEAR, text);
+		    else if (strcasecmp(key.c_str(), "Track") == 0)
+			setField(metadata, TRACK, text);
+
+		    break;
+		}
+
+		// binary, the pictures are stored after their file name
+		case 1 :
+		{
+		    zeppelin::library::Picture::Type type;
+
+		    if (strcasecmp(key.c_str(), "Cover Art (Front)") == 0)
+			type = zeppelin::library::Picture::FrontCover;
+		    else if (strcasecmp(key.c_str(), "Cover Art (Back)") == 0)
+			type = zeppelin::library::Picture::BackCover;
+		    else
+			break;
+
+		    const uint8_t* data = static_cast<const uint8_t*>(memchr(value, 0, length));
+
+		    if (!data || ++data == value + length)
+			break;
+
+		    size_t dataLength = value + length - data;
+
+		    metadata.addPicture(type, createPicture(guessMimeType(data, dataLength), data, dataLength));
+
+		    break;
+		}
+	    }
+	}
+    }
+
+    return start - (header ? 32 : 0);
+}
+
+// =====================================================================================================================
+bool TagReader::readOggPackets(std::vector<std::string>& packets, size_t count, uint32_t& serial)
+{
+    std::string packet;
+    int64_t offset = 0;
+
+    while (packets.size() < count)
+    {
+	const uint8_t* p = map(offset, 27);
+
+	if (!p || memcmp(p, "OggS", 4) != 0)
+	    return false;
+
+	uint32_t pageSerial = readLE32(p + 14);
+	size_t segments = p[26];
+
+	// the stream of the first page is read, the pages of other multiplexed streams are skipped
+	if (offset == 0)
+	    serial = pageSerial;
+
+	offset += 27;
+
+	if (segments == 0)
+	    continue;
+
+	if (!(p = map(offset, segments)))
+	    return false;
+
+	std::vector<uint8_t> lacing(p, p + segments);
+	size_t size = 0;
+
+	for (uint8_t l : lacing)
+	    size += l;
+
+	offset += segments;
+
+	if (pageSerial == serial && size > 0)
+	{
+	    const uint8_t* data = map(offset, size);
+
+	    if (!data)
+		return false;
+
+	    // a packet ends with a segment shorter than 255 bytes
+	    for (uint8_t l : lacing)
+	    {
+		packet.append(reinterpret_cast<const char*>(data), l);
+		data += l;
+
+		if (l < 255)
+		{
+		    packets.push_back(packet);
+		    packet.clear();
+
+		    if (packets.size() == count)
+			break;
+		}
+	    }
+
+	    if (packet.size() > s_maxOggPacket)
+		return false;
+	}
+
+	offset += size;
+    }
+
+    return true;
+}
+
+// =====================================================================================================================
+int64_t TagReader::getLastGranule(uint32_t serial)
+{
+    size_t size = std::min<int64_t>(s_oggTailSize, m_size);
+    const uint8_t* p = map(m_size - size, size);
+
+    if (!p || size < 27)
+	return -1;
+
+    for (size_t i = size - 27 + 1; i-- > 0; )
+    {
+	if (memcmp(p + i, "OggS", 4) != 0 || p[i + 4] != 0 || readLE32(p + i + 14) != serial)
+	    continue;
+
+	// -1 is stored if no packet is finished on the page
+	int64_t granule = readLE64(p + i + 6);
+
+	if (granule >= 0)
+	    return granule;
+    }
+
+    return -1;
+}
+
+// =====================================================================================================================
+std::shared_ptr<zeppelin::library::Picture> TagReader::createPicture(const std::string& mimeType,
+								       const uint8_t* data,
+								       size_t size)
+{
+    if (m_map && data >= m_map && data + size <= m_map + m_mapLength)
+	return std::make_shared<zeppelin::library::Picture>(mimeType, m_mapOffset + (data - m_map), size);
+
+    return std::make_shared<zeppelin::library::Picture>(mimeType, data, size);
+}
+
+// =====================================================================================================================
+const uint8_t* TagReader::map(int64_t offset, size_t length)
+{
+    if (m_fd < 0 || length == 0 || offset < 0 || offset + static_cast<int64_t>(length) > m_size)
+	return nullptr;
+
+    if (m_map &&
+	offset >= m_mapOffset &&
+	offset + static_cast<int64_t>(length) <= m_mapOffset + static_cast<int64_t>(m_mapLength))
+	return m_map + (offset - m_mapOffset);
+
+    unmap();
+
+    // the window starts at a page boundary and it is extended to avoid remapping for small reads next to each other
+    static const int64_t pageSize = sysconf(_SC_PAGESIZE);
+
+    int64_t start = offset - offset % pageSize;
+    size_t size = std::max<int64_t>(offset + length - start, s_windowSize);
+    size = std::min<int64_t>(size, m_size - start);
+
+    void* p = mmap(NULL, size, PROT_READ, MAP_PRIVATE, m_fd, start);
+
+    if (p == MAP_FAILED)
+	return nullptr;
+
+    m_map = static_cast<uint8_t*>(p);
+    m_mapOffset = start;
+    m_mapLength = size;
+
+    return m_map + (offset - start);
+}
+
+// =====================================================================================================================
+void TagReader::unmap()
+{
+    if (!m_map)
+	return;
+
+    munmap(m_map, m_mapLength);
+    m_map = NULL;
+}
@@ -0,0 +1,94 @@
+/**
+ * This file is part of the Zeppelin music player project.
+ * Copyright (c) 2013-2014 Zoltan Kovacs, Lajos Santa
+ * See http://zeppelin-player.com for more details.
+ */
+
+#ifndef LIBRARY_TAGREADER_H_INCLUDED
+#define LIBRARY_TAGREADER_H_INCLUDED
+
+#include <zeppelin/library/metadata.h>
+
+#include <string>
+#include <vector>
+#include <memory>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace library
+{
+
+class VorbisMetadata;
+
+/**
+ * Reads the metadata of a file without creating a decoder for it.
+ *
+ * Only the regions of the file holding the tags and the stream headers are memory mapped: the ID3v2 tag and the first
+ * frames of MP3 files with the APEv2 and ID3v1 tags at their end, the metadata blocks of FLAC files and the header
+ * packets and the last page of Ogg Vorbis files. The data of the embedded pictures is not read, only their location is
+ * stored in the metadata.
+ */
+class TagReader
+{
+    public:
+	TagReader(const std::string& file);
+	~TagReader();
+
+	/// returns nullptr if the metadata of the file cannot be read without its codec
+	std::unique_ptr<zeppelin::library::Metadata> read();
+
+	/// fills the empty fields of the metadata read by a codec from the APEv2 and ID3v1 tags at the end of the file
+	void readTags(zeppelin::library::Metadata& metadata);
+
+    private:
+	bool readMp3(zeppelin::library::Metadata& metadata);
+	bool readFlac(library::VorbisMetadata& metadata);
+	bool readOgg(library::VorbisMetadata& metadata);
+
+	// reads the APEv2 and ID3v1 tags, returns the offset where the tags at the end of the file begin
+	int64_t readFooterTags(zeppelin::library::Metadata& metadata);
+
+	// returns the size of the ID3v2 tag at the beginning of the file (including its header and footer) or 0
+	int64_t getID3v2Size();
+
+	void parseID3v2(zeppelin::library::Metadata& metadata, const uint8_t* tag, size_t size);
+	void parseID3v2Frame(zeppelin::library::Metadata& metadata,
+			     const std::string& id,
+			     const uint8_t* data,
+			     size_t size);
+	void parseFlacPicture(zeppelin::library::Metadata& metadata, const uint8_t* p, size_t size);
+	bool parseID3v1(zeppelin::library::Metadata& metadata);
+	// parses the APEv2 tag ending at the given offset, returns the offset of its beginning or -1 if there is no tag
+	int64_t parseApe(zeppelin::library::Metadata& metadata, int64_t end);
+
+	// reads the first packets of the logical stream of the first page
+	bool readOggPackets(std::vector<std::string>& packets, size_t count, uint32_t& serial);
+	// returns the granule position of the last page of the stream or -1
+	int64_t getLastGranule(uint32_t serial);
+
+	// pictures in the mapped region are referenced by their location, the others (unsynchronised ID3v2 frames) are
+	// copied
+	std::shared_ptr<zeppelin::library::Picture> createPicture(const std::string& mimeType,
+								   const uint8_t* data,
+								   size_t size);
+
+	// maps the given region of the file, the returned pointer is valid until the next call
+	const uint8_t* map(int64_t offset, size_t length);
+	void unmap();
+
+    private:
+	std::string m_file;
+
+	int m_fd;
+	int64_t m_size;
+
+	// the currently mapped window of the file
+	uint8_t* m_map;
+	int64_t m_mapOffset;
+	size_t m_mapLength;
+};
+
+}
+
+#endif
@@ -0,0 +1,309 @@
+/**
+ * This file is part of the Zeppelin music player project.
+ * Copyright (c) 2013-2014 Zoltan Kovacs, Lajos Santa
+ * See http://zeppelin-player.com for more details.
+ */
+
+#include "watcher.h"
+#include "scanner.h"
+#include "metaparser.h"
+
+#include <codec/codecmanager.h>
+#include <thread/blocklock.h>
+#include <utils/mtime.h>
+
+#include <zeppelin/logger.h>
+#include <zeppelin/library/storage.h>
+
+#include <algorithm>
+
+#include <errno.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+
+using library::Watcher;
+
+// events of the watched directories
+static const uint32_t s_mask = IN_CREATE | IN_CLOSE_WRITE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+			       IN_ONLYDIR | IN_EXCL_UNLINK;
+
+// =====================================================================================================================
+Watcher::Watcher(const codec::CodecManager& codecManager,
+		 zeppelin::library::Storage& storage,
+		 Scanner& scanner,
+		 MetaParser& metaParser,
+		 const std::vector<std::string>& roots)
+    : m_limitReached(false),
+      m_roots(roots),
+      m_storage(storage),
+      m_scanner(scanner),
+      m_metaParser(metaParser),
+      m_codecManager(codecManager)
+{
+    m_fd = inotify_init1(IN_CLOEXEC);
+
+    if (m_fd < 0)
+	LOG("watcher: unable to initialize inotify");
+}
+
+// =====================================================================================================================
+Watcher::~Watcher()
+{
+    if (m_fd >= 0)
+	close(m_fd);
+}
+
+// =====================================================================================================================
+void Watcher::add(int id, const std::string& path)
+{
+    if (m_fd < 0)
+	return;
+
+    int wd = inotify_add_watch(m_fd, path.c_str(), s_mask);
+
+    if (wd < 0)
+    {
+	if (errno != ENOSPC)
+	    LOG("watcher: unable to watch: " << path);
+	else if (!m_limitReached)
+	{
+	    LOG("watcher: the limit of inotify watches is reached (see fs.inotify.max_user_watches)");
+	    m_limitReached = true;
+	}
+
+	return;
+    }
+
+    thread::BlockLock bl(m_mutex);
+
+    // the same directory may be reached through a symbolic link as well, it is watched on the last path only
+    auto it = m_watches.find(wd);
+
+    if (it != m_watches.end() && it->second.m_path != path)
+	m_paths.erase(it->second.m_path);
+
+    m_watches[wd] = {id, path};
+    m_paths[path] = wd;
+}
+
+// =====================================================================================================================
+void Watcher::run()
+{
+    if (m_fd < 0)
+	return;
+
+    addStoredDirectories();
+
+    std::vector<char> buffer(64 * 1024);
+
+    while (1)
+    {
+	ssize_t length = read(m_fd, &buffer[0], buffer.size());
+
+	if (length < 0)
+	{
+	    if (errno == EINTR)
+		continue;
+
+	    LOG("watcher: unable to read events");
+	    return;
+	}
+
+	const char* p = &buffer[0];
+	const char* end = p + length;
+
+	while (p < end)
+	{
+	    const inotify_event* event = reinterpret_cast<const inotify_event*>(p);
+	    handleEvent(*event);
+	    p += sizeof(inotify_event) + event->len;
+	}
+    }
+}
+
+// =====================================================================================================================
+void Watcher::addStoredDirectories()
+{
+    std::vector<std::shared_ptr<zeppelin::library::Directory>> dirs = m_storage.getDirectories({});
+
+    std::map<int, const zeppelin::library::Directory*> byId;
+
+    for (const auto& d : dirs)
+	byId[d->m_id] = d.get();
+
+    size_t count = 0;
+
+    for (const auto& d : dirs)
+    {
+	// collect the names up to the root, the name of a root directory is its path
+	std::vector<const std::string*> names;
+	const zeppelin::library::Directory* current = d.get();
+
+	while (current)
+	{
+	    names.push_back(&current->m_name);
+
+	    auto it = byId.find(current->m_parentId);
+	    current = (it != byId.end()) ? it->second : NULL;
+	}
+
+	// roots removed from the configuration are not watched
+	if (std::find(m_roots.begin(), m_roots.end(), *names.back()) == m_roots.end())
+	    continue;
+
+	std::string path;
+
+	for (auto it = names.rbegin(); it != names.rend(); ++it)
+	{
+	    if (!path.empty())
+		path += "/";
+	    path += **it;
+	}
+
+	add(d->m_id, path);
+	++count;
+    }
+
+    LOG("watcher: watching " << count << " directories");
+}
+
+// =====================================================================================================================
+void Watcher::handleEvent(const inotify_event& event)
+{
+    // events were dropped by the kernel
+    if (event.mask & IN_Q_OVERFLOW)
+    {
+	LOG("watcher: event queue overflowed");
+	rescanRoots();
+	return;
+    }
+
+    Directory dir;
+
+    {
+	thread::BlockLock bl(m_mutex);
+
+	auto it = m_watches.find(event.wd);
+
+	if (it == m_watches.end())
+	    return;
+
+	// The watch of a removed directory is dropped when its parent reports the removal, the ID of the directory is
+	// still needed then.
+	if (event.mask & IN_IGNORED)
+	    return;
+
+	dir = it->second;
+    }
+
+    // events of the watched directory itself
+    if (event.len == 0)
+	return;
+
+    std::string name(event.name);
+
+    if (event.mask & IN_ISDIR)
+    {
+	if (event.mask & (IN_CREATE | IN_MOVED_TO))
+	    directoryCreated(dir, name);
+	else if (event.mask & (IN_DELETE | IN_MOVED_FROM))
+	    directoryRemoved(dir.m_path + "/" + name);
+
+	return;
+    }
+
+    if (!m_codecManager.isMediaFile(name.c_str()))
+	return;
+
+    // new files are added when they are closed after writing instead of at their creation
+    if (event.mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+	fileChanged(dir, name);
+    else if (event.mask & (IN_DELETE | IN_MOVED_FROM))
+    {
+	LOG("watcher: removed: " << dir.m_path << "/" << name);
+	m_storage.removeFile(dir.m_id, name);
+    }
+}
+
+// =====================================================================================================================
+void Watcher::fileChanged(const Directory& dir, const std::string& name)
+{
+    std::string path = dir.m_path + "/" + name;
+
+    struct stat st;
+
+    if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+	return;
+
+    std::shared_ptr<zeppelin::library::File> file = std::make_shared<zeppelin::library::File>(-1);
+    file->m_directoryId = dir.m_id;
+    file->m_path = dir.m_path;
+    file->m_name = name;
+    file->m_size = st.st_size;
+    file->m_mtime = utils::getMtime(st);
+
+    // files closed without modifications are not parsed again
+    if (m_storage.addFile(*file))
+    {
+	LOG("watcher: changed: " << path);
+	m_metaParser.add(file);
+    }
+}
+
+// =====================================================================================================================
+void Watcher::directoryCreated(const Directory& dir, const std::string& name)
+{
+    std::string path = dir.m_path + "/" + name;
+
+    LOG("watcher: new directory: " << path);
+
+    // the scanner reports the directories of the new tree before reading them, so they are watched from then on
+    m_scanner.rescan(m_storage.ensureDirectory(name, dir.m_id), path);
+}
+
+// =====================================================================================================================
+void Watcher::directoryRemoved(const std::string& path)
+{
+    int id = -1;
+
+    {
+	thread::BlockLock bl(m_mutex);
+
+	// the watches of a directory moved out of the library would remain active, so the whole tree is unwatched
+	auto it = m_paths.lower_bound(path);
+
+	while (it != m_paths.end() && it->first.compare(0, path.size(), path) == 0)
+	{
+	    if (it->first.size() > path.size() && it->first[path.size()] != '/')
+	    {
+		++it;
+		continue;
+	    }
+
+	    if (it->first.size() == path.size())
+		id = m_watches[it->second].m_id;
+
+	    inotify_rm_watch(m_fd, it->second);
+	    m_watches.erase(it->second);
+	    it = m_paths.erase(it);
+	}
+    }
+
+    // unwatched directories are removed by the next scan
+    if (id == -1)
+	return;
+
+    LOG("watcher: removed directory: " << path);
+
+    m_storage.removeDirectory(id);
+}
+
+// =====================================================================================================================
+void Watcher::rescanRoots()
+{
+    for (const auto& r : m_roots)
+	m_scanner.add(r);
+
+    m_scanner.scan();
+}
@@ -0,0 +1,108 @@
+/**
+ * This file is part of the Zeppelin music player project.
+ * Copyright (c) 2013-2014 Zoltan Kovacs, Lajos Santa
+ * See http://zeppelin-player.com for more details.
+ */
+
+#ifndef LIBRARY_WATCHER_H_INCLUDED
+#define LIBRARY_WATCHER_H_INCLUDED
+
+#include <thread/thread.h>
+#include <thread/mutex.h>
+
+#include <string>
+#include <vector>
+#include <map>
+#include <atomic>
+
+struct inotify_event;
+
+namespace zeppelin
+{
+namespace library
+{
+class Storage;
+}
+}
+
+namespace codec
+{
+class CodecManager;
+}
+
+namespace library
+{
+
+class Scanner;
+class MetaParser;
+
+/**
+ * Keeps the library up to date by watching the directories of the storage with inotify.
+ *
+ * New and modified media files are added to the storage and passed to the metadata parser, removed ones are deleted
+ * from the storage right away. New directories are scanned by the scanner. Moving a file or a directory inside the
+ * library is handled as removing it and adding it again. If the kernel drops events because the event queue
+ * overflowed, the roots are rescanned; the rescan reads only the directories modified since the last scan.
+ */
+class Watcher : public thread::Thread
+{
+    public:
+	Watcher(const codec::CodecManager& codecManager,
+		zeppelin::library::Storage& storage,
+		Scanner& scanner,
+		MetaParser& metaParser,
+		const std::vector<std::string>& roots);
+	~Watcher();
+
+	/// starts watching a directory of the storage
+	void add(int id, const std::string& path);
+
+	void run() override;
+
+    private:
+	struct Directory
+	{
+	    // ID of the directory in the storage
+	    int m_id;
+	    // path of the directory
+	    std::string m_path;
+	};
+
+	// starts watching the directories known by the storage
+	void addStoredDirectories();
+
+	void handleEvent(const inotify_event& event);
+
+	void fileChanged(const Directory& dir, const std::string& name);
+	void directoryCreated(const Directory& dir, const std::string& name);
+	void directoryRemoved(const std::string& path);
+
+	// rescans all of the roots after lost events
+	void rescanRoots();
+
+    private:
+	// inotify instance
+	int m_fd;
+
+	// watched directories by watch descriptor
+	std::map<int, Directory> m_watches;
+	// watch descriptors by path
+	std::map<std::string, int> m_paths;
+
+	// set when the limit of the watches is reached to avoid logging it for every directory
+	std::atomic_bool m_limitReached;
+
+	thread::Mutex m_mutex;
+
+	std::vector<std::string> m_roots;
+
+	zeppelin::library::Storage& m_storage;
+	Scanner& m_scanner;
+	MetaParser& m_metaParser;
+
+	const codec::CodecManager& m_codecManager;
+};
+
+}
+
+#endif
@@ -174,10 +174,15 @@ int main(int argc, char** argv)
 
     output->setup(44100, 2);
 
-    player::Fifo fifo(4 * 1024);
     player::Format fmt = output->getFormat();
+    // the fifo must be large enough to hold the decoder buffer plus the output of one decoding round
+    player::Fifo fifo(fmt.sizeOfSeconds(15));
+
+    std::shared_ptr<player::Decoder> decoder(new player::Decoder(fmt.sizeOfSeconds(10 /* 10 seconds of samples */), output, fifo, config));
+
+    if (config.m_cache.m_memoryLimit > 0)
+	decoder->setCache(std::make_shared<player::PcmCache>(config.m_cache));
 
-    std::shared_ptr<player::Decoder> decoder(new player::Decoder(fmt.sizeOfSeconds(10 /* 10 seconds of samples */), fmt, fifo, config));
     decoder->start();
 
     std::shared_ptr<player::Player> player(new player::Player(output, fifo, config));
@@ -185,8 +190,12 @@ int main(int argc, char** argv)
 
     fifo.setNotifyCallback(fmt.sizeOfSeconds(5 /* 5 second limit */), std::bind(&player::Decoder::notify, decoder.get()));
 
+    std::shared_ptr<player::Preloader> preloader(new player::Preloader(codecManager));
+    preloader->start();
+
     // create the main part of our wonderful player :)
-    std::shared_ptr<zeppelin::player::Controller> ctrl = player::ControllerImpl::create(codecManager, decoder, player, config);
+    std::shared_ptr<zeppelin::player::Controller> ctrl =
+	player::ControllerImpl::create(codecManager, decoder, player, preloader, config);
 
     // initialize the plugin manager
     plugin::PluginManagerImpl pm(lib, ctrl, config.m_plugins);
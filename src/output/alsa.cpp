@@ -11,6 +11,8 @@
 
 #include <zeppelin/logger.h>
 
+#include <algorithm>
+
 using output::AlsaOutput;
 using output::OutputException;
 
@@ -19,7 +21,10 @@ AlsaOutput::AlsaOutput(const config::Config& config)
     : BaseOutput(config, "alsa"),
       m_handle(NULL),
       m_rate(0),
-      m_channels(0)
+      m_channels(0),
+      m_format(SND_PCM_FORMAT_UNKNOWN),
+      m_frameSize(0),
+      m_mmap(false)
 {
 }
 
@@ -36,6 +41,12 @@ player::Format AlsaOutput::getFormat() const
     return player::Format(m_rate, m_channels);
 }
 
+// =====================================================================================================================
+std::string AlsaOutput::getSampleFormat() const
+{
+    return snd_pcm_format_name(m_format);
+}
+
 // =====================================================================================================================
 int AlsaOutput::getFreeSize()
 {
@@ -55,15 +66,45 @@ int AlsaOutput::getFreeSize()
 // =====================================================================================================================
 void AlsaOutput::setup(int rate, int channels)
 {
+    // the device is reopened when it is set up again for a track with another sampling rate
+    if (m_handle)
+    {
+	snd_pcm_close(m_handle);
+	m_handle = NULL;
+    }
+
     if (snd_pcm_open(&m_handle, getPcmName().c_str(), SND_PCM_STREAM_PLAYBACK, 0) != 0)
 	throw OutputException("unable to open PCM device");
 
+    // the rates are probed at the first setup only because the decoder thread may read them later
+    if (m_rate == 0 && hasConfig() && getConfig().get("rate-switching", false).asBool())
+	probeRates();
+
     snd_pcm_hw_params_t* params;
 
     snd_pcm_hw_params_alloca(&params);
     snd_pcm_hw_params_any(m_handle, params);
-    snd_pcm_hw_params_set_access(m_handle, params, SND_PCM_ACCESS_RW_INTERLEAVED);
-    snd_pcm_hw_params_set_format(m_handle, params, SND_PCM_FORMAT_S16);
+
+    m_mmap = false;
+
+    if (hasConfig() && getConfig().get("mmap", false).asBool())
+    {
+	// samples are converted right into the ring buffer of the device in mmap mode
+	if (snd_pcm_hw_params_test_access(m_handle, params, SND_PCM_ACCESS_MMAP_INTERLEAVED) == 0)
+	    m_mmap = true;
+	else
+	    LOG("alsa: mmap access is not supported by the device, using read/write access");
+    }
+
+    snd_pcm_hw_params_set_access(m_handle,
+				 params,
+				 m_mmap ? SND_PCM_ACCESS_MMAP_INTERLEAVED : SND_PCM_ACCESS_RW_INTERLEAVED);
+
+    m_format = selectFormat(params);
+
+    if (snd_pcm_hw_params_set_format(m_handle, params, m_format) != 0)
+	throw OutputException("unable to set sample format");
+
     snd_pcm_hw_params_set_channels(m_handle, params, channels);
     snd_pcm_hw_params_set_rate(m_handle, params, rate, 0);
 
@@ -83,6 +124,15 @@ void AlsaOutput::setup(int rate, int channels)
 
     m_rate = rate;
     m_channels = channels;
+    m_frameSize = channels * getSampleSize(m_format);
+
+    LOG("alsa: using " << snd_pcm_format_name(m_format) << " samples" << (m_mmap ? " in mmap mode" : ""));
+}
+
+// =====================================================================================================================
+bool AlsaOutput::isRateSupported(int rate) const
+{
+    return std::find(m_rates.begin(), m_rates.end(), static_cast<unsigned>(rate)) != m_rates.end();
 }
 
 // =====================================================================================================================
@@ -100,15 +150,27 @@ void AlsaOutput::drop()
 }
 
 // =====================================================================================================================
-void AlsaOutput::write(const float* samples, size_t count)
+void AlsaOutput::drain()
 {
-    m_buffer.resize(count * m_channels);
+    if (snd_pcm_drain(m_handle) != 0)
+	LOG("alsa: unable to drain buffered samples");
+}
+
+// =====================================================================================================================
+void AlsaOutput::write(const float* samples, size_t count, float gain)
+{
+    if (m_mmap)
+    {
+	writeMmap(samples, count, gain);
+	return;
+    }
 
-    // convert float samples to signed 16bit integer
-    for (size_t i = 0; i < m_buffer.size(); ++i)
-	m_buffer[i] = samples[i] * 32767;
+    m_buffer.resize(count * m_frameSize);
 
-    const int16_t* data = &m_buffer[0];
+    // apply the volume and convert the samples to the format of the device
+    convert(samples, &m_buffer[0], count * m_channels, gain);
+
+    const uint8_t* data = &m_buffer[0];
 
     while (count > 0)
     {
@@ -118,12 +180,189 @@ void AlsaOutput::write(const float* samples, size_t count)
 	    handleError(ret);
 	else
 	{
-	    data += ret * m_channels;
+	    data += ret * m_frameSize;
 	    count -= ret;
 	}
     }
 }
 
+// =====================================================================================================================
+void AlsaOutput::writeMmap(const float* samples, size_t count, float gain)
+{
+    while (count > 0)
+    {
+	// the available space has to be updated before accessing the ring buffer
+	snd_pcm_sframes_t avail = snd_pcm_avail_update(m_handle);
+
+	if (avail < 0)
+	{
+	    handleError(avail);
+	    continue;
+	}
+
+	if (avail == 0)
+	{
+	    int ret = snd_pcm_wait(m_handle, -1);
+
+	    if (ret < 0)
+		handleError(ret);
+
+	    continue;
+	}
+
+	const snd_pcm_channel_area_t* areas;
+	snd_pcm_uframes_t offset;
+	snd_pcm_uframes_t frames = count;
+
+	int ret = snd_pcm_mmap_begin(m_handle, &areas, &offset, &frames);
+
+	if (ret < 0)
+	{
+	    handleError(ret);
+	    continue;
+	}
+
+	// the channels are interleaved, so the first area describes the whole ring buffer
+	uint8_t* dst = reinterpret_cast<uint8_t*>(areas[0].addr) + (areas[0].first + offset * areas[0].step) / 8;
+
+	convert(samples, dst, frames * m_channels, gain);
+
+	snd_pcm_sframes_t committed = snd_pcm_mmap_commit(m_handle, offset, frames);
+
+	if (committed < 0)
+	{
+	    handleError(committed);
+	    continue;
+	}
+
+	samples += committed * m_channels;
+	count -= committed;
+
+	// unlike snd_pcm_writei() committing does not start the playback automatically
+	if (snd_pcm_state(m_handle) == SND_PCM_STATE_PREPARED && snd_pcm_start(m_handle) < 0)
+	    LOG("alsa: unable to start playback");
+    }
+}
+
+// =====================================================================================================================
+void AlsaOutput::getPollDescriptors(std::vector<pollfd>& fds)
+{
+    int count = snd_pcm_poll_descriptors_count(m_handle);
+
+    if (count <= 0)
+	return;
+
+    size_t offset = fds.size();
+    fds.resize(offset + count);
+
+    count = snd_pcm_poll_descriptors(m_handle, &fds[offset], count);
+    fds.resize(offset + std::max(count, 0));
+}
+
+// =====================================================================================================================
+void AlsaOutput::handlePollEvents(pollfd* fds, size_t count)
+{
+    unsigned short revents;
+
+    // let alsa-lib translate the events of its plugins, errors will be handled by the next getFreeSize() call
+    if (snd_pcm_poll_descriptors_revents(m_handle, fds, count, &revents) < 0)
+	LOG("alsa: unable to get poll events");
+}
+
+// =====================================================================================================================
+void AlsaOutput::probeRates()
+{
+    static const unsigned s_rates[] = { 44100, 48000, 88200, 96000, 176400, 192000 };
+
+    snd_pcm_hw_params_t* params;
+
+    snd_pcm_hw_params_alloca(&params);
+    snd_pcm_hw_params_any(m_handle, params);
+
+    // rates provided by the rate plugin of alsa-lib would be resampled anyway, so they are not accepted here
+    snd_pcm_hw_params_set_rate_resample(m_handle, params, 0);
+
+    for (unsigned rate : s_rates)
+    {
+	if (snd_pcm_hw_params_test_rate(m_handle, params, rate, 0) == 0)
+	{
+	    LOG("alsa: native sampling rate: " << rate);
+	    m_rates.push_back(rate);
+	}
+    }
+}
+
+// =====================================================================================================================
+snd_pcm_format_t AlsaOutput::selectFormat(snd_pcm_hw_params_t* params)
+{
+    // the preferred formats, float samples can be written without losing precision
+    static const snd_pcm_format_t s_formats[] = {
+	SND_PCM_FORMAT_FLOAT_LE,
+	SND_PCM_FORMAT_S32_LE,
+	SND_PCM_FORMAT_S24_3LE,
+	SND_PCM_FORMAT_S16_LE
+    };
+
+    std::string forced;
+
+    if (hasConfig() && getConfig().isMember("format"))
+	forced = getConfig()["format"].asString();
+
+    for (snd_pcm_format_t format : s_formats)
+    {
+	if (!forced.empty() && forced != snd_pcm_format_name(format))
+	    continue;
+
+	if (snd_pcm_hw_params_test_format(m_handle, params, format) == 0)
+	    return format;
+    }
+
+    if (!forced.empty())
+	throw OutputException(utils::MakeString() << "unsupported sample format: " << forced);
+
+    throw OutputException("no supported sample format");
+}
+
+// =====================================================================================================================
+size_t AlsaOutput::getSampleSize(snd_pcm_format_t format)
+{
+    switch (format)
+    {
+	case SND_PCM_FORMAT_FLOAT_LE :
+	case SND_PCM_FORMAT_S32_LE :
+	    return 4;
+
+	case SND_PCM_FORMAT_S24_3LE :
+	    return 3;
+
+	default :
+	    return 2;
+    }
+}
+
+// =====================================================================================================================
+void AlsaOutput::convert(const float* samples, uint8_t* dst, size_t count, float gain)
+{
+    switch (m_format)
+    {
+	case SND_PCM_FORMAT_FLOAT_LE :
+	    m_converter.f32(samples, reinterpret_cast<float*>(dst), count, gain);
+	    break;
+
+	case SND_PCM_FORMAT_S32_LE :
+	    m_converter.s32(samples, reinterpret_cast<int32_t*>(dst), count, gain);
+	    break;
+
+	case SND_PCM_FORMAT_S24_3LE :
+	    m_converter.s24(samples, dst, count, gain);
+	    break;
+
+	default :
+	    m_converter.s16(samples, reinterpret_cast<int16_t*>(dst), count, gain);
+	    break;
+    }
+}
+
 // =====================================================================================================================
 void AlsaOutput::handleError(int error)
 {
@@ -8,6 +8,7 @@
 #define OUTPUT_ALSA_H_INCLUDED
 
 #include "baseoutput.h"
+#include "formatconverter.h"
 
 #include <alsa/asoundlib.h>
 
@@ -21,17 +22,37 @@ class AlsaOutput : public BaseOutput
 	virtual ~AlsaOutput();
 
 	player::Format getFormat() const override;
+	std::string getSampleFormat() const override;
 
 	int getFreeSize() override;
 
 	void setup(int rate, int channels) override;
+	bool isRateSupported(int rate) const override;
 
 	void prepare() override;
 	void drop() override;
+	void drain() override;
 
-	void write(const float* samples, size_t count) override;
+	void write(const float* samples, size_t count, float gain) override;
+
+	void getPollDescriptors(std::vector<pollfd>& fds) override;
+	void handlePollEvents(pollfd* fds, size_t count) override;
 
     private:
+	// collects the sampling rates supported by the device without resampling in alsa-lib
+	void probeRates();
+
+	// selects the best sample format supported by the device
+	snd_pcm_format_t selectFormat(snd_pcm_hw_params_t* params);
+	// returns the size of one sample in bytes
+	static size_t getSampleSize(snd_pcm_format_t format);
+
+	// applies the volume and converts count samples to the selected sample format
+	void convert(const float* samples, uint8_t* dst, size_t count, float gain);
+
+	// writes the samples directly into the ring buffer of the device
+	void writeMmap(const float* samples, size_t count, float gain);
+
 	void handleError(int error);
 
 	std::string getPcmName() const;
@@ -42,7 +63,19 @@ class AlsaOutput : public BaseOutput
 	int m_rate;
 	int m_channels;
 
-	std::vector<int16_t> m_buffer;
+	snd_pcm_format_t m_format;
+	// size of one frame in bytes
+	size_t m_frameSize;
+
+	// true if the ring buffer of the device is accessed directly
+	bool m_mmap;
+
+	// native sampling rates the device can be switched to, empty if rate switching is turned off
+	std::vector<unsigned> m_rates;
+
+	FormatConverter m_converter;
+	// samples converted to the format of the device (not used in mmap mode)
+	std::vector<uint8_t> m_buffer;
 };
 
 }
@@ -28,3 +28,24 @@ const Json::Value& BaseOutput::getConfig() const
 {
     return *m_config;
 }
+
+// =====================================================================================================================
+bool BaseOutput::isRateSupported(int rate) const
+{
+    return false;
+}
+
+// =====================================================================================================================
+void BaseOutput::drain()
+{
+}
+
+// =====================================================================================================================
+void BaseOutput::getPollDescriptors(std::vector<pollfd>& fds)
+{
+}
+
+// =====================================================================================================================
+void BaseOutput::handlePollEvents(pollfd* fds, size_t count)
+{
+}
@@ -11,6 +11,9 @@
 #include <player/format.h>
 
 #include <stdexcept>
+#include <vector>
+
+#include <poll.h>
 
 namespace output
 {
@@ -33,18 +36,40 @@ class BaseOutput
 
 	// returns the format (sampling rate, channels, etc.) of the output
 	virtual player::Format getFormat() const = 0;
+	// returns the name of the sample format used by the device (e.g. S16_LE)
+	virtual std::string getSampleFormat() const = 0;
 
 	/// returns the number of available space for free samples on the device
 	virtual int getFreeSize() = 0;
 
 	virtual void setup(int rate, int channels) = 0;
 
+	/**
+	 * Returns true if the device can be set up with the given sampling rate at a track boundary, so the samples of
+	 * the track can be played without resampling them. It may be called from the decoder thread.
+	 */
+	virtual bool isRateSupported(int rate) const;
+
 	// prepares the output for starting playback
 	virtual void prepare() = 0;
 	// drops already buffered samples from the output and stops playback
 	virtual void drop() = 0;
+	// blocks until the already buffered samples are played
+	virtual void drain();
 
-	virtual void write(const float* samples, size_t count) = 0;
+	/**
+	 * Plays the given frames. The samples are multiplied by the volume gain and clamped to the -1.0 ... 1.0 range
+	 * while they are converted to the format of the device.
+	 */
+	virtual void write(const float* samples, size_t count, float gain) = 0;
+
+	/**
+	 * Appends the descriptors that can be used with poll() to wait until the device is able to accept new samples.
+	 * Outputs without descriptors add nothing, the player polls them periodically in that case.
+	 */
+	virtual void getPollDescriptors(std::vector<pollfd>& fds);
+	// processes the events returned by poll() for the descriptors of the output
+	virtual void handlePollEvents(pollfd* fds, size_t count);
 
     protected:
 	// returns true in case of configuratio was set for this output
@@ -0,0 +1,406 @@
+/**
+ * This file is part of the Zeppelin music player project.
+ * Copyright (c) 2013-2014 Zoltan Kovacs, Lajos Santa
+ * See http://zeppelin-player.com for more details.
+ */
+
+#include "formatconverter.h"
+#include "baseoutput.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CONVERTER_X86
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#define CONVERTER_NEON
+#include <arm_neon.h>
+#endif
+
+using output::FormatConverter;
+using codec::SampleConverter;
+
+namespace output
+{
+
+struct FormatKernels
+{
+    const char* m_name;
+
+    void (*m_f32)(const float* src, float* dst, size_t count, float gain);
+    void (*m_s16)(const float* src, int16_t* dst, size_t count, float gain);
+    // 24 bit samples stored in 32 bit integers
+    void (*m_s24)(const float* src, int32_t* dst, size_t count, float gain);
+    void (*m_s32)(const float* src, int32_t* dst, size_t count, float gain);
+};
+
+}
+
+using output::FormatKernels;
+
+// =====================================================================================================================
+// scalar implementation, it is the reference of the vectorized ones and handles the tail of the buffers as well
+
+static inline float gainSample(float in, float gain)
+{
+    float out = in * gain;
+
+    if (out > 1.0f)
+	out = 1.0f;
+    else if (out < -1.0f)
+	out = -1.0f;
+
+    return out;
+}
+
+// =====================================================================================================================
+static void scalarF32(const float* src, float* dst, size_t count, float gain)
+{
+    for (size_t i = 0; i < count; ++i)
+	dst[i] = gainSample(src[i], gain);
+}
+
+// =====================================================================================================================
+static void scalarS16(const float* src, int16_t* dst, size_t count, float gain)
+{
+    for (size_t i = 0; i < count; ++i)
+	dst[i] = gainSample(src[i], gain) * 32767.0f;
+}
+
+// =====================================================================================================================
+static void scalarS24(const float* src, int32_t* dst, size_t count, float gain)
+{
+    for (size_t i = 0; i < count; ++i)
+	dst[i] = gainSample(src[i], gain) * 8388607.0f;
+}
+
+// =====================================================================================================================
+static void scalarS32(const float* src, int32_t* dst, size_t count, float gain)
+{
+    // 32 bit samples are made of 24 bit ones, scaling by 2^31 - 1 would overflow because it is rounded up as a float
+    for (size_t i = 0; i < count; ++i)
+	dst[i] = static_cast<int32_t>(gainSample(src[i], gain) * 8388607.0f) * 256;
+}
+
+static const FormatKernels s_scalar = { "scalar", scalarF32, scalarS16, scalarS24, scalarS32 };
+
+#ifdef CONVERTER_X86
+
+// =====================================================================================================================
+// SSE2 implementation
+
+#define TARGET_SSE2 __attribute__((target("sse2")))
+
+TARGET_SSE2 static inline __m128 sse2Gain(__m128 in, __m128 gain)
+{
+    return _mm_min_ps(_mm_max_ps(_mm_mul_ps(in, gain), _mm_set1_ps(-1.0f)), _mm_set1_ps(1.0f));
+}
+
+// =====================================================================================================================
+TARGET_SSE2 static inline __m128i sse2ToInt(__m128 in, __m128 gain, float scale)
+{
+    // truncation is used like in case of the scalar conversion
+    return _mm_cvttps_epi32(_mm_mul_ps(sse2Gain(in, gain), _mm_set1_ps(scale)));
+}
+
+// =====================================================================================================================
+TARGET_SSE2 static void sse2F32(const float* src, float* dst, size_t count, float gain)
+{
+    __m128 g = _mm_set1_ps(gain);
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4)
+	_mm_storeu_ps(dst + i, sse2Gain(_mm_loadu_ps(src + i), g));
+
+    scalarF32(src + i, dst + i, count - i, gain);
+}
+
+// =====================================================================================================================
+TARGET_SSE2 static void sse2S16(const float* src, int16_t* dst, size_t count, float gain)
+{
+    __m128 g = _mm_set1_ps(gain);
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8)
+    {
+	__m128i lo = sse2ToInt(_mm_loadu_ps(src + i), g, 32767.0f);
+	__m128i hi = sse2ToInt(_mm_loadu_ps(src + i + 4), g, 32767.0f);
+
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packs_epi32(lo, hi));
+    }
+
+    scalarS16(src + i, dst + i, count - i, gain);
+}
+
+// =====================================================================================================================
+TARGET_SSE2 static void sse2S24(const float* src, int32_t* dst, size_t count, float gain)
+{
+    __m128 g = _mm_set1_ps(gain);
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4)
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), sse2ToInt(_mm_loadu_ps(src + i), g, 8388607.0f));
+
+    scalarS24(src + i, dst + i, count - i, gain);
+}
+
+// =====================================================================================================================
+TARGET_SSE2 static void sse2S32(const float* src, int32_t* dst, size_t count, float gain)
+{
+    __m128 g = _mm_set1_ps(gain);
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4)
+    {
+	__m128i v = _mm_slli_epi32(sse2ToInt(_mm_loadu_ps(src + i), g, 8388607.0f), 8);
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), v);
+    }
+
+    scalarS32(src + i, dst + i, count - i, gain);
+}
+
+#undef TARGET_SSE2
+
+static const FormatKernels s_sse2 = { "sse2", sse2F32, sse2S16, sse2S24, sse2S32 };
+
+// =====================================================================================================================
+// AVX2 implementation
+
+#define TARGET_AVX2 __attribute__((target("avx2")))
+
+TARGET_AVX2 static inline __m256 avx2Gain(__m256 in, __m256 gain)
+{
+    return _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(in, gain), _mm256_set1_ps(-1.0f)), _mm256_set1_ps(1.0f));
+}
+
+// =====================================================================================================================
+TARGET_AVX2 static inline __m256i avx2ToInt(__m256 in, __m256 gain, float scale)
+{
+    return _mm256_cvttps_epi32(_mm256_mul_ps(avx2Gain(in, gain), _mm256_set1_ps(scale)));
+}
+
+// =====================================================================================================================
+TARGET_AVX2 static void avx2F32(const float* src, float* dst, size_t count, float gain)
+{
+    __m256 g = _mm256_set1_ps(gain);
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8)
+	_mm256_storeu_ps(dst + i, avx2Gain(_mm256_loadu_ps(src + i), g));
+
+    scalarF32(src + i, dst + i, count - i, gain);
+}
+
+// =====================================================================================================================
+TARGET_AVX2 static void avx2S16(const float* src, int16_t* dst, size_t count, float gain)
+{
+    __m256 g = _mm256_set1_ps(gain);
+    size_t i = 0;
+
+    for (; i + 16 <= count; i += 16)
+    {
+	__m256i lo = avx2ToInt(_mm256_loadu_ps(src + i), g, 32767.0f);
+	__m256i hi = avx2ToInt(_mm256_loadu_ps(src + i + 8), g, 32767.0f);
+
+	// packing works inside the 128 bit lanes, the 64 bit parts are put into the right order afterwards
+	__m256i v = _mm256_permute4x64_epi64(_mm256_packs_epi32(lo, hi), 0xd8);
+
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), v);
+    }
+
+    scalarS16(src + i, dst + i, count - i, gain);
+}
+
+// =====================================================================================================================
+TARGET_AVX2 static void avx2S24(const float* src, int32_t* dst, size_t count, float gain)
+{
+    __m256 g = _mm256_set1_ps(gain);
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8)
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), avx2ToInt(_mm256_loadu_ps(src + i), g, 8388607.0f));
+
+    scalarS24(src + i, dst + i, count - i, gain);
+}
+
+// =====================================================================================================================
+TARGET_AVX2 static void avx2S32(const float* src, int32_t* dst, size_t count, float gain)
+{
+    __m256 g = _mm256_set1_ps(gain);
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8)
+    {
+	__m256i v = _mm256_slli_epi32(avx2ToInt(_mm256_loadu_ps(src + i), g, 8388607.0f), 8);
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), v);
+    }
+
+    scalarS32(src + i, dst + i, count - i, gain);
+}
+
+#undef TARGET_AVX2
+
+static const FormatKernels s_avx2 = { "avx2", avx2F32, avx2S16, avx2S24, avx2S32 };
+
+#endif // CONVERTER_X86
+
+#ifdef CONVERTER_NEON
+
+// =====================================================================================================================
+// NEON implementation
+
+static inline float32x4_t neonGain(float32x4_t in, float32x4_t gain)
+{
+    return vminq_f32(vmaxq_f32(vmulq_f32(in, gain), vdupq_n_f32(-1.0f)), vdupq_n_f32(1.0f));
+}
+
+// =====================================================================================================================
+static inline int32x4_t neonToInt(float32x4_t in, float32x4_t gain, float scale)
+{
+    return vcvtq_s32_f32(vmulq_f32(neonGain(in, gain), vdupq_n_f32(scale)));
+}
+
+// =====================================================================================================================
+static inline int16x4_t neonToS16(float32x4_t in, float32x4_t gain)
+{
+    return vqmovn_s32(neonToInt(in, gain, 32767.0f));
+}
+
+// =====================================================================================================================
+static void neonF32(const float* src, float* dst, size_t count, float gain)
+{
+    float32x4_t g = vdupq_n_f32(gain);
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4)
+	vst1q_f32(dst + i, neonGain(vld1q_f32(src + i), g));
+
+    scalarF32(src + i, dst + i, count - i, gain);
+}
+
+// =====================================================================================================================
+static void neonS16(const float* src, int16_t* dst, size_t count, float gain)
+{
+    float32x4_t g = vdupq_n_f32(gain);
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8)
+	vst1q_s16(dst + i, vcombine_s16(neonToS16(vld1q_f32(src + i), g), neonToS16(vld1q_f32(src + i + 4), g)));
+
+    scalarS16(src + i, dst + i, count - i, gain);
+}
+
+// =====================================================================================================================
+static void neonS24(const float* src, int32_t* dst, size_t count, float gain)
+{
+    float32x4_t g = vdupq_n_f32(gain);
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4)
+	vst1q_s32(dst + i, neonToInt(vld1q_f32(src + i), g, 8388607.0f));
+
+    scalarS24(src + i, dst + i, count - i, gain);
+}
+
+// =====================================================================================================================
+static void neonS32(const float* src, int32_t* dst, size_t count, float gain)
+{
+    float32x4_t g = vdupq_n_f32(gain);
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4)
+	vst1q_s32(dst + i, vshlq_n_s32(neonToInt(vld1q_f32(src + i), g, 8388607.0f), 8));
+
+    scalarS32(src + i, dst + i, count - i, gain);
+}
+
+static const FormatKernels s_neon = { "neon", neonF32, neonS16, neonS24, neonS32 };
+
+#endif // CONVERTER_NEON
+
+// =====================================================================================================================
+static const FormatKernels* getKernels(SampleConverter::Implementation impl)
+{
+    switch (impl)
+    {
+#ifdef CONVERTER_X86
+	case SampleConverter::SSE2 :
+	    return &s_sse2;
+
+	case SampleConverter::AVX2 :
+	    return &s_avx2;
+#endif
+
+#ifdef CONVERTER_NEON
+	case SampleConverter::NEON :
+	    return &s_neon;
+#endif
+
+	default :
+	    return &s_scalar;
+    }
+}
+
+// =====================================================================================================================
+FormatConverter::FormatConverter()
+    : m_kernels(getKernels(SampleConverter().getImplementation()))
+{
+}
+
+// =====================================================================================================================
+FormatConverter::FormatConverter(SampleConverter::Implementation impl)
+{
+    if (!SampleConverter::isSupported(impl))
+	throw OutputException("unsupported format converter implementation");
+
+    m_kernels = getKernels(impl);
+}
+
+// =====================================================================================================================
+const char* FormatConverter::getName() const
+{
+    return m_kernels->m_name;
+}
+
+// =====================================================================================================================
+void FormatConverter::f32(const float* src, float* dst, size_t count, float gain) const
+{
+    m_kernels->m_f32(src, dst, count, gain);
+}
+
+// =====================================================================================================================
+void FormatConverter::s16(const float* src, int16_t* dst, size_t count, float gain) const
+{
+    m_kernels->m_s16(src, dst, count, gain);
+}
+
+// =====================================================================================================================
+void FormatConverter::s24(const float* src, uint8_t* dst, size_t count, float gain) const
+{
+    const size_t chunk = 256;
+    int32_t buffer[chunk];
+
+    // convert the samples to 32 bit integers in chunks and pack them into 3 bytes
+    while (count > 0)
+    {
+	size_t n = count < chunk ? count : chunk;
+
+	m_kernels->m_s24(src, buffer, n, gain);
+
+	for (size_t i = 0; i < n; ++i, dst += 3)
+	{
+	    uint32_t v = buffer[i];
+
+	    dst[0] = v;
+	    dst[1] = v >> 8;
+	    dst[2] = v >> 16;
+	}
+
+	src += n;
+	count -= n;
+    }
+}
+
+// =====================================================================================================================
+void FormatConverter::s32(const float* src, int32_t* dst, size_t count, float gain) const
+{
+    m_kernels->m_s32(src, dst, count, gain);
+}
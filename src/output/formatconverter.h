@@ -0,0 +1,54 @@
+/**
+ * This file is part of the Zeppelin music player project.
+ * Copyright (c) 2013-2014 Zoltan Kovacs, Lajos Santa
+ * See http://zeppelin-player.com for more details.
+ */
+
+#ifndef OUTPUT_FORMATCONVERTER_H_INCLUDED
+#define OUTPUT_FORMATCONVERTER_H_INCLUDED
+
+#include <codec/sampleconverter.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace output
+{
+
+struct FormatKernels;
+
+/**
+ * Converts the float samples of the player to the sample format of the output device.
+ *
+ * The volume gain is applied, the samples are clamped to the -1.0 ... 1.0 range and converted in a single pass. The
+ * vectorized implementations produce exactly the same results as the scalar one.
+ */
+class FormatConverter
+{
+    public:
+	/// creates a converter using the best implementation supported by the CPU
+	FormatConverter();
+	/**
+	 * Creates a converter using the given implementation.
+	 * OutputException is thrown if the implementation is not supported by the CPU.
+	 */
+	FormatConverter(codec::SampleConverter::Implementation impl);
+
+	const char* getName() const;
+
+	/// converts count interleaved samples
+	void f32(const float* src, float* dst, size_t count, float gain) const;
+	void s16(const float* src, int16_t* dst, size_t count, float gain) const;
+	/// 24 bit samples are packed into 3 bytes in little endian order
+	void s24(const float* src, uint8_t* dst, size_t count, float gain) const;
+	/// 32 bit samples have 24 bits of precision (the same as the float samples have)
+	void s32(const float* src, int32_t* dst, size_t count, float gain) const;
+
+    private:
+	// function table of the selected implementation
+	const FormatKernels* m_kernels;
+};
+
+}
+
+#endif
@@ -8,6 +8,8 @@
 
 #include <zeppelin/logger.h>
 
+#include <algorithm>
+
 using output::PulseAudio;
 
 // =====================================================================================================================
@@ -27,6 +29,13 @@ player::Format PulseAudio::getFormat() const
     return player::Format(m_rate, m_channels);
 }
 
+// =====================================================================================================================
+std::string PulseAudio::getSampleFormat() const
+{
+    // float samples are passed to the server, it does the conversion for the device
+    return "FLOAT_LE";
+}
+
 // =====================================================================================================================
 int PulseAudio::getFreeSize()
 {
@@ -84,6 +93,8 @@ void PulseAudio::setup(int rate, int channels)
 
     // see context state callback above for details :]
     pa_stream_set_state_callback(m_stream, _streamStateCallback, this);
+    // wake up the player when the stream is able to accept new samples
+    pa_stream_set_write_callback(m_stream, _writeCallback, this);
 
     // connect stream
     if (pa_stream_connect_playback(m_stream, NULL, NULL, PA_STREAM_NOFLAGS, NULL, NULL) != 0)
@@ -140,18 +151,56 @@ void PulseAudio::drop()
 }
 
 // =====================================================================================================================
-void PulseAudio::write(const float* samples, size_t count)
+void PulseAudio::write(const float* samples, size_t count, float gain)
 {
-    int result;
+    size_t size = count * m_channels * sizeof(float);
+    int result = 0;
 
     pa_threaded_mainloop_lock(m_mainloop);
-    result = pa_stream_write(m_stream, samples, count * m_channels * sizeof(float), NULL, 0, PA_SEEK_RELATIVE);
+
+    while (size > 0 && result >= 0)
+    {
+	void* data;
+	size_t bytes = size;
+
+	// the volume is applied while copying the samples into the buffer of the stream
+	result = pa_stream_begin_write(m_stream, &data, &bytes);
+
+	if (result < 0)
+	    break;
+
+	bytes = std::min(bytes, size);
+	m_converter.f32(samples, reinterpret_cast<float*>(data), bytes / sizeof(float), gain);
+
+	result = pa_stream_write(m_stream, data, bytes, NULL, 0, PA_SEEK_RELATIVE);
+
+	samples += bytes / sizeof(float);
+	size -= bytes;
+    }
+
     pa_threaded_mainloop_unlock(m_mainloop);
 
     if (result < 0)
 	throw OutputException("unable to play samples");
 }
 
+// =====================================================================================================================
+void PulseAudio::getPollDescriptors(std::vector<pollfd>& fds)
+{
+    pollfd fd;
+    fd.fd = m_writable.getFd();
+    fd.events = POLLIN;
+    fd.revents = 0;
+
+    fds.push_back(fd);
+}
+
+// =====================================================================================================================
+void PulseAudio::handlePollEvents(pollfd* fds, size_t count)
+{
+    m_writable.clear();
+}
+
 // =====================================================================================================================
 void PulseAudio::contextStateCallback(pa_context* context)
 {
@@ -190,6 +239,12 @@ void PulseAudio::flushSuccessCallback(pa_stream* stream, int success)
     pa_threaded_mainloop_signal(m_mainloop, 0);
 }
 
+// =====================================================================================================================
+void PulseAudio::writeCallback(pa_stream* stream, size_t size)
+{
+    m_writable.signal();
+}
+
 // =====================================================================================================================
 void PulseAudio::_contextStateCallback(pa_context* context, void* p)
 {
@@ -210,3 +265,10 @@ void PulseAudio::_flushSuccessCallback(pa_stream* stream, int success, void* p)
     PulseAudio* pa = reinterpret_cast<PulseAudio*>(p);
     pa->flushSuccessCallback(stream, success);
 }
+
+// =====================================================================================================================
+void PulseAudio::_writeCallback(pa_stream* stream, size_t size, void* p)
+{
+    PulseAudio* pa = reinterpret_cast<PulseAudio*>(p);
+    pa->writeCallback(stream, size);
+}
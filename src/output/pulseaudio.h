@@ -8,6 +8,9 @@
 #define OUTPUT_PULSEAUDIO_H_INCLUDED
 
 #include "baseoutput.h"
+#include "formatconverter.h"
+
+#include <thread/notifier.h>
 
 #include <pulse/pulseaudio.h>
 
@@ -20,6 +23,7 @@ class PulseAudio : public BaseOutput
 	PulseAudio(const config::Config& config);
 
 	player::Format getFormat() const override;
+	std::string getSampleFormat() const override;
 
 	int getFreeSize() override;
 
@@ -28,16 +32,21 @@ class PulseAudio : public BaseOutput
 	void prepare() override;
 	void drop() override;
 
-	void write(const float* samples, size_t count) override;
+	void write(const float* samples, size_t count, float gain) override;
+
+	void getPollDescriptors(std::vector<pollfd>& fds) override;
+	void handlePollEvents(pollfd* fds, size_t count) override;
 
     private:
 	void contextStateCallback(pa_context* context);
 	void streamStateCallback(pa_stream* stream);
 	void flushSuccessCallback(pa_stream* stream, int success);
+	void writeCallback(pa_stream* stream, size_t size);
 
 	static void _contextStateCallback(pa_context* context, void* p);
 	static void _streamStateCallback(pa_stream* stream, void* p);
 	static void _flushSuccessCallback(pa_stream* stream, int success, void* p);
+	static void _writeCallback(pa_stream* stream, size_t size, void* p);
 
     private:
 	int m_rate;
@@ -46,6 +55,11 @@ class PulseAudio : public BaseOutput
 	pa_threaded_mainloop* m_mainloop;
 	pa_context* m_context;
 	pa_stream* m_stream;
+
+	// signalled from the mainloop thread when the stream is able to accept new samples
+	thread::Notifier m_writable;
+
+	FormatConverter m_converter;
 };
 
 }
@@ -19,9 +19,10 @@ using player::ControllerImpl;
 std::shared_ptr<ControllerImpl> ControllerImpl::create(const codec::CodecManager& codecManager,
 						       const std::shared_ptr<Decoder>& decoder,
 						       const std::shared_ptr<Player>& player,
+						       const std::shared_ptr<Preloader>& preloader,
 						       const config::Config& config)
 {
-    std::shared_ptr<ControllerImpl> ctrl(new ControllerImpl(codecManager, decoder, player, config));
+    std::shared_ptr<ControllerImpl> ctrl(new ControllerImpl(codecManager, decoder, player, preloader, config));
     ctrl->m_selfRef = ctrl;
     ctrl->init();
     return ctrl;
@@ -31,13 +32,16 @@ std::shared_ptr<ControllerImpl> ControllerImpl::create(const codec::CodecManager
 ControllerImpl::ControllerImpl(const codec::CodecManager& codecManager,
 			       const std::shared_ptr<Decoder>& decoder,
 			       const std::shared_ptr<Player>& player,
+			       const std::shared_ptr<Preloader>& preloader,
 			       const config::Config& config)
     : m_state(STOPPED),
       m_decoderQueue(-1),
       m_decoderInitialized(false),
       m_playerQueue(-1),
+      m_seekPosition(-1),
       m_decoder(decoder),
       m_player(player),
+      m_preloader(preloader),
       m_codecManager(codecManager)
 {
 }
@@ -79,6 +83,9 @@ zeppelin::player::Controller::Status ControllerImpl::getStatus()
     s.m_state = m_state;
     s.m_position = m_player->getPosition();
     s.m_volume = m_player->getVolumeFilter().getLevel();
+    s.m_sampleFormat = m_player->getSampleFormat();
+    s.m_resampleQuality = m_decoder->getResampleQuality();
+    s.m_decoderHeadroom = m_decoder->getHeadroom();
 
     return s;
 }
@@ -188,6 +195,22 @@ void ControllerImpl::command(Command cmd)
     m_cond.signal();
 }
 
+// =====================================================================================================================
+void ControllerImpl::seekFailed(off_t seconds)
+{
+    thread::BlockLock bl(m_mutex);
+    m_commands.push_back(std::make_shared<Seek>(seconds, SEEK_FAILED));
+    m_cond.signal();
+}
+
+// =====================================================================================================================
+void ControllerImpl::formatFailed(int rate, const Format& format)
+{
+    thread::BlockLock bl(m_mutex);
+    m_commands.push_back(std::make_shared<FormatFailed>(rate, format));
+    m_cond.signal();
+}
+
 // =====================================================================================================================
 void ControllerImpl::run()
 {
@@ -278,23 +301,61 @@ void ControllerImpl::processCommands()
 		if (m_state != PLAYING && m_state != PAUSED)
 		    break;
 
-		if (m_state == PLAYING)
-		    stopPlayback();
-
-		// set decoder queue index to the same as the player
-		setDecoderToPlayerIndex();
-		// load the file into the decoder
-		setDecoderInput();
+		// a burst of seek requests (e.g. dragging the position slider) is coalesced into the last one
+		if (!m_commands.empty() && m_commands.front()->m_cmd == SEEK)
+		    break;
 
-		// seek to the given position
-		m_decoder->seek(s.m_seconds);
-		m_player->seek(s.m_seconds);
+		if (isDecoderAtPlayerIndex())
+		{
+		    // The decoder is still working on the played file, so it can seek in the already opened input.
+		    // The samples of the old position are flushed from the fifo without stopping the decoder and the
+		    // player.
+		    m_player->seek(s.m_seconds);
+		    m_decoder->seek(s.m_seconds);
+
+		    // the decoder may close the input at the end of the stream before receiving the seek request
+		    m_seekPosition = s.m_seconds;
+		}
+		else
+		    reopenAndSeek(s.m_seconds);
 
 		// send event
 		m_listenerProxy.positionChanged(s.m_seconds);
 
-		if (m_state == PLAYING)
-		    startPlayback();
+		break;
+	    }
+
+	    case SEEK_FAILED :
+	    {
+		Seek& s = static_cast<Seek&>(*cmd);
+
+		LOG("controller: seek failed " << s.m_seconds);
+
+		// The decoder finished the played file before receiving the seek request. The player is already at the
+		// new position, so the file is loaded into the decoder again unless the played song changed since then.
+		if ((m_state != PLAYING && m_state != PAUSED) || m_seekPosition != s.m_seconds)
+		    break;
+
+		reopenAndSeek(s.m_seconds);
+
+		break;
+	    }
+
+	    case FORMAT_FAILED :
+	    {
+		FormatFailed& f = static_cast<FormatFailed&>(*cmd);
+
+		LOG("controller: format failed " << f.m_rate);
+
+		// the decoder has to resample the tracks with this rate to the format the output is working with
+		m_decoder->rejectRate(f.m_rate, f.m_format);
+
+		if (m_state != PLAYING && m_state != PAUSED)
+		    break;
+
+		// The samples decoded with the rejected rate are dropped by loading the played track into the decoder
+		// again. The player stopped at the beginning of it, unless it was seeked since then.
+		reopenAndSeek(m_player->getPosition());
 
 		break;
 	    }
@@ -305,6 +366,8 @@ void ControllerImpl::processCommands()
 	    {
 		LOG("controller: prev/next/goto (" << cmd->m_cmd << ")");
 
+		m_seekPosition = -1;
+
 		if (m_state == PLAYING || m_state == PAUSED)
 		{
 		    stopPlayback();
@@ -390,6 +453,8 @@ void ControllerImpl::processCommands()
 
 		if (removingCurrent)
 		{
+		    m_seekPosition = -1;
+
 		    if (m_state == PLAYING || m_state == PAUSED)
 		    {
 			// stop the decoder and the player because we are removing the currently played song
@@ -435,6 +500,8 @@ void ControllerImpl::processCommands()
 	    case REMOVE_ALL :
 		LOG("controller: remove-all");
 
+		m_seekPosition = -1;
+
 		if (m_state == PLAYING || m_state == PAUSED)
 		{
 		    // stop playback
@@ -463,6 +530,8 @@ void ControllerImpl::processCommands()
 		if (m_state != PLAYING && m_state != PAUSED)
 		    break;
 
+		m_seekPosition = -1;
+
 		// stop both the decoder and the player threads
 		stopPlayback();
 
@@ -498,6 +567,8 @@ void ControllerImpl::processCommands()
 	    case SONG_FINISHED :
 		LOG("controller: song finished");
 
+		m_seekPosition = -1;
+
 		// step to the next song
 		if (!m_playerQueue.next())
 		{
@@ -554,9 +625,12 @@ void ControllerImpl::setDecoderInput()
 
 	LOG("controller: playing: " << file.m_path << "/" << file.m_name);
 
-	m_decoder->setInput(input);
+	m_decoder->setInput(input, file.m_id);
 	m_decoderInitialized = true;
 
+	// open the next file while this one is being decoded
+	preloadNext();
+
 	return;
     }
 
@@ -567,7 +641,7 @@ void ControllerImpl::setDecoderInput()
 void ControllerImpl::invalidateDecoder()
 {
     if (m_decoderInitialized)
-	m_decoder->setInput(nullptr);
+	m_decoder->setInput(nullptr, -1);
 
     m_decoderInitialized = false;
 }
@@ -581,9 +655,67 @@ void ControllerImpl::setDecoderToPlayerIndex()
     m_decoderQueue.set(it);
 }
 
+// =====================================================================================================================
+bool ControllerImpl::isDecoderAtPlayerIndex()
+{
+    if (!m_decoderInitialized || !m_playerQueue.isValid() || !m_decoderQueue.isValid())
+	return false;
+
+    std::vector<int> playerIt;
+    std::vector<int> decoderIt;
+
+    m_playerQueue.get(playerIt);
+    m_decoderQueue.get(decoderIt);
+
+    return playerIt == decoderIt;
+}
+
+// =====================================================================================================================
+void ControllerImpl::reopenAndSeek(off_t seconds)
+{
+    m_seekPosition = -1;
+
+    if (m_state == PLAYING)
+	stopPlayback();
+
+    // set decoder queue index to the same as the player
+    setDecoderToPlayerIndex();
+    // load the file into the decoder
+    setDecoderInput();
+
+    // seek to the given position
+    m_decoder->seek(seconds);
+    m_player->seek(seconds);
+
+    if (m_state == PLAYING)
+	startPlayback();
+}
+
+// =====================================================================================================================
+void ControllerImpl::preloadNext()
+{
+    std::vector<int> it;
+    m_decoderQueue.get(it);
+
+    if (m_decoderQueue.next())
+    {
+	const zeppelin::library::File& file = *m_decoderQueue.file();
+	m_preloader->preload(file.m_path + "/" + file.m_name);
+    }
+
+    // restore the original position of the decoder queue
+    m_decoderQueue.set(it);
+}
+
 // =====================================================================================================================
 std::shared_ptr<codec::BaseCodec> ControllerImpl::open(const std::string& file)
 {
+    // use the input opened in the background if it is available
+    std::shared_ptr<codec::BaseCodec> preloaded = m_preloader->take(file);
+
+    if (preloaded)
+	return preloaded;
+
     // create the codec instance
     std::shared_ptr<codec::BaseCodec> input = m_codecManager.create(file);
 
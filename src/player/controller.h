@@ -9,6 +9,7 @@
 
 #include "decoder.h"
 #include "player.h"
+#include "preloader.h"
 #include "fifo.h"
 #include "eventlistenerproxy.h"
 
@@ -46,12 +47,17 @@ class ControllerImpl : public zeppelin::player::Controller,
 	    // sent by the player thread once all samples of the current track have been written to the output
 	    SONG_FINISHED,
 	    // sent by the decoder thread when the decoding of the current file has been finished
-	    DECODER_FINISHED
+	    DECODER_FINISHED,
+	    // sent by the decoder thread when a seek could not be performed because its input was already closed
+	    SEEK_FAILED,
+	    // sent by the player thread when the output device could not be set up with the rate of the next track
+	    FORMAT_FAILED
 	};
 
 	static std::shared_ptr<ControllerImpl> create(const codec::CodecManager& codecManager,
 						      const std::shared_ptr<Decoder>& decoder,
 						      const std::shared_ptr<Player>& player,
+						      const std::shared_ptr<Preloader>& preloader,
 						      const config::Config& config);
 
 	void addListener(const std::shared_ptr<zeppelin::player::EventListener>& listener) override;
@@ -83,6 +89,10 @@ class ControllerImpl : public zeppelin::player::Controller,
 	void setVolume(int level);
 
 	void command(Command cmd);
+	/// called by the decoder when it was unable to seek to the given position
+	void seekFailed(off_t seconds);
+	/// called by the player when the output could not be switched to the given rate and kept working with format
+	void formatFailed(int rate, const Format& format);
 
 	/// the mainloop of the controller
 	void run() override;
@@ -91,6 +101,7 @@ class ControllerImpl : public zeppelin::player::Controller,
 	ControllerImpl(const codec::CodecManager& codecManager,
 		       const std::shared_ptr<Decoder>& decoder,
 		       const std::shared_ptr<Player>& player,
+		       const std::shared_ptr<Preloader>& preloader,
 		       const config::Config& config);
 
 	// called to initialize the controller after m_selfRef is usable
@@ -107,6 +118,12 @@ class ControllerImpl : public zeppelin::player::Controller,
 	void invalidateDecoder();
 	// sets the decoder queue index to the same position as the player queue
 	void setDecoderToPlayerIndex();
+	// returns true if the decoder is working on the file that is being played
+	bool isDecoderAtPlayerIndex();
+	// seeks by loading the played file into the decoder again
+	void reopenAndSeek(off_t seconds);
+	// starts opening the file following the current one of the decoder queue in the background
+	void preloadNext();
 
 	std::shared_ptr<codec::BaseCodec> open(const std::string& file);
 
@@ -122,6 +139,10 @@ class ControllerImpl : public zeppelin::player::Controller,
 
 	zeppelin::player::Playlist m_playerQueue;
 
+	// position of the last seek sent to the already opened input of the decoder, -1 if there is none, it is used
+	// to repeat the seek if the decoder closed the input before receiving it
+	off_t m_seekPosition;
+
 	struct CmdBase
 	{
 	    CmdBase(Command cmd) : m_cmd(cmd) {}
@@ -130,10 +151,17 @@ class ControllerImpl : public zeppelin::player::Controller,
 
 	struct Seek : public CmdBase
 	{
-	    Seek(off_t seconds) : CmdBase(SEEK), m_seconds(seconds) {}
+	    Seek(off_t seconds, Command cmd = SEEK) : CmdBase(cmd), m_seconds(seconds) {}
 	    off_t m_seconds;
 	};
 
+	struct FormatFailed : public CmdBase
+	{
+	    FormatFailed(int rate, const Format& format) : CmdBase(FORMAT_FAILED), m_rate(rate), m_format(format) {}
+	    int m_rate;
+	    Format m_format;
+	};
+
 	struct GoTo : public CmdBase
 	{
 	    GoTo(const std::vector<int>& index) : CmdBase(GOTO), m_index(index) {}
@@ -155,6 +183,9 @@ class ControllerImpl : public zeppelin::player::Controller,
 	/// player thread putting decoded samples to the output device
 	std::shared_ptr<Player> m_player;
 
+	/// opens the next file of the decoder queue in the background
+	std::shared_ptr<Preloader> m_preloader;
+
 	thread::Mutex m_mutex;
 	thread::Condition m_cond;
 
@@ -12,27 +12,57 @@
 
 #include <zeppelin/logger.h>
 
+#include <algorithm>
+#include <cstring>
+
 using player::Decoder;
 
+// maximum number of frames served from the cache in one decoding round
+static const size_t s_cacheReadFrames = 4096;
+// number of frames decoded from the input in one decoding round
+static const size_t s_decodeFrames = 8192;
+
+// length of the audio in seconds the headroom is measured on
+static const unsigned s_headroomSeconds = 5;
+// the resampler quality is lowered below the first headroom and raised above the second one
+static const double s_lowHeadroom = 4.0;
+static const double s_highHeadroom = 20.0;
+
 // =====================================================================================================================
 Decoder::Decoder(size_t bufferSize,
-		 const Format& outputFormat,
+		 const std::shared_ptr<output::BaseOutput>& output,
 		 Fifo& fifo,
 		 const config::Config& config)
     : m_bufferSize(bufferSize),
       m_fifo(fifo),
+      m_fileId(-1),
+      m_position(0),
+      m_inputSynced(true),
+      m_collecting(false),
+      m_output(output),
       m_format(0, 0),
-      m_outputFormat(outputFormat),
+      m_outputFormat(output->getFormat()),
       m_resampling(false),
+      m_quality(filter::Resample::getQuality(config, "quality", filter::Resample::BEST)),
+      m_minQuality(filter::Resample::getQuality(config, "min-quality", filter::Resample::FASTEST)),
+      m_maxQuality(filter::Resample::getQuality(config, "max-quality", filter::Resample::BEST)),
+      m_adaptive(config.m_raw["filter"]["resample"].get("adaptive", false).asBool()),
+      m_busyTime(0),
+      m_busyFrames(0),
+      m_headroom(0.0f),
+      m_resampleQuality(-1),
       m_config(config)
 {
+    // the configured quality is the starting point of the automatic adjustment
+    if (m_adaptive)
+	m_quality = std::min(std::max(m_quality, m_minQuality), m_maxQuality);
 }
 
 // =====================================================================================================================
-void Decoder::setInput(const std::shared_ptr<codec::BaseCodec>& input)
+void Decoder::setInput(const std::shared_ptr<codec::BaseCodec>& input, int fileId)
 {
     thread::BlockLock bl(m_mutex);
-    m_commands.push_back(std::make_shared<Input>(input));
+    m_commands.push_back(std::make_shared<Input>(input, fileId));
     m_cond.signal();
 }
 
@@ -42,6 +72,12 @@ void Decoder::setController(const std::weak_ptr<ControllerImpl>& controller)
     m_ctrl = controller;
 }
 
+// =====================================================================================================================
+void Decoder::setCache(const std::shared_ptr<PcmCache>& cache)
+{
+    m_cache = cache;
+}
+
 // =====================================================================================================================
 void Decoder::startDecoding()
 {
@@ -70,6 +106,14 @@ void Decoder::seek(off_t seconds)
     m_cond.signal();
 }
 
+// =====================================================================================================================
+void Decoder::rejectRate(int rate, const Format& format)
+{
+    thread::BlockLock bl(m_mutex);
+    m_commands.push_back(std::make_shared<RejectRate>(rate, format));
+    m_cond.signal();
+}
+
 // =====================================================================================================================
 void Decoder::notify()
 {
@@ -78,6 +122,23 @@ void Decoder::notify()
     m_cond.signal();
 }
 
+// =====================================================================================================================
+float Decoder::getHeadroom() const
+{
+    return m_headroom;
+}
+
+// =====================================================================================================================
+std::string Decoder::getResampleQuality() const
+{
+    int quality = m_resampleQuality;
+
+    if (quality < 0)
+	return "";
+
+    return filter::Resample::getQualityName(static_cast<filter::Resample::Quality>(quality));
+}
+
 // =====================================================================================================================
 void Decoder::run()
 {
@@ -97,6 +158,11 @@ void Decoder::run()
 	// reset wait to true here ...
 	wait = true;
 
+	// position to seek to after processing the commands, -1 means no seeking
+	off_t seekTo = -1;
+	// position of a seek request that could not be performed, -1 if there is none
+	off_t seekFailed = -1;
+
 	while (!m_commands.empty())
 	{
 	    std::shared_ptr<CmdBase> cmd = m_commands.front();
@@ -114,17 +180,38 @@ void Decoder::run()
 			// here we assume that the resampler is the last filter, it is true for now ... :)
 			m_filters.pop_back();
 			m_resampling = false;
+			m_resampleQuality = -1;
 		    }
 
 		    m_input = static_cast<Input&>(*cmd).m_input;
+		    m_fileId = static_cast<Input&>(*cmd).m_fileId;
+
+		    // a seek request queued before the input change belongs to the previous input
+		    seekTo = -1;
+
+		    m_position = 0;
+		    m_inputSynced = true;
+		    m_pending.clear();
+		    m_block.clear();
+		    m_collecting = true;
+
+		    resetHeadroom();
 
 		    if (m_input)
 		    {
 			m_format = m_input->getFormat();
 
-			// check whether we need to perform resampling
+			// check whether the output can be switched to the rate of the input instead of resampling it
 			if (m_format.getRate() != m_outputFormat.getRate())
-			    turnOnResampling();
+			{
+			    int rate = m_format.getRate();
+
+			    if (m_output->isRateSupported(rate) &&
+				std::find(m_rejectedRates.begin(), m_rejectedRates.end(), rate) == m_rejectedRates.end())
+				switchRate();
+			    else
+				turnOnResampling();
+			}
 		    }
 
 		    break;
@@ -144,7 +231,8 @@ void Decoder::run()
 
 		case STOP :
 		    LOG("decoder: stop");
-		    m_fifo.reset();
+		    resetFifo();
+		    m_pending.clear();
 		    working = false;
 		    break;
 
@@ -154,18 +242,29 @@ void Decoder::run()
 		    if (!m_input)
 		    {
 			LOG("decoder: unable to seek without input!");
-			break;
-		    }
 
-		    if (working)
-		    {
-			LOG("decoder: tried to seek without stopping");
+			// the input may have been closed at the end of the stream after the controller sent the request
+			seekFailed = static_cast<Seek&>(*cmd).m_seconds;
 			break;
 		    }
 
-		    m_input->seek(static_cast<Seek&>(*cmd).m_seconds * m_format.getRate());
+		    // only the last one of the queued seek requests is performed
+		    seekTo = static_cast<Seek&>(*cmd).m_seconds;
+
+		    break;
+
+		case REJECT_RATE :
+		{
+		    RejectRate& r = static_cast<RejectRate&>(*cmd);
+
+		    LOG("decoder: reject rate " << r.m_rate);
+
+		    m_rejectedRates.push_back(r.m_rate);
+		    // the next input is resampled to the format the output device kept working with
+		    m_outputFormat = r.m_format;
 
 		    break;
+		}
 
 		case NOTIFY :
 		    // do nothing here, this command is sent to wake up the decoder
@@ -177,6 +276,38 @@ void Decoder::run()
 
 	m_mutex.unlock();
 
+	if (seekFailed >= 0)
+	{
+	    // let the controller know that the seek request is lost, it is reported without holding our mutex
+	    // because the controller calls us with its own one locked
+	    auto ctrl = m_ctrl.lock();
+
+	    if (ctrl)
+		ctrl->seekFailed(seekFailed);
+	}
+
+	if (seekTo >= 0 && m_input)
+	{
+	    // While working the samples of the old position are flushed from the fifo without stopping the player, the
+	    // new ones are going to be decoded into the same fifo in the next round.
+	    if (working)
+	    {
+		m_fifo.flush();
+
+		// the flush may have dropped a format record not seen by the player yet
+		if (!m_fifo.addFormat(m_outputFormat))
+		    LOG("decoder: no room for format in the fifo!");
+	    }
+
+	    // the input is seeked only if the samples at the new position are not found in the cache
+	    m_position = seekTo * m_outputFormat.getRate();
+	    m_inputSynced = false;
+	    m_pending.clear();
+	    m_collecting = false;
+
+	    resetHeadroom();
+	}
+
 	// do nothing if we are not working
 	if (!working || !m_input)
 	    continue;
@@ -189,14 +320,20 @@ void Decoder::run()
 	// calculate the minimum size of the data we must put into the buffer
 	size_t minSize = m_bufferSize - fifoSize;
 
-	float* samples;
-	size_t count;
+	size_t size;
+	DecodeResult result = decode(size);
 
-	if (!m_input->decode(samples, count))
+	// wait until the player consumes samples from the fifo and notifies us
+	if (result == FIFO_FULL)
+	    continue;
+
+	if (result == END_OF_STREAM)
 	{
 	    // the end of the stream has been reached
 	    LOG("decoder: end of stream");
-	    m_fifo.addMarker();
+
+	    if (!m_fifo.addMarker())
+		LOG("decoder: no room for marker in the fifo!");
 
 	    // remove the input of the decoder
 	    m_input.reset();
@@ -210,15 +347,6 @@ void Decoder::run()
 	    continue;
 	}
 
-	// perform filters on the decoded samples
-	runFilters(samples, count, m_format);
-
-	// calculate the size of the decoded samples
-	size_t size = m_format.sizeOfSamples(count);
-
-	// put them into the fifo
-	m_fifo.addSamples(samples, size);
-
 	if (size < minSize)
 	{
 	    // do not wait for a command in case of we did not fill the fifo in this round
@@ -227,6 +355,210 @@ void Decoder::run()
     }
 }
 
+// =====================================================================================================================
+Decoder::DecodeResult Decoder::decode(size_t& size)
+{
+    size = 0;
+
+    // the samples of the previous round are put into the fifo first, the input is decoded from their end
+    if (!m_pending.empty())
+	return writePending(size);
+
+    if (m_cache && m_fileId >= 0)
+    {
+	PcmCache::Block block =
+	    m_cache->get(PcmCache::Key(m_fileId, m_outputFormat.getRate(), m_position / PcmCache::BLOCK_FRAMES));
+
+	if (block)
+	    return readCache(block, size);
+    }
+
+    if (!m_inputSynced)
+	syncInput();
+
+    float* dst = NULL;
+
+    // without filters the samples can be decoded right into the fifo
+    if (m_filters.empty())
+	dst = reinterpret_cast<float*>(m_fifo.reserve(m_format.sizeOfSamples(s_decodeFrames)));
+
+    float* samples = dst;
+
+    if (!samples)
+    {
+	m_decodeBuffer.resize(s_decodeFrames * m_format.getChannels());
+	samples = &m_decodeBuffer[0];
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    size_t count = m_input->decodeInto(samples, s_decodeFrames);
+
+    if (count == 0)
+    {
+	// the last block of the file is cached even if it is not complete
+	if (m_cache && m_collecting)
+	    m_cache->put(PcmCache::Key(m_fileId, m_outputFormat.getRate(), m_position / PcmCache::BLOCK_FRAMES),
+			 std::move(m_block));
+
+	m_block.clear();
+	m_collecting = false;
+
+	return END_OF_STREAM;
+    }
+
+    if (dst)
+    {
+	size = m_format.sizeOfSamples(count);
+
+	// samples are clamped to the valid range by the output while converting them to its format
+	advance(dst, count);
+	m_fifo.commit(size);
+
+	updateHeadroom(start, count);
+
+	return DECODED;
+    }
+
+    // the headroom is measured on the frames of the input, the filters may change their number
+    size_t frames = count;
+
+    // perform filters on the decoded samples
+    runFilters(samples, count, m_format);
+
+    updateHeadroom(start, frames);
+
+    // calculate the size of the decoded samples
+    size = m_format.sizeOfSamples(count);
+
+    // put them into the fifo
+    dst = reinterpret_cast<float*>(m_fifo.reserve(size));
+
+    if (dst)
+    {
+	memcpy(dst, samples, size);
+	// collect the samples before committing them because the player may modify them in place
+	advance(dst, count);
+	m_fifo.commit(size);
+    }
+    else
+    {
+	// the samples are kept until the player makes room for them in the fifo
+	m_pending.assign(samples, samples + count * m_outputFormat.getChannels());
+	size = 0;
+
+	return FIFO_FULL;
+    }
+
+    return DECODED;
+}
+
+// =====================================================================================================================
+Decoder::DecodeResult Decoder::writePending(size_t& size)
+{
+    size_t count = m_pending.size() / m_outputFormat.getChannels();
+    size = m_outputFormat.sizeOfSamples(count);
+
+    float* dst = reinterpret_cast<float*>(m_fifo.reserve(size));
+
+    if (!dst)
+    {
+	size = 0;
+	return FIFO_FULL;
+    }
+
+    memcpy(dst, &m_pending[0], size);
+    advance(dst, count);
+    m_fifo.commit(size);
+
+    m_pending.clear();
+
+    return DECODED;
+}
+
+// =====================================================================================================================
+Decoder::DecodeResult Decoder::readCache(const PcmCache::Block& block, size_t& size)
+{
+    size_t channels = m_outputFormat.getChannels();
+    size_t offset = (m_position % PcmCache::BLOCK_FRAMES) * channels;
+
+    // only the last block of a file is shorter, so we reached the end of the stream
+    if (offset >= block->size())
+	return END_OF_STREAM;
+
+    // serve the samples in small chunks to keep the decoding rounds short
+    size_t count = std::min((block->size() - offset) / channels, s_cacheReadFrames);
+    size = m_outputFormat.sizeOfSamples(count);
+
+    void* dst = m_fifo.reserve(size);
+
+    if (!dst)
+    {
+	size = 0;
+	return FIFO_FULL;
+    }
+
+    memcpy(dst, &(*block)[offset], size);
+    m_fifo.commit(size);
+
+    m_position += count;
+
+    // the input must be seeked to the current position before decoding from it again
+    m_inputSynced = false;
+    m_collecting = false;
+
+    return DECODED;
+}
+
+// =====================================================================================================================
+void Decoder::syncInput()
+{
+    LOG("decoder: seeking input to " << m_position);
+
+    m_input->seek(static_cast<uint64_t>(m_position) * m_format.getRate() / m_outputFormat.getRate());
+
+    for (const auto& filter : m_filters)
+	filter->reset();
+
+    m_block.clear();
+    m_inputSynced = true;
+}
+
+// =====================================================================================================================
+void Decoder::advance(const float* samples, size_t count)
+{
+    size_t channels = m_outputFormat.getChannels();
+
+    while (count > 0)
+    {
+	size_t offset = m_position % PcmCache::BLOCK_FRAMES;
+	size_t n = std::min(count, PcmCache::BLOCK_FRAMES - offset);
+
+	// blocks are collected from their beginning only
+	if (offset == 0)
+	{
+	    m_block.clear();
+	    m_collecting = true;
+	}
+
+	if (m_cache && m_collecting)
+	    m_block.insert(m_block.end(), samples, samples + n * channels);
+
+	m_position += n;
+	samples += n * channels;
+	count -= n;
+
+	if (m_cache && m_collecting && m_position % PcmCache::BLOCK_FRAMES == 0)
+	{
+	    m_cache->put(PcmCache::Key(m_fileId, m_outputFormat.getRate(), m_position / PcmCache::BLOCK_FRAMES - 1),
+			 std::move(m_block));
+
+	    m_block.clear();
+	    m_collecting = false;
+	}
+    }
+}
+
 // =====================================================================================================================
 void Decoder::runFilters(float*& samples, size_t& count, const Format& format)
 {
@@ -242,17 +574,6 @@ void Decoder::runFilters(float*& samples, size_t& count, const Format& format)
 	    LOG("decoder: filter error: " << e.what());
 	}
     }
-
-    // make sure samples are still in the valid -1.0 ... 1.0 range
-    for (size_t i = 0; i < count * format.getChannels(); ++i)
-    {
-	float& s = samples[i];
-
-	if (s > 1.0f)
-	    s = 1.0f;
-	else if (s < -1.0f)
-	    s = -1.0f;
-    }
 }
 
 // =====================================================================================================================
@@ -262,19 +583,123 @@ void Decoder::turnOnResampling()
 	m_format.getRate() <<
 	", dst=" <<
 	m_outputFormat.getRate() <<
+	", quality=" <<
+	filter::Resample::getQualityName(m_quality) <<
 	")");
 
+    std::tuple<int, int, int> key(m_format.getRate(), m_outputFormat.getRate(), m_quality);
+    auto it = m_resamplers.find(key);
+
+    if (it != m_resamplers.end())
+    {
+	// the state left by the previous input must not leak into the new one
+	it->second->reset();
+	m_filters.push_back(it->second);
+	m_resampling = true;
+	m_resampleQuality = m_quality;
+	return;
+    }
+
     std::shared_ptr<filter::BaseFilter> resampler =
-	std::make_shared<filter::Resample>(m_format.getRate(), m_outputFormat.getRate(), m_config);
+	filter::Resample::create(m_format.getRate(), m_outputFormat.getRate(), m_config, m_quality);
 
     try
     {
 	resampler->init();
+	m_resamplers[key] = resampler;
 	m_filters.push_back(resampler);
 	m_resampling = true;
+	m_resampleQuality = m_quality;
     }
     catch (const filter::FilterException& e)
     {
 	LOG("decoder: unable to initialize resampler: " << e.what());
     }
 }
+
+// =====================================================================================================================
+void Decoder::resetFifo()
+{
+    m_fifo.reset();
+
+    // The dropped samples may have contained a format record not seen by the player yet (e.g. the one of the next
+    // track), so the samples are put into the fifo in the format the output device is really working with.
+    m_outputFormat = m_output->getFormat();
+}
+
+// =====================================================================================================================
+void Decoder::switchRate()
+{
+    LOG("decoder: switching output rate (src=" <<
+	m_outputFormat.getRate() <<
+	", dst=" <<
+	m_format.getRate() <<
+	")");
+
+    Format format(m_format.getRate(), m_outputFormat.getChannels());
+
+    // The record is put after the marker of the previous input, so the player reconfigures the output only after all
+    // of the samples with the old rate are played.
+    if (!m_fifo.addFormat(format))
+    {
+	LOG("decoder: no room for format in the fifo!");
+	turnOnResampling();
+	return;
+    }
+
+    m_outputFormat = format;
+}
+
+// =====================================================================================================================
+void Decoder::updateHeadroom(const std::chrono::steady_clock::time_point& start, size_t frames)
+{
+    m_busyTime += std::chrono::steady_clock::now() - start;
+    m_busyFrames += frames;
+
+    // the measurement is made on a few seconds of audio to smooth out the cost of the individual rounds
+    if (m_busyFrames < s_headroomSeconds * m_format.getRate())
+	return;
+
+    double busy = std::chrono::duration<double>(m_busyTime).count();
+    double headroom = static_cast<double>(m_busyFrames) / m_format.getRate() / std::max(busy, 1e-6);
+
+    m_headroom = headroom;
+    resetHeadroom();
+
+    if (m_adaptive && m_resampling)
+	adaptQuality(headroom);
+}
+
+// =====================================================================================================================
+void Decoder::resetHeadroom()
+{
+    m_busyTime = std::chrono::steady_clock::duration(0);
+    m_busyFrames = 0;
+}
+
+// =====================================================================================================================
+void Decoder::adaptQuality(double headroom)
+{
+    // The measured time includes the time the decoder thread was not scheduled because of other threads (e.g. the
+    // library scanner), the fill level of the fifo shows whether the decoder is able to keep up with the player.
+    double fill = static_cast<double>(m_fifo.getBytes()) / m_bufferSize;
+
+    // the step is made from the quality of the running resampler, so at most one step is pending at a time
+    filter::Resample::Quality active = static_cast<filter::Resample::Quality>(static_cast<int>(m_resampleQuality));
+    filter::Resample::Quality quality = active;
+
+    if ((headroom < s_lowHeadroom || fill < 0.25) && quality > m_minQuality)
+	quality = static_cast<filter::Resample::Quality>(quality - 1);
+    else if (headroom > s_highHeadroom && fill >= 0.5 && quality < m_maxQuality)
+	quality = static_cast<filter::Resample::Quality>(quality + 1);
+
+    if (quality == m_quality)
+	return;
+
+    LOG("decoder: changing resampler quality for the next input (headroom=" << headroom << ", fill=" << fill << ")");
+
+    // Replacing the resampler in the middle of a track would drop its filter history and the buffered input frames
+    // causing a click and a small jump in time, so the new quality is used only when the resampler is rebuilt for the
+    // next input anyway.
+    m_quality = quality;
+}
@@ -8,16 +8,23 @@
 #define PLAYER_DECODER_H_INCLUDED
 
 #include "fifo.h"
+#include "pcmcache.h"
 
 #include <thread/thread.h>
 #include <thread/mutex.h>
 #include <thread/condition.h>
 #include <codec/basecodec.h>
 #include <filter/basefilter.h>
+#include <filter/resample.h>
+#include <output/baseoutput.h>
 
 #include <memory>
 #include <deque>
 #include <vector>
+#include <map>
+#include <tuple>
+#include <atomic>
+#include <chrono>
 
 namespace player
 {
@@ -28,13 +35,19 @@ class Decoder : public thread::Thread
 {
     public:
 	Decoder(size_t bufferSize,
-		const Format& outputFormat,
+		const std::shared_ptr<output::BaseOutput>& output,
 		Fifo& fifo,
 		const config::Config& config);
 
 	void setController(const std::weak_ptr<ControllerImpl>& controller);
+	/// sets the cache of the decoded samples, it must be called before starting the decoder thread
+	void setCache(const std::shared_ptr<PcmCache>& cache);
 
-	virtual void setInput(const std::shared_ptr<codec::BaseCodec>& input);
+	/**
+	 * Sets the input of the decoder.
+	 * @param fileId the library id of the input file used for caching the decoded samples, -1 turns off caching
+	 */
+	virtual void setInput(const std::shared_ptr<codec::BaseCodec>& input, int fileId);
 
 	virtual void startDecoding();
 	virtual void stopDecoding();
@@ -42,13 +55,63 @@ class Decoder : public thread::Thread
 	virtual void seek(off_t seconds);
 	virtual void notify();
 
+	/**
+	 * Makes the decoder resample the inputs with the given rate instead of switching the output to it, because the
+	 * output device could not be set up with that. The output keeps working with the given format.
+	 */
+	virtual void rejectRate(int rate, const Format& format);
+
+	/**
+	 * Returns the measured decoding speed relative to the playback (e.g. 10 means that decoding and filtering one
+	 * second of audio took 0.1 seconds), 0 is returned until the first measurement is finished.
+	 */
+	float getHeadroom() const;
+	// returns the quality of the current resampler, an empty string is returned if resampling is not performed
+	std::string getResampleQuality() const;
+
     private:
+	enum DecodeResult
+	{
+	    // samples were put into the fifo
+	    DECODED,
+	    // there was no room in the fifo, the decoder waits until the player consumes samples from it
+	    FIFO_FULL,
+	    // the end of the stream has been reached
+	    END_OF_STREAM
+	};
+
 	void run() override;
 
+	/**
+	 * Puts the next samples into the fifo either from the cache or by decoding them from the input.
+	 * @param size the number of bytes put into the fifo
+	 */
+	DecodeResult decode(size_t& size);
+	// puts the filtered samples left over by the previous round into the fifo
+	DecodeResult writePending(size_t& size);
+	// serves the samples at the current position from the given cached block
+	DecodeResult readCache(const PcmCache::Block& block, size_t& size);
+	// seeks the input to the current position after the samples were served from the cache
+	void syncInput();
+	// steps the current position while collecting the samples for the cache
+	void advance(const float* samples, size_t count);
+
 	void runFilters(float*& samples, size_t& count, const Format& format);
 
 	void turnOnResampling();
 
+	// accounts the time spent on decoding and filtering the given amount of frames since start
+	void updateHeadroom(const std::chrono::steady_clock::time_point& start, size_t frames);
+	// restarts the measurement of the headroom (e.g. after changing the input or seeking)
+	void resetHeadroom();
+	// selects the quality of the resampler for the next input according to the measured headroom and the fill level
+	// of the fifo
+	void adaptQuality(double headroom);
+	// announces the rate of the input for the player to set up the output device with it
+	void switchRate();
+	// drops the content of the fifo while the player is stopped
+	void resetFifo();
+
     private:
 	enum Command
 	{
@@ -56,6 +119,7 @@ class Decoder : public thread::Thread
 	    START,
 	    STOP,
 	    SEEK,
+	    REJECT_RATE,
 	    NOTIFY
 	};
 
@@ -67,8 +131,11 @@ class Decoder : public thread::Thread
 
 	struct Input : public CmdBase
 	{
-	    Input(const std::shared_ptr<codec::BaseCodec>& input) : CmdBase(INPUT), m_input(input) {}
+	    Input(const std::shared_ptr<codec::BaseCodec>& input, int fileId)
+		: CmdBase(INPUT), m_input(input), m_fileId(fileId)
+	    {}
 	    std::shared_ptr<codec::BaseCodec> m_input;
+	    int m_fileId;
 	};
 
 	struct Seek : public CmdBase
@@ -77,6 +144,13 @@ class Decoder : public thread::Thread
 	    off_t m_seconds;
 	};
 
+	struct RejectRate : public CmdBase
+	{
+	    RejectRate(int rate, const Format& format) : CmdBase(REJECT_RATE), m_rate(rate), m_format(format) {}
+	    int m_rate;
+	    Format m_format;
+	};
+
 	std::deque<std::shared_ptr<CmdBase>> m_commands;
 
 	// the minimum size of the buffer until the decoder should fill it
@@ -86,11 +160,33 @@ class Decoder : public thread::Thread
 	Fifo& m_fifo;
 
 	std::shared_ptr<codec::BaseCodec> m_input;
+	int m_fileId;
+
+	// position of the next sample in the output format
+	size_t m_position;
+	// false if the input has to be seeked to the current position before decoding
+	bool m_inputSynced;
+
+	std::shared_ptr<PcmCache> m_cache;
+	// the samples of the block being collected for the cache
+	std::vector<float> m_block;
+	// true if the collected samples start at a block boundary
+	bool m_collecting;
+
+	// samples are decoded into this buffer if they have to be filtered before putting them into the fifo
+	std::vector<float> m_decodeBuffer;
+	// filtered samples that did not fit into the fifo, they are put there before decoding again
+	std::vector<float> m_pending;
+
+	// the output device, it is used only for checking its format and the sampling rates it supports
+	std::shared_ptr<output::BaseOutput> m_output;
 
 	// format of the current input
 	Format m_format;
-	// format of the output device
+	// format of the samples put into the fifo, the output device is set up with it by the player
 	Format m_outputFormat;
+	// rates the output device could not be switched to although it reported them as supported
+	std::vector<int> m_rejectedRates;
 
 	// true when resampling is turned on because input and output sampling rate differs
 	bool m_resampling;
@@ -98,6 +194,24 @@ class Decoder : public thread::Thread
 	/// filter chain that will be executed in the decoded samples
 	std::vector<std::shared_ptr<filter::BaseFilter>> m_filters;
 
+	// initialized resamplers by source rate, destination rate and quality, they are reused by the inputs with the
+	// same rates
+	std::map<std::tuple<int, int, int>, std::shared_ptr<filter::BaseFilter>> m_resamplers;
+
+	// quality of the resampler created for the next input and its bounds when it is adjusted automatically
+	filter::Resample::Quality m_quality;
+	filter::Resample::Quality m_minQuality;
+	filter::Resample::Quality m_maxQuality;
+	bool m_adaptive;
+
+	// time spent on decoding and filtering in the current measurement and the number of frames decoded meanwhile
+	std::chrono::steady_clock::duration m_busyTime;
+	size_t m_busyFrames;
+
+	// the last measured headroom and the quality of the current resampler (-1 without resampling) for the metrics
+	std::atomic<float> m_headroom;
+	std::atomic_int m_resampleQuality;
+
 	thread::Mutex m_mutex;
 	thread::Condition m_cond;
 	thread::Condition m_emptyCond;
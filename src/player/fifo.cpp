@@ -6,146 +6,271 @@
 
 #include "fifo.h"
 
-#include <thread/blocklock.h>
-
 #include <cstring>
 
 using player::Fifo;
 
 // =====================================================================================================================
-Fifo::Fifo(size_t bufferSize)
-    : m_bytesInFifo(0),
-      m_bufferSize(bufferSize),
-      m_notifySize(0)
+static size_t roundUpToPowerOfTwo(size_t size)
 {
+    size_t s = 64;
+
+    while (s < size)
+	s <<= 1;
+
+    return s;
 }
 
 // =====================================================================================================================
-void Fifo::addSamples(const void* buffer, size_t size)
+Fifo::Fifo(size_t size)
+    : m_size(roundUpToPowerOfTwo(size)),
+      m_mask(m_size - 1),
+      m_head(0),
+      m_reserved(0),
+      m_tail(0),
+      m_readOffset(0),
+      m_readFormat(0, 0),
+      m_generation(0),
+      m_flushIndex(0),
+      m_readGeneration(0),
+      m_bytesInFifo(0),
+      m_notifySize(0),
+      m_waiting(false)
 {
-    const uint8_t* d = (const uint8_t*)buffer;
+    m_data.resize(m_size);
+}
 
-    thread::BlockLock bl(m_mutex);
+// =====================================================================================================================
+bool Fifo::addSamples(const void* buffer, size_t size)
+{
+    void* p = reserve(size);
 
-    // TODO: try to append some data to the last buffer
+    if (!p)
+	return false;
 
-    m_bytesInFifo += size;
+    memcpy(p, buffer, size);
+    commit(size);
 
-    while (size > 0)
-    {
-	std::shared_ptr<Samples> buf;
+    return true;
+}
 
-	if (m_samples.empty())
-	    buf = std::make_shared<Samples>(m_bufferSize);
-	else
-	{
-	    buf = m_samples.front();
-	    m_samples.pop_front();
-	}
+// =====================================================================================================================
+void* Fifo::reserve(size_t size)
+{
+    size_t head = m_head.load(std::memory_order_relaxed);
+    size_t tail = m_tail.load(std::memory_order_acquire);
+
+    if (size > UINT32_MAX || !prepareRecord(head, tail, size))
+	return NULL;
 
-	buf->m_offset = 0;
-	buf->m_realSize = std::min(buf->m_size, size);
-	memcpy(buf->m_data, d, buf->m_realSize);
+    m_reserved = head;
+
+    return payloadAt(head);
+}
+
+// =====================================================================================================================
+void Fifo::commit(size_t size)
+{
+    size_t head = m_reserved;
 
-	m_fifo.push_back(buf);
+    if (size > 0)
+    {
+	Record& r = recordAt(head);
+	r.m_type = SAMPLES;
+	r.m_size = size;
 
-	d += buf->m_realSize;
-	size -= buf->m_realSize;
+	head += recordSize(size);
     }
+
+    // update the byte counter before publishing the samples to make sure it never goes below zero at the consumer
+    m_bytesInFifo += size;
+    m_head.store(head);
+
+    checkWaiting();
+}
+
+// =====================================================================================================================
+bool Fifo::addMarker()
+{
+    size_t head = m_head.load(std::memory_order_relaxed);
+    size_t tail = m_tail.load(std::memory_order_acquire);
+
+    if (m_size - (head - tail) < sizeof(Record))
+	return false;
+
+    // a marker has no payload so it always fits into the contiguous space at the end of the ring
+    Record& r = recordAt(head);
+    r.m_type = MARKER;
+    r.m_size = 0;
+
+    m_head.store(head + sizeof(Record));
+
+    checkWaiting();
+
+    return true;
+}
+
+// =====================================================================================================================
+bool Fifo::addFormat(const Format& format)
+{
+    size_t head = m_head.load(std::memory_order_relaxed);
+    size_t tail = m_tail.load(std::memory_order_acquire);
+
+    if (!prepareRecord(head, tail, 2 * sizeof(uint32_t)))
+	return false;
+
+    Record& r = recordAt(head);
+    r.m_type = FORMAT;
+    r.m_size = 2 * sizeof(uint32_t);
+
+    uint32_t* payload = reinterpret_cast<uint32_t*>(payloadAt(head));
+    payload[0] = format.getRate();
+    payload[1] = format.getChannels();
+
+    m_head.store(head + recordSize(r.m_size));
+
+    checkWaiting();
+
+    return true;
 }
 
 // =====================================================================================================================
-void Fifo::addMarker()
+void Fifo::flush()
 {
-    thread::BlockLock bl(m_mutex);
-    m_fifo.push_back(std::make_shared<Item>(MARKER));
+    // the index must be visible before the new generation, the consumer reads them in the reversed order
+    m_flushIndex.store(m_head.load(std::memory_order_relaxed));
+    m_generation.fetch_add(1);
+
+    checkWaiting();
 }
 
 // =====================================================================================================================
 size_t Fifo::getBytes() const
 {
-    thread::BlockLock bl(m_mutex);
     return m_bytesInFifo;
 }
 
 // =====================================================================================================================
 auto Fifo::getNextEvent() -> Type
 {
-    thread::BlockLock bl(m_mutex);
+    if (checkFlush())
+	return FLUSH;
 
-    if (m_fifo.empty())
-	return NONE;
+    size_t tail = m_tail.load(std::memory_order_relaxed);
+    size_t head = m_head.load(std::memory_order_acquire);
 
-    auto event = m_fifo.front()->m_type;
+    while (tail != head)
+    {
+	const Record& r = recordAt(tail);
 
-    // remove the marker here from the fifo
-    if (event == MARKER)
-	m_fifo.pop_front();
+	switch (r.m_type)
+	{
+	    case PADDING :
+		// skip the unused end of the ring
+		tail += recordSize(r.m_size);
+		m_tail.store(tail, std::memory_order_release);
+		break;
+
+	    case MARKER :
+		// remove the marker here from the fifo
+		m_tail.store(tail + sizeof(Record), std::memory_order_release);
+		return MARKER;
+
+	    case FORMAT :
+	    {
+		const uint32_t* payload = reinterpret_cast<const uint32_t*>(payloadAt(tail));
+		m_readFormat = Format(payload[0], payload[1]);
+
+		m_tail.store(tail + recordSize(r.m_size), std::memory_order_release);
+		return FORMAT;
+	    }
+
+	    default :
+		return SAMPLES;
+	}
+    }
 
-    return event;
+    return NONE;
 }
 
 // =====================================================================================================================
-size_t Fifo::readSamples(void* buffer, size_t size)
+auto Fifo::getFormat() const -> const Format&
 {
-    thread::BlockLock bl(m_mutex);
+    return m_readFormat;
+}
 
+// =====================================================================================================================
+size_t Fifo::readSamples(void* buffer, size_t size)
+{
     size_t r = 0;
     uint8_t* d = reinterpret_cast<uint8_t*>(buffer);
 
-    while (!m_fifo.empty())
+    while (size > 0)
     {
-	std::shared_ptr<Item> item = m_fifo.front();
+	void* p;
+	size_t s = std::min(size, peek(p));
 
-	if (item->m_type != SAMPLES)
+	if (s == 0)
 	    break;
 
-	Samples& buf = reinterpret_cast<Samples&>(*item);
-	size_t s = std::min(size, buf.m_realSize);
-
-	memcpy(d, buf.m_data + buf.m_offset, s);
+	memcpy(d, p, s);
+	release(s);
 
 	d += s;
 	r += s;
 	size -= s;
-
-	if (s == buf.m_realSize)
-	{
-	    m_fifo.pop_front();
-	    m_samples.push_back(std::dynamic_pointer_cast<Samples>(item));
-	}
-	else
-	{
-	    buf.m_offset += s;
-	    buf.m_realSize -= s;
-	    break;
-	}
     }
 
-    m_bytesInFifo -= r;
-
-    // check whether we need to notify someone ...
-    if (m_notifySize > 0 && m_bytesInFifo < m_notifySize)
-	m_notifyCb();
+    checkNotify();
 
     return r;
 }
 
 // =====================================================================================================================
-void Fifo::reset()
+size_t Fifo::peek(void*& buffer)
 {
-    thread::BlockLock bl(m_mutex);
+    // the consumer has to see the FLUSH event first
+    if (m_generation.load() != m_readGeneration)
+	return 0;
+
+    size_t tail = m_tail.load(std::memory_order_relaxed);
+    size_t head = m_head.load(std::memory_order_acquire);
 
-    while (!m_fifo.empty())
+    while (tail != head)
     {
-	std::shared_ptr<Item> item = m_fifo.front();
+	const Record& r = recordAt(tail);
 
-	if (item->m_type == SAMPLES)
-	    m_samples.push_back(std::dynamic_pointer_cast<Samples>(item));
+	if (r.m_type == PADDING)
+	{
+	    tail += recordSize(r.m_size);
+	    m_tail.store(tail, std::memory_order_release);
+	    continue;
+	}
+
+	if (r.m_type != SAMPLES)
+	    break;
+
+	buffer = payloadAt(tail) + m_readOffset;
 
-	m_fifo.pop_front();
+	return r.m_size - m_readOffset;
     }
 
+    return 0;
+}
+
+// =====================================================================================================================
+void Fifo::consume(size_t size)
+{
+    release(size);
+    checkNotify();
+}
+
+// =====================================================================================================================
+void Fifo::reset()
+{
+    m_tail.store(m_head.load(std::memory_order_relaxed), std::memory_order_release);
+    m_readOffset = 0;
+    m_readGeneration = m_generation.load();
     m_bytesInFifo = 0;
 }
 
@@ -155,3 +280,136 @@ void Fifo::setNotifyCallback(size_t mark, const NotifyCallback& cb)
     m_notifySize = mark;
     m_notifyCb = cb;
 }
+
+// =====================================================================================================================
+void Fifo::setDataCallback(const NotifyCallback& cb)
+{
+    m_dataCb = cb;
+}
+
+// =====================================================================================================================
+bool Fifo::startWaiting()
+{
+    // The flag must be set before checking the write index. Combined with the reversed order in the producer (see
+    // checkWaiting()) either the consumer sees the new data or the producer sees the waiting consumer.
+    m_waiting = true;
+
+    if (m_head.load() != m_tail.load(std::memory_order_relaxed) || m_generation.load() != m_readGeneration)
+    {
+	m_waiting = false;
+	return false;
+    }
+
+    return true;
+}
+
+// =====================================================================================================================
+void Fifo::stopWaiting()
+{
+    m_waiting = false;
+}
+
+// =====================================================================================================================
+size_t Fifo::recordSize(size_t size)
+{
+    return sizeof(Record) + ((size + ALIGNMENT - 1) & ~(ALIGNMENT - 1));
+}
+
+// =====================================================================================================================
+auto Fifo::recordAt(size_t index) -> Record&
+{
+    return *reinterpret_cast<Record*>(&m_data[index & m_mask]);
+}
+
+// =====================================================================================================================
+uint8_t* Fifo::payloadAt(size_t index)
+{
+    return &m_data[(index & m_mask) + sizeof(Record)];
+}
+
+// =====================================================================================================================
+bool Fifo::prepareRecord(size_t& head, size_t tail, size_t size)
+{
+    size_t free = m_size - (head - tail);
+    size_t end = m_size - (head & m_mask);
+    size_t needed = recordSize(size);
+
+    if (end < needed && end < free)
+    {
+	// fill the end of the ring with padding and continue at the beginning
+	Record& r = recordAt(head);
+	r.m_type = PADDING;
+	r.m_size = end - sizeof(Record);
+
+	head += end;
+	free -= end;
+	end = m_size;
+    }
+
+    return std::min(free, end) >= needed;
+}
+
+// =====================================================================================================================
+void Fifo::release(size_t size)
+{
+    size_t tail = m_tail.load(std::memory_order_relaxed);
+
+    m_readOffset += size;
+
+    if (m_readOffset == recordAt(tail).m_size)
+    {
+	m_tail.store(tail + recordSize(m_readOffset), std::memory_order_release);
+	m_readOffset = 0;
+    }
+
+    m_bytesInFifo -= size;
+}
+
+// =====================================================================================================================
+bool Fifo::checkFlush()
+{
+    unsigned generation = m_generation.load();
+
+    if (generation == m_readGeneration)
+	return false;
+
+    size_t tail = m_tail.load(std::memory_order_relaxed);
+    size_t index = m_flushIndex.load();
+    size_t bytes = 0;
+
+    // The consumer may already be past the flush index if it read new records right after the flush. Otherwise walk
+    // through the dropped records to keep the byte counter in sync with the content of the fifo.
+    while (static_cast<ptrdiff_t>(index - tail) > 0)
+    {
+	const Record& r = recordAt(tail);
+
+	if (r.m_type == SAMPLES)
+	    bytes += r.m_size - m_readOffset;
+
+	tail += recordSize(r.m_size);
+	m_readOffset = 0;
+    }
+
+    m_tail.store(tail, std::memory_order_release);
+    m_bytesInFifo -= bytes;
+    m_readGeneration = generation;
+
+    checkNotify();
+
+    return true;
+}
+
+// =====================================================================================================================
+void Fifo::checkNotify()
+{
+    // check whether we need to notify someone ...
+    if (m_notifySize > 0 && m_bytesInFifo < m_notifySize)
+	m_notifyCb();
+}
+
+// =====================================================================================================================
+void Fifo::checkWaiting()
+{
+    if (m_waiting && m_waiting.exchange(false) && m_dataCb)
+	m_dataCb();
+}
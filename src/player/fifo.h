@@ -7,74 +7,181 @@
 #ifndef PLAYER_PLAYBACKFIFO_H_INCLUDED
 #define PLAYER_PLAYBACKFIFO_H_INCLUDED
 
-#include <thread/mutex.h>
+#include "format.h"
 
-#include <deque>
-#include <memory>
+#include <vector>
+#include <atomic>
 #include <functional>
 
 #include <stdint.h>
+#include <stddef.h>
 
 namespace player
 {
 
+/**
+ * Single-producer/single-consumer lock-free ring buffer for decoded samples.
+ *
+ * Samples, markers and format changes are stored as in-band records in a fixed size ring. The producer side
+ * (addSamples(), reserve(), commit(), addMarker(), addFormat(), flush()) must be used from the decoder thread only, the
+ * consumer side (getNextEvent(), getFormat(), readSamples(), peek(), consume()) from the player thread only.
+ */
 class Fifo
 {
     public:
-	enum Type { NONE, SAMPLES, MARKER };
+	enum Type { NONE, SAMPLES, MARKER, FORMAT, FLUSH };
 
 	typedef std::function<void ()> NotifyCallback;
 
-	Fifo(size_t bufferSize);
-
-	void addSamples(const void* buffer, size_t size);
-	void addMarker();
+	/**
+	 * Creates a new fifo.
+	 * @param size the capacity of the fifo in bytes, it is rounded up to the next power of two
+	 */
+	Fifo(size_t size);
+
+	/**
+	 * Puts samples into the fifo.
+	 * @return false is returned if there is no room for the samples
+	 */
+	bool addSamples(const void* buffer, size_t size);
+	/**
+	 * Reserves contiguous room for the given amount of bytes at the end of the fifo. The reserved area can be
+	 * filled in place and published to the consumer with commit().
+	 * @return NULL is returned if there is no room for the samples
+	 */
+	void* reserve(size_t size);
+	/// publishes the first size bytes of the area returned by the last reserve() call
+	void commit(size_t size);
+
+	/**
+	 * Puts a marker into the fifo.
+	 * @return false is returned if there is no room for the marker
+	 */
+	bool addMarker();
+
+	/**
+	 * Announces that the samples put into the fifo after this call have the given format.
+	 * @return false is returned if there is no room for the record
+	 */
+	bool addFormat(const Format& format);
+
+	/**
+	 * Starts a new generation of the fifo. Everything put into the fifo before this call is dropped by the consumer
+	 * and a FLUSH event is returned to it instead. Unlike reset() it can be used while the consumer is running.
+	 */
+	void flush();
 
 	size_t getBytes() const;
 	Type getNextEvent();
 
+	// returns the format announced by the last FORMAT event
+	const Format& getFormat() const;
+
 	size_t readSamples(void* buffer, size_t size);
 
+	/**
+	 * Returns the contiguous samples found at the front of the fifo without removing them. The returned area
+	 * belongs to the consumer until it is released with consume(), so it may be modified in place.
+	 * @return the number of available bytes at buffer, 0 if the next event is not SAMPLES
+	 */
+	size_t peek(void*& buffer);
+	/// removes the given amount of bytes from the samples returned by peek()
+	void consume(size_t size);
+
+	/**
+	 * Drops the content of the fifo.
+	 * It may be called by the producer only while the consumer is not accessing the fifo.
+	 */
 	void reset();
 
 	void setNotifyCallback(size_t mark, const NotifyCallback& cb);
 
+	/**
+	 * Sets the callback that is called by the producer when new data is put into the fifo while the consumer is
+	 * waiting for it (see startWaiting()).
+	 */
+	void setDataCallback(const NotifyCallback& cb);
+
+	/**
+	 * Announces that the consumer is going to wait for new data.
+	 * @return false is returned if the fifo is not empty, so the consumer should not wait at all
+	 */
+	bool startWaiting();
+	// called by the consumer once it finished waiting
+	void stopWaiting();
+
     private:
-	struct Item
+	struct Record
 	{
-	    Item(Type type) : m_type(type) {}
-	    virtual ~Item() {}
-	    Type m_type;
+	    uint32_t m_type;
+	    // size of the payload following the record header
+	    uint32_t m_size;
 	};
 
-	struct Samples : public Item
-	{
-	    Samples(size_t size) : Item(SAMPLES), m_data(new uint8_t[size]), m_size(size) {}
-	    ~Samples() { delete[] m_data; }
+	// record type used to fill the unused space at the end of the ring before wrapping around
+	static const uint32_t PADDING = FLUSH + 1;
 
-	    uint8_t* m_data;
-	    size_t m_size;
-	    size_t m_realSize;
-	    size_t m_offset;
-	};
+	static const size_t ALIGNMENT = sizeof(Record);
 
-	/// the actual playback fifo
-	std::deque<std::shared_ptr<Item>> m_fifo;
+	// returns the number of bytes occupied by a record with the given payload size
+	static size_t recordSize(size_t size);
 
-	/// queue for reusable Samples objects
-	std::deque<std::shared_ptr<Samples>> m_samples;
+	Record& recordAt(size_t index);
+	uint8_t* payloadAt(size_t index);
 
-	/// returns the number of bytes in the playback fifo
-	size_t m_bytesInFifo;
+	/**
+	 * Prepares room for a new record at the given write index. Padding is inserted (and the index is updated) in
+	 * case of the contiguous space at the end of the ring is not enough to hold the header and the payload.
+	 * @return false is returned if there is no room for the record
+	 */
+	bool prepareRecord(size_t& head, size_t tail, size_t size);
+
+	// removes bytes from the samples record at the read index without calling the notify callback
+	void release(size_t size);
+
+	// drops the records of the previous generations, returns false if there was no flush since the last call
+	bool checkFlush();
+
+	void checkNotify();
+	// calls the data callback if the consumer is waiting for new data
+	void checkWaiting();
 
-	/// size used for allocating new buffers to store samples
-	size_t m_bufferSize;
+    private:
+	/// storage of the ring
+	std::vector<uint8_t> m_data;
+
+	/// size of the ring (always power of two) and the mask used to wrap indices
+	size_t m_size;
+	size_t m_mask;
+
+	/// write index, it is modified by the producer only
+	std::atomic<size_t> m_head;
+	/// write index of the area returned by the last reserve() call (producer only)
+	size_t m_reserved;
+	/// read index, it is modified by the consumer only
+	std::atomic<size_t> m_tail;
+
+	/// read offset inside the samples record at the read index (consumer only)
+	size_t m_readOffset;
+	/// the format of the last FORMAT record (consumer only)
+	Format m_readFormat;
+
+	/// generation counter increased by flush() and the write index where the current generation starts
+	std::atomic<unsigned> m_generation;
+	std::atomic<size_t> m_flushIndex;
+	/// the last generation seen by the consumer
+	unsigned m_readGeneration;
+
+	/// returns the number of bytes in the playback fifo
+	std::atomic<size_t> m_bytesInFifo;
 
 	// if set to non-zero notify callback will be called once the number of bytes in the fifo goes below this limit
 	size_t m_notifySize;
 	NotifyCallback m_notifyCb;
 
-	thread::Mutex m_mutex;
+	// true while the consumer is waiting for new data
+	std::atomic_bool m_waiting;
+	NotifyCallback m_dataCb;
 };
 
 }
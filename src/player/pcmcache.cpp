@@ -0,0 +1,189 @@
+/**
+ * This file is part of the Zeppelin music player project.
+ * Copyright (c) 2013-2014 Zoltan Kovacs, Lajos Santa
+ * See http://zeppelin-player.com for more details.
+ */
+
+#include "pcmcache.h"
+
+#include <zeppelin/logger.h>
+
+#include <fstream>
+#include <sstream>
+#include <tuple>
+
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+using player::PcmCache;
+
+// =====================================================================================================================
+bool PcmCache::Key::operator<(const Key& other) const
+{
+    return std::tie(m_fileId, m_rate, m_index) < std::tie(other.m_fileId, other.m_rate, other.m_index);
+}
+
+// =====================================================================================================================
+PcmCache::PcmCache(const config::Cache& config)
+    : m_memoryLimit(config.m_memoryLimit),
+      m_memoryUsage(0),
+      m_directory(config.m_directory),
+      m_diskLimit(config.m_diskLimit),
+      m_diskUsage(0)
+{
+    if (!m_directory.empty() && mkdir(m_directory.c_str(), 0755) != 0 && errno != EEXIST)
+    {
+	LOG("pcmcache: unable to create " << m_directory << ", disk tier is turned off");
+	m_directory.clear();
+    }
+}
+
+// =====================================================================================================================
+PcmCache::~PcmCache()
+{
+    while (!m_disk.empty())
+	dropFromDisk();
+}
+
+// =====================================================================================================================
+auto PcmCache::get(const Key& key) -> Block
+{
+    auto it = m_memoryIndex.find(key);
+
+    if (it != m_memoryIndex.end())
+    {
+	// move the entry to the front of the LRU list
+	m_memory.splice(m_memory.begin(), m_memory, it->second);
+	return it->second->m_samples;
+    }
+
+    if (m_diskIndex.find(key) == m_diskIndex.end())
+	return nullptr;
+
+    Block samples = load(key);
+
+    if (samples)
+	insert(key, samples);
+
+    return samples;
+}
+
+// =====================================================================================================================
+void PcmCache::put(const Key& key, std::vector<float>&& samples)
+{
+    if (m_memoryIndex.find(key) != m_memoryIndex.end())
+	return;
+
+    insert(key, std::make_shared<std::vector<float>>(std::move(samples)));
+}
+
+// =====================================================================================================================
+size_t PcmCache::getMemoryUsage() const
+{
+    return m_memoryUsage;
+}
+
+// =====================================================================================================================
+size_t PcmCache::getDiskUsage() const
+{
+    return m_diskUsage;
+}
+
+// =====================================================================================================================
+void PcmCache::insert(const Key& key, const Block& samples)
+{
+    size_t size = samples->size() * sizeof(float);
+
+    if (size > m_memoryLimit)
+	return;
+
+    m_memory.push_front(Entry(key, samples, size));
+    m_memoryIndex[key] = m_memory.begin();
+    m_memoryUsage += size;
+
+    while (m_memoryUsage > m_memoryLimit)
+    {
+	const Entry& e = m_memory.back();
+
+	if (!m_directory.empty())
+	    spill(e);
+
+	m_memoryUsage -= e.m_size;
+	m_memoryIndex.erase(e.m_key);
+	m_memory.pop_back();
+    }
+}
+
+// =====================================================================================================================
+void PcmCache::spill(const Entry& entry)
+{
+    if (entry.m_size > m_diskLimit || m_diskIndex.find(entry.m_key) != m_diskIndex.end())
+	return;
+
+    while (m_diskUsage + entry.m_size > m_diskLimit)
+	dropFromDisk();
+
+    std::string path = getPath(entry.m_key);
+    std::ofstream f(path, std::ios::binary | std::ios::trunc);
+
+    f.write(reinterpret_cast<const char*>(entry.m_samples->data()), entry.m_size);
+
+    if (!f)
+    {
+	LOG("pcmcache: unable to write " << path);
+	unlink(path.c_str());
+	return;
+    }
+
+    m_disk.push_front(Entry(entry.m_key, nullptr, entry.m_size));
+    m_diskIndex[entry.m_key] = m_disk.begin();
+    m_diskUsage += entry.m_size;
+}
+
+// =====================================================================================================================
+auto PcmCache::load(const Key& key) -> Block
+{
+    auto it = m_diskIndex.find(key);
+    size_t size = it->second->m_size;
+
+    std::string path = getPath(key);
+    std::ifstream f(path, std::ios::binary);
+
+    std::shared_ptr<std::vector<float>> samples = std::make_shared<std::vector<float>>(size / sizeof(float));
+    f.read(reinterpret_cast<char*>(samples->data()), size);
+
+    if (!f)
+    {
+	LOG("pcmcache: unable to read " << path);
+	samples.reset();
+    }
+
+    // the block is going to be stored in the memory tier again
+    unlink(path.c_str());
+    m_diskUsage -= size;
+    m_disk.erase(it->second);
+    m_diskIndex.erase(it);
+
+    return samples;
+}
+
+// =====================================================================================================================
+void PcmCache::dropFromDisk()
+{
+    const Entry& e = m_disk.back();
+
+    unlink(getPath(e.m_key).c_str());
+
+    m_diskUsage -= e.m_size;
+    m_diskIndex.erase(e.m_key);
+    m_disk.pop_back();
+}
+
+// =====================================================================================================================
+std::string PcmCache::getPath(const Key& key) const
+{
+    std::ostringstream ss;
+    ss << m_directory << "/" << key.m_fileId << "-" << key.m_rate << "-" << key.m_index << ".pcm";
+    return ss.str();
+}
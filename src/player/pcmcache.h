@@ -0,0 +1,107 @@
+/**
+ * This file is part of the Zeppelin music player project.
+ * Copyright (c) 2013-2014 Zoltan Kovacs, Lajos Santa
+ * See http://zeppelin-player.com for more details.
+ */
+
+#ifndef PLAYER_PCMCACHE_H_INCLUDED
+#define PLAYER_PCMCACHE_H_INCLUDED
+
+#include <config/config.h>
+
+#include <map>
+#include <list>
+#include <vector>
+#include <memory>
+#include <string>
+
+#include <stddef.h>
+
+namespace player
+{
+
+/**
+ * LRU cache of decoded (and already resampled) samples.
+ *
+ * Samples are stored in blocks of BLOCK_FRAMES frames. The block with the given index of a file contains the frames
+ * starting at index * BLOCK_FRAMES, only the last block of a file may be shorter. Blocks evicted from the memory are
+ * written to the disk tier if it is configured.
+ *
+ * The cache is not thread safe, it is used by the decoder thread only.
+ */
+class PcmCache
+{
+    public:
+	static const size_t BLOCK_FRAMES = 65536;
+
+	typedef std::shared_ptr<const std::vector<float>> Block;
+
+	struct Key
+	{
+	    Key(int fileId, int rate, size_t index)
+		: m_fileId(fileId), m_rate(rate), m_index(index)
+	    {}
+
+	    bool operator<(const Key& other) const;
+
+	    int m_fileId;
+	    // sampling rate of the samples
+	    int m_rate;
+	    size_t m_index;
+	};
+
+	PcmCache(const config::Cache& config);
+	~PcmCache();
+
+	/// returns the given block, a null pointer is returned if it is not cached
+	Block get(const Key& key);
+	void put(const Key& key, std::vector<float>&& samples);
+
+	size_t getMemoryUsage() const;
+	size_t getDiskUsage() const;
+
+    private:
+	struct Entry
+	{
+	    Entry(const Key& key, const Block& samples, size_t size)
+		: m_key(key), m_samples(samples), m_size(size)
+	    {}
+
+	    Key m_key;
+	    // samples of the block, it is not set for blocks on the disk
+	    Block m_samples;
+	    // size of the block in bytes
+	    size_t m_size;
+	};
+
+	typedef std::list<Entry> Lru;
+
+	// inserts a block into the memory tier and evicts the least recently used ones over the limit
+	void insert(const Key& key, const Block& samples);
+
+	// writes a block evicted from the memory to the disk tier
+	void spill(const Entry& entry);
+	// reads a block back from the disk tier, the file of the block is removed
+	Block load(const Key& key);
+	// removes the least recently used entry from the disk tier
+	void dropFromDisk();
+
+	std::string getPath(const Key& key) const;
+
+    private:
+	size_t m_memoryLimit;
+	size_t m_memoryUsage;
+	// most recently used entries are at the front
+	Lru m_memory;
+	std::map<Key, Lru::iterator> m_memoryIndex;
+
+	std::string m_directory;
+	size_t m_diskLimit;
+	size_t m_diskUsage;
+	Lru m_disk;
+	std::map<Key, Lru::iterator> m_diskIndex;
+};
+
+}
+
+#endif
@@ -12,6 +12,8 @@
 
 #include <zeppelin/logger.h>
 
+#include <cerrno>
+
 using player::Player;
 
 // =====================================================================================================================
@@ -21,10 +23,13 @@ Player::Player(const std::shared_ptr<output::BaseOutput>& output,
     : m_fifo(fifo),
       m_output(output),
       m_format(output->getFormat()),
+      m_rate(m_format.getRate()),
       m_position(0),
+      m_seekPosition(0),
       m_running(false),
       m_volumeFilter(config)
 {
+    m_fifo.setDataCallback(std::bind(&thread::Notifier::signal, &m_wakeup));
 }
 
 // =====================================================================================================================
@@ -36,7 +41,7 @@ void Player::setController(const std::weak_ptr<ControllerImpl>& controller)
 // =====================================================================================================================
 unsigned Player::getPosition() const
 {
-    return m_position / m_format.getRate();
+    return m_position / m_rate;
 }
 
 // =====================================================================================================================
@@ -45,12 +50,18 @@ filter::Volume& Player::getVolumeFilter()
     return m_volumeFilter;
 }
 
+// =====================================================================================================================
+std::string Player::getSampleFormat() const
+{
+    return m_output->getSampleFormat();
+}
+
 // =====================================================================================================================
 void Player::startPlayback()
 {
     thread::BlockLock bl(m_mutex);
     m_commands.push_back(std::make_shared<CmdBase>(START));
-    m_cond.signal();
+    m_wakeup.signal();
 }
 
 // =====================================================================================================================
@@ -58,7 +69,7 @@ void Player::pausePlayback()
 {
     thread::BlockLock bl(m_mutex);
     m_commands.push_back(std::make_shared<CmdBase>(PAUSE));
-    m_cond.signal();
+    m_wakeup.signal();
 }
 
 // =====================================================================================================================
@@ -66,7 +77,7 @@ void Player::stopPlayback()
 {
     thread::BlockLock bl(m_mutex);
     m_commands.push_back(std::make_shared<CmdBase>(STOP));
-    m_cond.signal();
+    m_wakeup.signal();
 
     // wait until all of the commands are processed, so the caller can make sure that playing is really stopped
     while (!m_commands.empty())
@@ -78,7 +89,7 @@ void Player::seek(off_t seconds)
 {
     thread::BlockLock bl(m_mutex);
     m_commands.push_back(std::make_shared<Seek>(seconds));
-    m_cond.signal();
+    m_wakeup.signal();
 }
 
 // =====================================================================================================================
@@ -90,17 +101,31 @@ void Player::run()
 
 	// do nothing if the player is stopped
 	if (!m_running)
+	{
+	    wait(WAIT_COMMAND);
 	    continue;
+	}
 
 	// get the next event from the fifo
 	auto event = m_fifo.getNextEvent();
 
 	if (event == Fifo::NONE)
+	{
+	    wait(WAIT_FIFO);
 	    continue;
+	}
 
 	// find out the available space on the output device for samples
 	int availSamples = m_output->getFreeSize();
 
+	// markers and formats are removed from the fifo by getNextEvent() so they must be processed even if the device
+	// is full
+	if (availSamples == 0 && event == Fifo::SAMPLES)
+	{
+	    wait(WAIT_OUTPUT);
+	    continue;
+	}
+
 	// try to flush the fifo until it is empty ...
 	while (event != Fifo::NONE)
 	{
@@ -108,19 +133,21 @@ void Player::run()
 	    {
 		case Fifo::SAMPLES :
 		{
-		    // reserve enough space in the buffer
-		    m_buffer.resize(availSamples * m_format.getChannels());
+		    void* data;
+
+		    // access the samples in the fifo directly
+		    size_t size = m_fifo.peek(data);
+
+		    // the fifo has been flushed since the event was returned
+		    if (size == 0)
+			break;
 
-		    // read samples from the fifo
-		    size_t res = m_fifo.readSamples(&m_buffer[0], m_format.sizeOfSamples(availSamples));
-		    size_t samples = m_format.numOfSamples(res);
+		    size_t samples = std::min<size_t>(m_format.numOfSamples(size), availSamples);
 
-		    // perform volume filter
-		    float* p = &m_buffer[0];
-		    m_volumeFilter.run(p, samples, m_format);
+		    // play the data, the volume is applied by the output while converting the samples to its format
+		    m_output->write(reinterpret_cast<const float*>(data), samples, m_volumeFilter.getGain());
 
-		    // play the data
-		    m_output->write(p, samples);
+		    m_fifo.consume(m_format.sizeOfSamples(samples));
 
 		    m_position += samples;
 		    availSamples -= samples;
@@ -140,6 +167,30 @@ void Player::run()
 		    break;
 		}
 
+		case Fifo::FORMAT :
+		    if (!switchFormat(m_fifo.getFormat()))
+		    {
+			// The samples following the format record would be played at a wrong rate, so the player stops
+			// until the controller loads the track into the decoder again.
+			m_running = false;
+			availSamples = 0;
+			break;
+		    }
+
+		    availSamples = m_output->getFreeSize();
+		    break;
+
+		case Fifo::FLUSH :
+		    LOG("player: flush");
+
+		    // the decoder seeked without stopping us, drop the old samples already written to the device too
+		    m_output->drop();
+		    m_output->prepare();
+
+		    m_position = m_seekPosition;
+
+		    break;
+
 		case Fifo::NONE :
 		    // this should be never reached because NONE terminates the loop
 		    break;
@@ -156,10 +207,10 @@ void Player::run()
 // =====================================================================================================================
 void Player::processCommands()
 {
-    thread::BlockLock bl(m_mutex);
+    // clear the notifier before looking at the commands to make sure no wake up is lost
+    m_wakeup.clear();
 
-    // wait until we get a command or a timeout (100ms)
-    m_cond.timedWait(m_mutex, 100 * 1000);
+    thread::BlockLock bl(m_mutex);
 
     while (!m_commands.empty())
     {
@@ -191,7 +242,8 @@ void Player::processCommands()
 	    {
 		Seek& s = static_cast<Seek&>(*cmd);
 		LOG("player: seek " << s.m_seconds);
-		m_position = s.m_seconds * m_format.getRate();
+		m_seekPosition = s.m_seconds * m_format.getRate();
+		m_position = m_seekPosition;
 		break;
 	    }
 	}
@@ -199,3 +251,97 @@ void Player::processCommands()
 
     m_emptyCond.signal();
 }
+
+// =====================================================================================================================
+bool Player::switchFormat(const Format& format)
+{
+    // the decoder announces the format again after flushing the fifo, so it may be the current one
+    if (format.getRate() == m_format.getRate() && format.getChannels() == m_format.getChannels())
+	return true;
+
+    LOG("player: switching output to " << format.getRate() << " Hz");
+
+    // the format record follows the marker of the previous track, its samples are played at the old rate first
+    m_output->drain();
+
+    try
+    {
+	m_output->setup(format.getRate(), format.getChannels());
+	m_format = format;
+	m_rate = format.getRate();
+	m_output->prepare();
+	return true;
+    }
+    catch (const output::OutputException& e)
+    {
+	LOG("player: unable to switch output format: " << e.what());
+    }
+
+    try
+    {
+	// keep the device working with the previous format
+	m_output->setup(m_format.getRate(), m_format.getChannels());
+	m_output->prepare();
+    }
+    catch (const output::OutputException& e)
+    {
+	LOG("player: unable to restore output format: " << e.what());
+    }
+
+    // let the controller know that the track has to be resampled to the format of the device
+    auto ctrl = m_ctrl.lock();
+
+    if (ctrl)
+	ctrl->formatFailed(format.getRate(), m_format);
+
+    return false;
+}
+
+// =====================================================================================================================
+void Player::wait(Wait what)
+{
+    m_pollFds.resize(1);
+    m_pollFds[0].fd = m_wakeup.getFd();
+    m_pollFds[0].events = POLLIN;
+    m_pollFds[0].revents = 0;
+
+    // use a timeout for outputs not having poll descriptors
+    int timeout = -1;
+
+    switch (what)
+    {
+	case WAIT_COMMAND :
+	    break;
+
+	case WAIT_FIFO :
+	    // do not wait if the decoder put something into the fifo in the meantime
+	    if (!m_fifo.startWaiting())
+		return;
+	    break;
+
+	case WAIT_OUTPUT :
+	    m_output->getPollDescriptors(m_pollFds);
+
+	    if (m_pollFds.size() == 1)
+		timeout = 10;
+	    break;
+    }
+
+    if (poll(&m_pollFds[0], m_pollFds.size(), timeout) < 0 && errno != EINTR)
+	LOG("player: poll error: " << errno);
+
+    switch (what)
+    {
+	case WAIT_COMMAND :
+	    break;
+
+	case WAIT_FIFO :
+	    m_fifo.stopWaiting();
+	    break;
+
+	case WAIT_OUTPUT :
+	    if (m_pollFds.size() > 1)
+		m_output->handlePollEvents(&m_pollFds[1], m_pollFds.size() - 1);
+	    break;
+    }
+}
@@ -12,6 +12,7 @@
 #include <output/baseoutput.h>
 #include <thread/thread.h>
 #include <thread/condition.h>
+#include <thread/notifier.h>
 #include <filter/volume.h>
 
 #include <deque>
@@ -34,6 +35,8 @@ class Player : public thread::Thread
 
 	unsigned getPosition() const;
 	filter::Volume& getVolumeFilter();
+	// returns the sample format of the output device
+	std::string getSampleFormat() const;
 
 	virtual void startPlayback();
 	virtual void pausePlayback();
@@ -44,8 +47,27 @@ class Player : public thread::Thread
 	void run();
 
     private:
+	enum Wait
+	{
+	    // wait for new commands only
+	    WAIT_COMMAND,
+	    // wait for new data in the fifo
+	    WAIT_FIFO,
+	    // wait for free space on the output device
+	    WAIT_OUTPUT
+	};
+
 	void processCommands();
 
+	/**
+	 * Reconfigures the output device for the format announced in the fifo. False is returned if the device could not
+	 * be set up with the new format, it is kept working with the previous one in that case.
+	 */
+	bool switchFormat(const Format& format);
+
+	// blocks the player thread until a new command arrives or the given condition is met
+	void wait(Wait what);
+
     private:
 	enum Command
 	{
@@ -67,27 +89,33 @@ class Player : public thread::Thread
 	    off_t m_seconds;
 	};
 
-	// local buffer to store samples read from the fifo before playing them
-	std::vector<float> m_buffer;
-
 	// the sample buffer we are going to play from
 	Fifo& m_fifo;
 
 	// the output device instance
 	std::shared_ptr<output::BaseOutput> m_output;
 
-	// the format of the output device
+	// the format of the output device, it changes when the decoder switches the sampling rate at a track boundary
 	Format m_format;
+	// sampling rate of the output device used for calculating the position outside of the player thread
+	std::atomic_int m_rate;
 
 	// number of played samples
 	std::atomic_uint m_position;
+	// position of the last seek request, it is applied again once the fifo is flushed by the decoder
+	unsigned m_seekPosition;
 
 	std::deque<std::shared_ptr<CmdBase>> m_commands;
 
 	thread::Mutex m_mutex;
-	thread::Condition m_cond;
 	thread::Condition m_emptyCond;
 
+	// wakes up the player thread on new commands and fifo data
+	thread::Notifier m_wakeup;
+
+	// descriptors used for waiting in the player thread
+	std::vector<pollfd> m_pollFds;
+
 	// true when the player is currently working
 	bool m_running;
 
@@ -0,0 +1,122 @@
+/**
+ * This file is part of the Zeppelin music player project.
+ * Copyright (c) 2013-2014 Zoltan Kovacs, Lajos Santa
+ * See http://zeppelin-player.com for more details.
+ */
+
+#include "preloader.h"
+
+#include <codec/codecmanager.h>
+#include <codec/basecodec.h>
+#include <thread/blocklock.h>
+
+#include <zeppelin/logger.h>
+
+using player::Preloader;
+
+// =====================================================================================================================
+Preloader::Preloader(const codec::CodecManager& codecManager)
+    : m_state(IDLE),
+      m_codecManager(codecManager)
+{
+}
+
+// =====================================================================================================================
+void Preloader::preload(const std::string& file)
+{
+    thread::BlockLock bl(m_mutex);
+
+    // the result of an opening in progress will be dropped by the preloader thread because of the new file name
+    m_file = file;
+    m_input.reset();
+    m_state = PENDING;
+
+    m_cond.signal();
+}
+
+// =====================================================================================================================
+std::shared_ptr<codec::BaseCodec> Preloader::take(const std::string& file)
+{
+    thread::BlockLock bl(m_mutex);
+
+    if (m_state == IDLE || m_file != file)
+	return nullptr;
+
+    if (m_state == PENDING)
+    {
+	// opening has not been started yet, the caller is faster to do it
+	m_state = IDLE;
+	return nullptr;
+    }
+
+    while (m_state == OPENING)
+	m_doneCond.wait(m_mutex);
+
+    // make sure the file was not replaced while we were waiting
+    if (m_state != DONE || m_file != file)
+	return nullptr;
+
+    std::shared_ptr<codec::BaseCodec> input = m_input;
+
+    m_input.reset();
+    m_state = IDLE;
+
+    return input;
+}
+
+// =====================================================================================================================
+void Preloader::run()
+{
+    while (1)
+    {
+	std::string file;
+
+	m_mutex.lock();
+
+	while (m_state != PENDING)
+	    m_cond.wait(m_mutex);
+
+	file = m_file;
+	m_state = OPENING;
+
+	m_mutex.unlock();
+
+	std::shared_ptr<codec::BaseCodec> input = open(file);
+
+	m_mutex.lock();
+
+	// store the result only if no new file was requested in the meantime
+	if (m_state == OPENING && m_file == file)
+	{
+	    m_input = input;
+	    m_state = DONE;
+	}
+
+	m_doneCond.signal();
+
+	m_mutex.unlock();
+    }
+}
+
+// =====================================================================================================================
+std::shared_ptr<codec::BaseCodec> Preloader::open(const std::string& file)
+{
+    LOG("preloader: opening " << file);
+
+    std::shared_ptr<codec::BaseCodec> input = m_codecManager.create(file);
+
+    if (!input)
+	return nullptr;
+
+    try
+    {
+	input->open();
+    }
+    catch (const codec::CodecException& e)
+    {
+	LOG("preloader: unable to open " << file << ": " << e.what());
+	return nullptr;
+    }
+
+    return input;
+}
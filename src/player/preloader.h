@@ -0,0 +1,78 @@
+/**
+ * This file is part of the Zeppelin music player project.
+ * Copyright (c) 2013-2014 Zoltan Kovacs, Lajos Santa
+ * See http://zeppelin-player.com for more details.
+ */
+
+#ifndef PLAYER_PRELOADER_H_INCLUDED
+#define PLAYER_PRELOADER_H_INCLUDED
+
+#include <thread/thread.h>
+#include <thread/mutex.h>
+#include <thread/condition.h>
+
+#include <memory>
+#include <string>
+
+namespace codec
+{
+class BaseCodec;
+class CodecManager;
+}
+
+namespace player
+{
+
+/**
+ * Opens the input of the next track in the background while the current one is still being decoded, so the decoder
+ * can be switched to it without waiting for the (possibly slow) file opening.
+ */
+class Preloader : public thread::Thread
+{
+    public:
+	Preloader(const codec::CodecManager& codecManager);
+
+	// starts opening the given file in the background, the previously preloaded input is dropped
+	virtual void preload(const std::string& file);
+
+	/**
+	 * Returns the preloaded input of the given file. It waits for the background opening to finish in case it is
+	 * still in progress.
+	 * @return nullptr is returned if the file was not preloaded or it could not be opened
+	 */
+	virtual std::shared_ptr<codec::BaseCodec> take(const std::string& file);
+
+	void run() override;
+
+    private:
+	std::shared_ptr<codec::BaseCodec> open(const std::string& file);
+
+    private:
+	enum State
+	{
+	    IDLE,
+	    // a new file is waiting to be opened
+	    PENDING,
+	    // the file is being opened by the preloader thread
+	    OPENING,
+	    // the result of the opening is available
+	    DONE
+	};
+
+	State m_state;
+
+	// the file being preloaded
+	std::string m_file;
+	// the opened input of the file
+	std::shared_ptr<codec::BaseCodec> m_input;
+
+	thread::Mutex m_mutex;
+	thread::Condition m_cond;
+	thread::Condition m_doneCond;
+
+	const codec::CodecManager& m_codecManager;
+};
+
+}
+
+#endif
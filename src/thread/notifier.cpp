@@ -0,0 +1,53 @@
+/**
+ * This file is part of the Zeppelin music player project.
+ * Copyright (c) 2013-2014 Zoltan Kovacs, Lajos Santa
+ * See http://zeppelin-player.com for more details.
+ */
+
+#include "notifier.h"
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <stdint.h>
+
+using thread::Notifier;
+
+// =====================================================================================================================
+Notifier::Notifier()
+    : m_fd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+{
+}
+
+// =====================================================================================================================
+Notifier::~Notifier()
+{
+    if (m_fd >= 0)
+	close(m_fd);
+}
+
+// =====================================================================================================================
+int Notifier::getFd() const
+{
+    return m_fd;
+}
+
+// =====================================================================================================================
+void Notifier::signal()
+{
+    uint64_t v = 1;
+
+    // the write can only fail if the counter would overflow, in that case the notifier is signalled anyway
+    if (write(m_fd, &v, sizeof(v)) != sizeof(v))
+	return;
+}
+
+// =====================================================================================================================
+void Notifier::clear()
+{
+    uint64_t v;
+
+    // reading resets the counter of the eventfd, EAGAIN means it was not signalled
+    if (read(m_fd, &v, sizeof(v)) != sizeof(v))
+	return;
+}
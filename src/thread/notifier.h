@@ -0,0 +1,35 @@
+/**
+ * This file is part of the Zeppelin music player project.
+ * Copyright (c) 2013-2014 Zoltan Kovacs, Lajos Santa
+ * See http://zeppelin-player.com for more details.
+ */
+
+#ifndef THREAD_NOTIFIER_H_INCLUDED
+#define THREAD_NOTIFIER_H_INCLUDED
+
+namespace thread
+{
+
+/**
+ * Wake-up primitive based on a file descriptor, so it can be waited for with poll() together with other descriptors.
+ */
+class Notifier
+{
+    public:
+	Notifier();
+	~Notifier();
+
+	// returns the descriptor that becomes readable once the notifier is signalled
+	int getFd() const;
+
+	void signal();
+	// clears the signalled state of the notifier
+	void clear();
+
+    private:
+	int m_fd;
+};
+
+}
+
+#endif
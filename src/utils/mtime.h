@@ -0,0 +1,36 @@
+/**
+ * This file is part of the Zeppelin music player project.
+ * Copyright (c) 2013-2014 Zoltan Kovacs, Lajos Santa
+ * See http://zeppelin-player.com for more details.
+ */
+
+#ifndef UTILS_MTIME_H_INCLUDED
+#define UTILS_MTIME_H_INCLUDED
+
+#include <stdint.h>
+#include <time.h>
+#include <sys/stat.h>
+
+namespace utils
+{
+
+/**
+ * Returns the modification time of a file in nanoseconds since the epoch. The resolution of seconds is not enough to
+ * detect the modifications made in the same second the file was scanned.
+ */
+inline int64_t getMtime(const struct stat& st)
+{
+    return static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+}
+
+/// returns the current time in the same unit as getMtime()
+inline int64_t getCurrentMtime()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+}
+
+#endif
@@ -27,6 +27,9 @@ class FakeOutput : public output::BaseOutput
 	player::Format getFormat() const override
 	{ return player::Format(44100, 2); }
 
+	std::string getSampleFormat() const override
+	{ return "S16_LE"; }
+
 	int getFreeSize() override
 	{ return 0; }
 
@@ -39,19 +42,20 @@ class FakeOutput : public output::BaseOutput
 	void drop() override
 	{}
 
-	void write(const float* samples, size_t count) override
+	void write(const float* samples, size_t count, float gain) override
 	{}
 };
 
 class FakeDecoder : public player::Decoder
 {
     public:
-	FakeDecoder(player::Fifo& fifo,
+	FakeDecoder(const std::shared_ptr<output::BaseOutput>& output,
+		    player::Fifo& fifo,
 		    const config::Config& config)
-	    : Decoder(1024, player::Format(44100, 2), fifo, config)
+	    : Decoder(1024, output, fifo, config)
 	{}
 
-	void setInput(const std::shared_ptr<codec::BaseCodec>& input) override
+	void setInput(const std::shared_ptr<codec::BaseCodec>& input, int fileId) override
 	{
 	    if (input)
 		m_cmds.push_back("input file");
@@ -65,10 +69,13 @@ class FakeDecoder : public player::Decoder
 	{ m_cmds.push_back("stop"); }
 
 	void seek(off_t seconds) override
-	{ m_cmds.push_back("seek"); }
+	{ m_cmds.push_back(utils::MakeString() << "seek " << seconds); }
 	void notify() override
 	{ m_cmds.push_back("notify"); }
 
+	void rejectRate(int rate, const player::Format& format) override
+	{ m_cmds.push_back(utils::MakeString() << "reject " << rate << " " << format.getRate()); }
+
 	std::vector<std::string> m_cmds;
 };
 
@@ -88,7 +95,26 @@ class FakePlayer : public player::Player
 	void stopPlayback() override
 	{ m_cmds.push_back("stop"); }
 	void seek(off_t seconds) override
-	{ m_cmds.push_back("seek"); }
+	{ m_cmds.push_back(utils::MakeString() << "seek " << seconds); }
+
+	std::vector<std::string> m_cmds;
+};
+
+class FakePreloader : public player::Preloader
+{
+    public:
+	FakePreloader(const codec::CodecManager& codecManager)
+	    : Preloader(codecManager)
+	{}
+
+	void preload(const std::string& file) override
+	{ m_cmds.push_back("preload " + file); }
+
+	std::shared_ptr<codec::BaseCodec> take(const std::string& file) override
+	{
+	    m_cmds.push_back("take " + file);
+	    return nullptr;
+	}
 
 	std::vector<std::string> m_cmds;
 };
@@ -110,8 +136,8 @@ class FakeCodec : public codec::BaseCodec
 	player::Format getFormat() const override
 	{ return player::Format(44100, 2); }
 
-	bool decode(float*& samples, size_t& count) override
-	{ return false; }
+	size_t decodeInto(float* dst, size_t maxFrames) override
+	{ return 0; }
 
 	void seek(off_t sample) override
 	{}
@@ -180,9 +206,10 @@ struct ControllerFixture : public LibraryBuilder
     ControllerFixture()
 	: m_fifo(1024),
 	  m_output(new FakeOutput(m_config)),
-	  m_decoder(new FakeDecoder(m_fifo, m_config)),
+	  m_decoder(new FakeDecoder(m_output, m_fifo, m_config)),
 	  m_player(new FakePlayer(m_output, m_fifo, m_config)),
-	  m_ctrl(player::ControllerImpl::create(m_codecManager, m_decoder, m_player, m_config))
+	  m_preloader(new FakePreloader(m_codecManager)),
+	  m_ctrl(player::ControllerImpl::create(m_codecManager, m_decoder, m_player, m_preloader, m_config))
     {
 	m_ctrl->addListener(std::make_shared<EventListener>(m_events));
     }
@@ -219,6 +246,8 @@ struct ControllerFixture : public LibraryBuilder
 
     FakeCodecManager m_codecManager;
 
+    std::shared_ptr<FakePreloader> m_preloader;
+
     std::shared_ptr<player::ControllerImpl> m_ctrl;
 
     std::vector<std::string> m_events;
@@ -614,6 +643,10 @@ BOOST_FIXTURE_TEST_CASE(queue_updated_at_decoder_and_song_finished, ControllerFi
     BOOST_REQUIRE_EQUAL(s.m_index.size(), 2);
     BOOST_CHECK_EQUAL(s.m_index[0], 0);
     BOOST_CHECK_EQUAL(s.m_index[1], 0);
+    BOOST_CHECK_EQUAL(s.m_sampleFormat, "S16_LE");
+    // the fake decoder does not resample nor measure anything
+    BOOST_CHECK_EQUAL(s.m_resampleQuality, "");
+    BOOST_CHECK_EQUAL(s.m_decoderHeadroom, 0.0f);
 
     // decoder finished on the first track
     m_ctrl->command(player::ControllerImpl::DECODER_FINISHED);
@@ -675,3 +708,205 @@ BOOST_FIXTURE_TEST_CASE(queue_updated_at_decoder_and_song_finished, ControllerFi
     BOOST_REQUIRE_EQUAL(m_events.size(), 1);
     BOOST_CHECK_EQUAL(m_events[0], "stopped");
 }
+
+BOOST_FIXTURE_TEST_CASE(next_file_preloaded, ControllerFixture)
+{
+    queueFile(createFile(42, "hello.mp3"));
+    queueFile(createFile(57, "world.mp3"));
+    startPlayback();
+
+    // the second file should be opened in the background while the first one is being decoded
+    BOOST_REQUIRE_EQUAL(m_preloader->m_cmds.size(), 2);
+    BOOST_CHECK_EQUAL(m_preloader->m_cmds[0], "take /hello.mp3");
+    BOOST_CHECK_EQUAL(m_preloader->m_cmds[1], "preload /world.mp3");
+    m_preloader->m_cmds.clear();
+
+    // decoder finished on the first track
+    m_ctrl->command(player::ControllerImpl::DECODER_FINISHED);
+    process();
+
+    // the preloaded input is asked for when the decoder switches to the second file, there is nothing to preload
+    // after the last one
+    BOOST_REQUIRE_EQUAL(m_preloader->m_cmds.size(), 1);
+    BOOST_CHECK_EQUAL(m_preloader->m_cmds[0], "take /world.mp3");
+}
+
+BOOST_FIXTURE_TEST_CASE(seek_without_stopping_playback, ControllerFixture)
+{
+    queueFile(createFile(42, "hello.mp3"));
+    startPlayback();
+
+    m_ctrl->seek(3);
+    process();
+
+    BOOST_CHECK_EQUAL(m_ctrl->m_state, Controller::PLAYING);
+
+    // the decoder is still working on the played file, so it should seek in it without being stopped
+    BOOST_REQUIRE_EQUAL(m_decoder->m_cmds.size(), 1);
+    BOOST_CHECK_EQUAL(m_decoder->m_cmds[0], "seek 3");
+    BOOST_REQUIRE_EQUAL(m_player->m_cmds.size(), 1);
+    BOOST_CHECK_EQUAL(m_player->m_cmds[0], "seek 3");
+
+    BOOST_REQUIRE_EQUAL(m_events.size(), 4);
+    BOOST_CHECK_EQUAL(m_events[3], "position-changed 3");
+}
+
+BOOST_FIXTURE_TEST_CASE(seek_after_decoder_finished, ControllerFixture)
+{
+    queueFile(createFile(42, "hello.mp3"));
+    queueFile(createFile(57, "world.mp3"));
+    startPlayback();
+
+    // the decoder already moved to the second file
+    m_ctrl->command(player::ControllerImpl::DECODER_FINISHED);
+    process();
+    m_decoder->m_cmds.clear();
+
+    m_ctrl->seek(3);
+    process();
+
+    // the played file must be loaded into the decoder again
+    BOOST_REQUIRE_EQUAL(m_decoder->m_cmds.size(), 4);
+    BOOST_CHECK_EQUAL(m_decoder->m_cmds[0], "stop");
+    BOOST_CHECK_EQUAL(m_decoder->m_cmds[1], "input file");
+    BOOST_CHECK_EQUAL(m_decoder->m_cmds[2], "seek 3");
+    BOOST_CHECK_EQUAL(m_decoder->m_cmds[3], "start");
+    BOOST_REQUIRE_EQUAL(m_player->m_cmds.size(), 3);
+    BOOST_CHECK_EQUAL(m_player->m_cmds[0], "stop");
+    BOOST_CHECK_EQUAL(m_player->m_cmds[1], "seek 3");
+    BOOST_CHECK_EQUAL(m_player->m_cmds[2], "start");
+}
+
+BOOST_FIXTURE_TEST_CASE(seek_repeated_if_decoder_finished_before_receiving_it, ControllerFixture)
+{
+    queueFile(createFile(42, "hello.mp3"));
+    queueFile(createFile(57, "world.mp3"));
+    startPlayback();
+
+    // the decoder closed its input at the end of the stream but its notification is not processed yet
+    m_ctrl->seek(3);
+    process();
+
+    BOOST_REQUIRE_EQUAL(m_decoder->m_cmds.size(), 1);
+    BOOST_CHECK_EQUAL(m_decoder->m_cmds[0], "seek 3");
+    m_decoder->m_cmds.clear();
+    m_player->m_cmds.clear();
+
+    // the decoder reports the lost seek request after its notification about the end of the stream
+    m_ctrl->command(player::ControllerImpl::DECODER_FINISHED);
+    m_ctrl->seekFailed(3);
+    process();
+
+    BOOST_CHECK_EQUAL(m_ctrl->m_state, Controller::PLAYING);
+
+    // the played file must be loaded into the decoder again
+    BOOST_REQUIRE_EQUAL(m_decoder->m_cmds.size(), 6);
+    BOOST_CHECK_EQUAL(m_decoder->m_cmds[0], "input file");
+    BOOST_CHECK_EQUAL(m_decoder->m_cmds[1], "start");
+    BOOST_CHECK_EQUAL(m_decoder->m_cmds[2], "stop");
+    BOOST_CHECK_EQUAL(m_decoder->m_cmds[3], "input file");
+    BOOST_CHECK_EQUAL(m_decoder->m_cmds[4], "seek 3");
+    BOOST_CHECK_EQUAL(m_decoder->m_cmds[5], "start");
+    BOOST_REQUIRE_EQUAL(m_player->m_cmds.size(), 3);
+    BOOST_CHECK_EQUAL(m_player->m_cmds[0], "stop");
+    BOOST_CHECK_EQUAL(m_player->m_cmds[1], "seek 3");
+    BOOST_CHECK_EQUAL(m_player->m_cmds[2], "start");
+
+    // no new position is announced, it was already sent for the original request
+    BOOST_REQUIRE_EQUAL(m_events.size(), 5);
+    BOOST_CHECK_EQUAL(m_events[4], "position-changed 3");
+}
+
+BOOST_FIXTURE_TEST_CASE(failed_seek_ignored_after_song_changed, ControllerFixture)
+{
+    queueFile(createFile(42, "hello.mp3"));
+    queueFile(createFile(57, "world.mp3"));
+    startPlayback();
+
+    m_ctrl->seek(3);
+    m_ctrl->command(player::ControllerImpl::DECODER_FINISHED);
+    m_ctrl->command(player::ControllerImpl::SONG_FINISHED);
+    process();
+    m_decoder->m_cmds.clear();
+    m_player->m_cmds.clear();
+
+    // the request belonged to the previous song
+    m_ctrl->seekFailed(3);
+    process();
+
+    BOOST_CHECK(m_decoder->m_cmds.empty());
+    BOOST_CHECK(m_player->m_cmds.empty());
+}
+
+BOOST_FIXTURE_TEST_CASE(track_resampled_if_output_format_failed, ControllerFixture)
+{
+    queueFile(createFile(42, "hello.mp3"));
+    queueFile(createFile(57, "world.mp3"));
+    startPlayback();
+
+    // the player reached the second file but the output could not be switched to its rate
+    m_ctrl->command(player::ControllerImpl::DECODER_FINISHED);
+    m_ctrl->command(player::ControllerImpl::SONG_FINISHED);
+    process();
+    m_decoder->m_cmds.clear();
+    m_player->m_cmds.clear();
+
+    m_ctrl->formatFailed(96000, player::Format(44100, 2));
+    process();
+
+    BOOST_CHECK_EQUAL(m_ctrl->m_state, Controller::PLAYING);
+
+    // the samples decoded with the rejected rate must be dropped and the file must be loaded again
+    BOOST_REQUIRE_EQUAL(m_decoder->m_cmds.size(), 5);
+    BOOST_CHECK_EQUAL(m_decoder->m_cmds[0], "reject 96000 44100");
+    BOOST_CHECK_EQUAL(m_decoder->m_cmds[1], "stop");
+    BOOST_CHECK_EQUAL(m_decoder->m_cmds[2], "input file");
+    BOOST_CHECK_EQUAL(m_decoder->m_cmds[3], "seek 0");
+    BOOST_CHECK_EQUAL(m_decoder->m_cmds[4], "start");
+    BOOST_REQUIRE_EQUAL(m_player->m_cmds.size(), 3);
+    BOOST_CHECK_EQUAL(m_player->m_cmds[0], "stop");
+    BOOST_CHECK_EQUAL(m_player->m_cmds[1], "seek 0");
+    BOOST_CHECK_EQUAL(m_player->m_cmds[2], "start");
+
+    // the played file must not change
+    auto s = m_ctrl->getStatus();
+    BOOST_REQUIRE_EQUAL(s.m_index.size(), 1);
+    BOOST_CHECK_EQUAL(s.m_index[0], 1);
+}
+
+BOOST_FIXTURE_TEST_CASE(output_format_restored_if_stopped_before_format_played, ControllerFixture)
+{
+    player::Decoder decoder(1024, m_output, m_fifo, m_config);
+
+    // the decoder advanced to a track with a rate the output is switched to at the track boundary
+    decoder.m_format = player::Format(96000, 2);
+    decoder.switchRate();
+    BOOST_CHECK_EQUAL(decoder.m_outputFormat.getRate(), 96000);
+
+    // the playback is stopped before the player reached the format record
+    decoder.resetFifo();
+
+    // the next input with the same rate has to switch the output again
+    BOOST_CHECK_EQUAL(m_fifo.getNextEvent(), player::Fifo::NONE);
+    BOOST_CHECK_EQUAL(decoder.m_outputFormat.getRate(), 44100);
+}
+
+BOOST_FIXTURE_TEST_CASE(seek_requests_coalesced, ControllerFixture)
+{
+    queueFile(createFile(42, "hello.mp3"));
+    startPlayback();
+
+    m_ctrl->seek(3);
+    m_ctrl->seek(7);
+    m_ctrl->seek(11);
+    process();
+
+    // only the last one of the queued seek requests should be performed
+    BOOST_REQUIRE_EQUAL(m_decoder->m_cmds.size(), 1);
+    BOOST_CHECK_EQUAL(m_decoder->m_cmds[0], "seek 11");
+    BOOST_REQUIRE_EQUAL(m_player->m_cmds.size(), 1);
+    BOOST_CHECK_EQUAL(m_player->m_cmds[0], "seek 11");
+
+    BOOST_REQUIRE_EQUAL(m_events.size(), 4);
+    BOOST_CHECK_EQUAL(m_events[3], "position-changed 11");
+}
@@ -19,7 +19,7 @@ static void notifyCallback()
 
 BOOST_AUTO_TEST_CASE(TestFifo)
 {
-    Fifo fifo(3);
+    Fifo fifo(64);
     fifo.setNotifyCallback(3, std::bind(&notifyCallback));
 
     int16_t tst1[] = {1, 2};
@@ -30,14 +30,14 @@ BOOST_AUTO_TEST_CASE(TestFifo)
     BOOST_CHECK_EQUAL(fifo.getBytes(), 0);
 
     // put some sample into the fifo
-    fifo.addSamples(tst1, sizeof(tst1));
+    BOOST_REQUIRE(fifo.addSamples(tst1, sizeof(tst1)));
     BOOST_CHECK_EQUAL(fifo.getBytes(), 4);
 
     // add a marker
-    fifo.addMarker();
+    BOOST_REQUIRE(fifo.addMarker());
 
     // put some more samples into the fifo
-    fifo.addSamples(tst2, sizeof(tst2));
+    BOOST_REQUIRE(fifo.addSamples(tst2, sizeof(tst2)));
     BOOST_CHECK_EQUAL(fifo.getBytes(), 6);
 
     // get the first event
@@ -73,3 +73,150 @@ BOOST_AUTO_TEST_CASE(TestFifo)
     // the fifo should have no more events now
     BOOST_CHECK_EQUAL(fifo.getNextEvent(), Fifo::NONE);
 }
+
+BOOST_AUTO_TEST_CASE(TestFifoWrapAround)
+{
+    // the smallest fifo has room for 64 bytes including the record headers
+    Fifo fifo(1);
+
+    int32_t in[4] = {1, 2, 3, 4};
+    int32_t out[4];
+
+    // a full fifo must refuse new data
+    BOOST_REQUIRE(fifo.addSamples(in, 48));
+    BOOST_CHECK(!fifo.addSamples(in, sizeof(in)));
+    BOOST_CHECK_EQUAL(fifo.getBytes(), 48);
+
+    // drain it ...
+    BOOST_REQUIRE_EQUAL(fifo.getNextEvent(), Fifo::SAMPLES);
+    BOOST_REQUIRE_EQUAL(fifo.readSamples(out, sizeof(out)), sizeof(out));
+    BOOST_REQUIRE_EQUAL(fifo.readSamples(out, sizeof(out)), sizeof(out));
+    BOOST_REQUIRE_EQUAL(fifo.readSamples(out, sizeof(out)), sizeof(out));
+    BOOST_CHECK_EQUAL(fifo.getNextEvent(), Fifo::NONE);
+
+    // ... and put samples around the end of the ring
+    BOOST_REQUIRE(fifo.addSamples(in, sizeof(in)));
+    BOOST_REQUIRE(fifo.addMarker());
+    BOOST_CHECK_EQUAL(fifo.getBytes(), sizeof(in));
+
+    BOOST_REQUIRE_EQUAL(fifo.getNextEvent(), Fifo::SAMPLES);
+    BOOST_REQUIRE_EQUAL(fifo.readSamples(out, sizeof(out)), sizeof(out));
+    BOOST_CHECK_EQUAL_COLLECTIONS(out, out + 4, in, in + 4);
+    BOOST_CHECK_EQUAL(fifo.getNextEvent(), Fifo::MARKER);
+    BOOST_CHECK_EQUAL(fifo.getNextEvent(), Fifo::NONE);
+    BOOST_CHECK_EQUAL(fifo.getBytes(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(TestFifoInPlace)
+{
+    Fifo fifo(64);
+
+    // fill the reserved area in place
+    int16_t* p = reinterpret_cast<int16_t*>(fifo.reserve(3 * sizeof(int16_t)));
+    BOOST_REQUIRE(p);
+    p[0] = 1;
+    p[1] = 2;
+    p[2] = 3;
+
+    // nothing is visible before commit
+    BOOST_CHECK_EQUAL(fifo.getNextEvent(), Fifo::NONE);
+
+    // publish only the first two samples
+    fifo.commit(2 * sizeof(int16_t));
+    BOOST_CHECK_EQUAL(fifo.getBytes(), 4);
+    BOOST_REQUIRE(fifo.addMarker());
+
+    // too much data must be refused
+    BOOST_CHECK(fifo.reserve(64) == NULL);
+
+    // access the samples without copying them
+    void* data;
+    BOOST_REQUIRE_EQUAL(fifo.peek(data), 4);
+    BOOST_CHECK_EQUAL(reinterpret_cast<int16_t*>(data)[0], 1);
+    fifo.consume(sizeof(int16_t));
+    BOOST_CHECK_EQUAL(fifo.getBytes(), 2);
+
+    BOOST_REQUIRE_EQUAL(fifo.peek(data), 2);
+    BOOST_CHECK_EQUAL(reinterpret_cast<int16_t*>(data)[0], 2);
+    fifo.consume(sizeof(int16_t));
+
+    // peek must leave the marker in the fifo
+    BOOST_CHECK_EQUAL(fifo.peek(data), 0);
+    BOOST_CHECK_EQUAL(fifo.getNextEvent(), Fifo::MARKER);
+    BOOST_CHECK_EQUAL(fifo.getNextEvent(), Fifo::NONE);
+}
+
+BOOST_AUTO_TEST_CASE(TestFifoFlush)
+{
+    Fifo fifo(256);
+    uint8_t data[32];
+
+    memset(data, 0x11, sizeof(data));
+    BOOST_REQUIRE(fifo.addSamples(data, sizeof(data)));
+    BOOST_REQUIRE(fifo.addMarker());
+    BOOST_REQUIRE(fifo.addSamples(data, sizeof(data)));
+
+    // read a part of the first record before flushing
+    uint8_t buf[32];
+    BOOST_REQUIRE_EQUAL(fifo.getNextEvent(), Fifo::SAMPLES);
+    BOOST_REQUIRE_EQUAL(fifo.readSamples(buf, 8), 8);
+
+    fifo.flush();
+
+    memset(data, 0x22, sizeof(data));
+    BOOST_REQUIRE(fifo.addSamples(data, 16));
+
+    // the samples of the old generation are not accessible anymore
+    void* p;
+    BOOST_CHECK_EQUAL(fifo.peek(p), 0);
+
+    // the old records including the marker are dropped and only the new samples are left
+    BOOST_CHECK_EQUAL(fifo.getNextEvent(), Fifo::FLUSH);
+    BOOST_CHECK_EQUAL(fifo.getBytes(), 16);
+    BOOST_CHECK_EQUAL(fifo.getNextEvent(), Fifo::SAMPLES);
+    BOOST_REQUIRE_EQUAL(fifo.readSamples(buf, sizeof(buf)), 16);
+    BOOST_CHECK_EQUAL(buf[0], 0x22);
+    BOOST_CHECK_EQUAL(buf[15], 0x22);
+    BOOST_CHECK_EQUAL(fifo.getNextEvent(), Fifo::NONE);
+    BOOST_CHECK_EQUAL(fifo.getBytes(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(TestFifoFormat)
+{
+    Fifo fifo(256);
+    uint8_t data[16] = { 0 };
+
+    // samples of the previous track, its marker and the format of the next one
+    BOOST_REQUIRE(fifo.addSamples(data, sizeof(data)));
+    BOOST_REQUIRE(fifo.addMarker());
+    BOOST_REQUIRE(fifo.addFormat(player::Format(96000, 2)));
+    BOOST_REQUIRE(fifo.addSamples(data, sizeof(data)));
+
+    // the format record does not count as samples
+    BOOST_CHECK_EQUAL(fifo.getBytes(), 32);
+
+    uint8_t buf[16];
+    BOOST_REQUIRE_EQUAL(fifo.getNextEvent(), Fifo::SAMPLES);
+    BOOST_REQUIRE_EQUAL(fifo.readSamples(buf, sizeof(buf)), 16);
+
+    // samples are not accessible before the player sees the marker and the format
+    void* p;
+    BOOST_CHECK_EQUAL(fifo.peek(p), 0);
+    BOOST_CHECK_EQUAL(fifo.getNextEvent(), Fifo::MARKER);
+    BOOST_CHECK_EQUAL(fifo.peek(p), 0);
+    BOOST_REQUIRE_EQUAL(fifo.getNextEvent(), Fifo::FORMAT);
+    BOOST_CHECK_EQUAL(fifo.getFormat().getRate(), 96000);
+    BOOST_CHECK_EQUAL(fifo.getFormat().getChannels(), 2);
+
+    BOOST_CHECK_EQUAL(fifo.getNextEvent(), Fifo::SAMPLES);
+    BOOST_REQUIRE_EQUAL(fifo.readSamples(buf, sizeof(buf)), 16);
+    BOOST_CHECK_EQUAL(fifo.getNextEvent(), Fifo::NONE);
+
+    // format records dropped by a flush do not disturb the byte counter
+    BOOST_REQUIRE(fifo.addFormat(player::Format(44100, 2)));
+    BOOST_REQUIRE(fifo.addSamples(data, sizeof(data)));
+    fifo.flush();
+    BOOST_CHECK_EQUAL(fifo.getNextEvent(), Fifo::FLUSH);
+    BOOST_CHECK_EQUAL(fifo.getBytes(), 0);
+    BOOST_CHECK_EQUAL(fifo.getNextEvent(), Fifo::NONE);
+}
@@ -0,0 +1,125 @@
+/**
+ * This file is part of the Zeppelin music player project.
+ * Copyright (c) 2013-2014 Zoltan Kovacs, Lajos Santa
+ * See http://zeppelin-player.com for more details.
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include <output/formatconverter.h>
+
+#include <vector>
+#include <random>
+#include <cstring>
+
+using output::FormatConverter;
+using codec::SampleConverter;
+
+// odd number of samples to exercise the scalar tail of the vectorized loops as well
+static const size_t s_count = 1027;
+
+static const SampleConverter::Implementation s_impls[] = {
+    SampleConverter::SSE2,
+    SampleConverter::AVX2,
+    SampleConverter::NEON
+};
+
+BOOST_AUTO_TEST_CASE(TestFormatConverterScalar)
+{
+    FormatConverter conv(SampleConverter::SCALAR);
+
+    float src[] = { -2.0f, -1.0f, 0.0f, 0.5f, 1.5f };
+    float f[5];
+    int16_t s16[5];
+
+    conv.f32(src, f, 5, 0.5f);
+
+    BOOST_CHECK_EQUAL(f[0], -1.0f);
+    BOOST_CHECK_EQUAL(f[1], -0.5f);
+    BOOST_CHECK_EQUAL(f[2], 0.0f);
+    BOOST_CHECK_EQUAL(f[3], 0.25f);
+    BOOST_CHECK_EQUAL(f[4], 0.75f);
+
+    conv.s16(src, s16, 5, 1.0f);
+
+    BOOST_CHECK_EQUAL(s16[0], -32767);
+    BOOST_CHECK_EQUAL(s16[1], -32767);
+    BOOST_CHECK_EQUAL(s16[2], 0);
+    BOOST_CHECK_EQUAL(s16[3], 16383);
+    BOOST_CHECK_EQUAL(s16[4], 32767);
+
+    int32_t s32[5];
+
+    conv.s32(src, s32, 5, 1.0f);
+
+    BOOST_CHECK_EQUAL(s32[0], -0x7fffff00);
+    BOOST_CHECK_EQUAL(s32[2], 0);
+    BOOST_CHECK_EQUAL(s32[3], 0x3fffff00);
+    BOOST_CHECK_EQUAL(s32[4], 0x7fffff00);
+
+    // 24 bit samples in little endian order
+    uint8_t s24[15];
+
+    conv.s24(src, s24, 5, 1.0f);
+
+    BOOST_CHECK_EQUAL(s24[0], 0x01);
+    BOOST_CHECK_EQUAL(s24[1], 0x00);
+    BOOST_CHECK_EQUAL(s24[2], 0x80);
+    BOOST_CHECK_EQUAL(s24[9], 0xff);
+    BOOST_CHECK_EQUAL(s24[10], 0xff);
+    BOOST_CHECK_EQUAL(s24[11], 0x3f);
+    BOOST_CHECK_EQUAL(s24[12], 0xff);
+    BOOST_CHECK_EQUAL(s24[13], 0xff);
+    BOOST_CHECK_EQUAL(s24[14], 0x7f);
+}
+
+BOOST_AUTO_TEST_CASE(TestFormatConverterVectorized)
+{
+    FormatConverter scalar(SampleConverter::SCALAR);
+
+    std::mt19937 rnd(42);
+    std::uniform_real_distribution<float> dist(-1.5f, 1.5f);
+
+    // samples out of the valid range are included to check clamping as well
+    std::vector<float> src(s_count);
+
+    for (float& s : src)
+	s = dist(rnd);
+
+    std::vector<float> expected(s_count);
+    std::vector<float> result(s_count);
+    std::vector<int16_t> expected16(s_count);
+    std::vector<int16_t> result16(s_count);
+    std::vector<int32_t> expected32(s_count);
+    std::vector<int32_t> result32(s_count);
+    std::vector<uint8_t> expected24(s_count * 3);
+    std::vector<uint8_t> result24(s_count * 3);
+
+    for (SampleConverter::Implementation impl : s_impls)
+    {
+	if (!SampleConverter::isSupported(impl))
+	    continue;
+
+	FormatConverter conv(impl);
+	BOOST_TEST_MESSAGE("checking " << conv.getName());
+
+	for (float gain : { 1.0f, 0.3f, 1.2f })
+	{
+	    scalar.f32(&src[0], &expected[0], s_count, gain);
+	    conv.f32(&src[0], &result[0], s_count, gain);
+	    BOOST_CHECK(memcmp(&expected[0], &result[0], s_count * sizeof(float)) == 0);
+
+	    scalar.s16(&src[0], &expected16[0], s_count, gain);
+	    conv.s16(&src[0], &result16[0], s_count, gain);
+	    BOOST_CHECK(memcmp(&expected16[0], &result16[0], s_count * sizeof(int16_t)) == 0);
+
+	    scalar.s24(&src[0], &expected24[0], s_count, gain);
+	    conv.s24(&src[0], &result24[0], s_count, gain);
+	    BOOST_CHECK(expected24 == result24);
+
+	    scalar.s32(&src[0], &expected32[0], s_count, gain);
+	    conv.s32(&src[0], &result32[0], s_count, gain);
+	    BOOST_CHECK(expected32 == result32);
+	}
+    }
+}
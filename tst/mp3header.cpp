@@ -0,0 +1,108 @@
+/**
+ * This file is part of the Zeppelin music player project.
+ * Copyright (c) 2013-2014 Zoltan Kovacs, Lajos Santa
+ * See http://zeppelin-player.com for more details.
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include <codec/mp3header.h>
+
+#include <vector>
+#include <cstring>
+
+using codec::Mp3Header;
+
+// MPEG 1 layer III, 44100 Hz, stereo frames with the given bitrate index
+static void addFrames(std::vector<uint8_t>& data, int bitrateIndex, int count)
+{
+    static const int bitrates[] = { 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320 };
+
+    for (int i = 0; i < count; ++i)
+    {
+	size_t offset = data.size();
+	data.resize(offset + 144000 * bitrates[bitrateIndex] / 44100);
+	data[offset] = 0xff;
+	data[offset + 1] = 0xfb;
+	data[offset + 2] = bitrateIndex << 4;
+	data[offset + 3] = 0x00;
+    }
+}
+
+static void writeBE32(uint8_t* p, uint32_t value)
+{
+    p[0] = value >> 24;
+    p[1] = value >> 16;
+    p[2] = value >> 8;
+    p[3] = value;
+}
+
+BOOST_AUTO_TEST_CASE(TestMp3HeaderCbr)
+{
+    std::vector<uint8_t> data;
+
+    // garbage with a false sync word before the first frame
+    data.push_back(0x00);
+    data.push_back(0xff);
+    data.push_back(0xfb);
+    data.push_back(0x90);
+    data.push_back(0x00);
+    addFrames(data, 9, 20);
+
+    Mp3Header header;
+
+    // 128 kbit/s for 100 seconds
+    BOOST_REQUIRE(header.parse(&data[0], data.size(), 5 + 1600000));
+    BOOST_CHECK_EQUAL(header.getSource(), Mp3Header::CBR);
+    BOOST_CHECK_EQUAL(header.getRate(), 44100);
+    BOOST_CHECK_EQUAL(header.getChannels(), 2);
+    BOOST_CHECK_EQUAL(header.getSamples(), 100 * 44100);
+}
+
+BOOST_AUTO_TEST_CASE(TestMp3HeaderVbrWithoutHeader)
+{
+    std::vector<uint8_t> data;
+    addFrames(data, 9, 5);
+    addFrames(data, 11, 5);
+
+    // the length cannot be computed from the size of the file
+    Mp3Header header;
+    BOOST_CHECK(!header.parse(&data[0], data.size(), 1000000));
+    BOOST_CHECK_EQUAL(header.getSource(), Mp3Header::NONE);
+}
+
+BOOST_AUTO_TEST_CASE(TestMp3HeaderXing)
+{
+    std::vector<uint8_t> data;
+    addFrames(data, 9, 1);
+    addFrames(data, 11, 5);
+
+    // the header follows the 32 bytes of side information of a stereo MPEG 1 frame
+    memcpy(&data[36], "Xing", 4);
+    writeBE32(&data[40], 0x0f);
+    writeBE32(&data[44], 5000);
+
+    Mp3Header header;
+    BOOST_REQUIRE(header.parse(&data[0], data.size(), 1000000));
+    BOOST_CHECK_EQUAL(header.getSource(), Mp3Header::XING);
+    BOOST_CHECK_EQUAL(header.getSamples(), 5000 * 1152);
+
+    // without the number of frames the stream is checked as CBR
+    writeBE32(&data[40], 0x0e);
+    BOOST_CHECK(!header.parse(&data[0], data.size(), 1000000));
+}
+
+BOOST_AUTO_TEST_CASE(TestMp3HeaderVbri)
+{
+    std::vector<uint8_t> data;
+    addFrames(data, 9, 1);
+    addFrames(data, 11, 5);
+
+    memcpy(&data[36], "VBRI", 4);
+    writeBE32(&data[50], 3000);
+
+    Mp3Header header;
+    BOOST_REQUIRE(header.parse(&data[0], data.size(), 1000000));
+    BOOST_CHECK_EQUAL(header.getSource(), Mp3Header::VBRI);
+    BOOST_CHECK_EQUAL(header.getSamples(), 3000 * 1152);
+}
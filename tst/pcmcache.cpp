@@ -0,0 +1,89 @@
+/**
+ * This file is part of the Zeppelin music player project.
+ * Copyright (c) 2013-2014 Zoltan Kovacs, Lajos Santa
+ * See http://zeppelin-player.com for more details.
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include <player/pcmcache.h>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+using player::PcmCache;
+
+static std::vector<float> createBlock(size_t size, float value)
+{
+    return std::vector<float>(size, value);
+}
+
+BOOST_AUTO_TEST_CASE(TestPcmCacheMemory)
+{
+    config::Cache cfg;
+    cfg.m_memoryLimit = 3 * 1024 * sizeof(float);
+
+    PcmCache cache(cfg);
+
+    cache.put(PcmCache::Key(1, 44100, 0), createBlock(1024, 0.1f));
+    cache.put(PcmCache::Key(1, 44100, 1), createBlock(1024, 0.2f));
+    cache.put(PcmCache::Key(2, 44100, 0), createBlock(1024, 0.3f));
+    BOOST_CHECK_EQUAL(cache.getMemoryUsage(), 3 * 1024 * sizeof(float));
+
+    // touch the first block to make the second one the least recently used
+    PcmCache::Block b = cache.get(PcmCache::Key(1, 44100, 0));
+    BOOST_REQUIRE(b);
+    BOOST_CHECK_EQUAL(b->size(), 1024);
+    BOOST_CHECK_EQUAL((*b)[0], 0.1f);
+
+    cache.put(PcmCache::Key(3, 44100, 0), createBlock(1024, 0.4f));
+
+    BOOST_CHECK_EQUAL(cache.getMemoryUsage(), 3 * 1024 * sizeof(float));
+    BOOST_CHECK(cache.get(PcmCache::Key(1, 44100, 0)));
+    BOOST_CHECK(!cache.get(PcmCache::Key(1, 44100, 1)));
+    BOOST_CHECK(cache.get(PcmCache::Key(2, 44100, 0)));
+    BOOST_CHECK(cache.get(PcmCache::Key(3, 44100, 0)));
+
+    // the sampling rate is part of the key
+    BOOST_CHECK(!cache.get(PcmCache::Key(3, 48000, 0)));
+}
+
+BOOST_AUTO_TEST_CASE(TestPcmCacheDisk)
+{
+    char dir[] = "/tmp/pcmcacheXXXXXX";
+    BOOST_REQUIRE(mkdtemp(dir));
+
+    config::Cache cfg;
+    cfg.m_memoryLimit = 1024 * sizeof(float);
+    cfg.m_directory = dir;
+    cfg.m_diskLimit = 1024 * sizeof(float);
+
+    {
+	PcmCache cache(cfg);
+
+	cache.put(PcmCache::Key(1, 44100, 0), createBlock(1024, 0.1f));
+	cache.put(PcmCache::Key(1, 44100, 1), createBlock(1024, 0.2f));
+
+	// the first block is spilled to the disk
+	BOOST_CHECK_EQUAL(cache.getMemoryUsage(), 1024 * sizeof(float));
+	BOOST_CHECK_EQUAL(cache.getDiskUsage(), 1024 * sizeof(float));
+
+	// reading it back moves it to the memory and pushes out the second one
+	PcmCache::Block b = cache.get(PcmCache::Key(1, 44100, 0));
+	BOOST_REQUIRE(b);
+	BOOST_CHECK_EQUAL(b->size(), 1024);
+	BOOST_CHECK_EQUAL((*b)[1023], 0.1f);
+
+	b = cache.get(PcmCache::Key(1, 44100, 1));
+	BOOST_REQUIRE(b);
+	BOOST_CHECK_EQUAL((*b)[0], 0.2f);
+
+	// a third block does not fit into the disk limit beside the others, so the oldest one is dropped
+	cache.put(PcmCache::Key(2, 44100, 0), createBlock(1024, 0.3f));
+	BOOST_CHECK(!cache.get(PcmCache::Key(1, 44100, 0)));
+	BOOST_CHECK(cache.get(PcmCache::Key(1, 44100, 1)));
+    }
+
+    // the spilled blocks are removed with the cache
+    BOOST_CHECK_EQUAL(rmdir(dir), 0);
+}
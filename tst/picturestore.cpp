@@ -0,0 +1,60 @@
+/**
+ * This file is part of the Zeppelin music player project.
+ * Copyright (c) 2013-2014 Zoltan Kovacs, Lajos Santa
+ * See http://zeppelin-player.com for more details.
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include <library/picturestore.h>
+
+#include <string>
+#include <cstdio>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+using library::PictureStore;
+
+BOOST_AUTO_TEST_CASE(TestPictureStore)
+{
+    char dir[] = "/tmp/zeppelin-pictures-XXXXXX";
+    BOOST_REQUIRE(mkdtemp(dir));
+
+    // the directory is created by the first picture
+    std::string directory = std::string(dir) + "/pictures";
+
+    PictureStore store;
+    store.open(directory);
+
+    const unsigned char a[] = "picture a";
+    const unsigned char b[] = "picture b";
+
+    std::string nameA = store.add(a, sizeof(a), "image/jpeg");
+    std::string nameB = store.add(b, sizeof(b), "image/png");
+
+    BOOST_REQUIRE(!nameA.empty());
+    BOOST_REQUIRE(!nameB.empty());
+    BOOST_CHECK(nameA != nameB);
+    BOOST_CHECK_EQUAL(nameA.substr(nameA.size() - 5), ".jpeg");
+    BOOST_CHECK_EQUAL(store.getPath(nameA), directory + "/" + nameA);
+
+    // the same content is stored once
+    BOOST_CHECK_EQUAL(store.add(a, sizeof(a), "image/jpeg"), nameA);
+
+    // a file with the same name but different content is not reused
+    FILE* f = fopen(store.getPath(nameA).c_str(), "wb");
+    BOOST_REQUIRE(f);
+    fwrite(b, 1, sizeof(b), f);
+    fclose(f);
+
+    std::string nameA2 = store.add(a, sizeof(a), "image/jpeg");
+    BOOST_CHECK(!nameA2.empty());
+    BOOST_CHECK(nameA2 != nameA);
+
+    for (const auto& name : { nameA, nameA2, nameB })
+	unlink(store.getPath(name).c_str());
+
+    rmdir(directory.c_str());
+    rmdir(dir);
+}
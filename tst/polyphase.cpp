@@ -0,0 +1,136 @@
+/**
+ * This file is part of the Zeppelin music player project.
+ * Copyright (c) 2013-2014 Zoltan Kovacs, Lajos Santa
+ * See http://zeppelin-player.com for more details.
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include <filter/polyphase.h>
+
+#include <vector>
+#include <cmath>
+
+using filter::Polyphase;
+using codec::SampleConverter;
+
+static const SampleConverter::Implementation s_impls[] = {
+    SampleConverter::SSE2,
+    SampleConverter::AVX2,
+    SampleConverter::NEON
+};
+
+// generates a stereo sine wave with different phases on the channels
+static std::vector<float> generateSine(int rate, double freq, size_t frames)
+{
+    std::vector<float> samples(frames * 2);
+
+    for (size_t i = 0; i < frames; ++i)
+    {
+	samples[i * 2] = 0.5 * sin(2 * M_PI * freq * i / rate);
+	samples[i * 2 + 1] = 0.5 * cos(2 * M_PI * freq * i / rate);
+    }
+
+    return samples;
+}
+
+// resamples the input in chunks of the given size
+static std::vector<float> resample(Polyphase& filter, const std::vector<float>& input, size_t chunk)
+{
+    player::Format format(44100, 2);
+    std::vector<float> output;
+
+    for (size_t pos = 0; pos < input.size() / 2; pos += chunk)
+    {
+	std::vector<float> tmp(input.begin() + pos * 2, input.begin() + std::min(pos + chunk, input.size() / 2) * 2);
+
+	float* samples = &tmp[0];
+	size_t count = tmp.size() / 2;
+
+	filter.run(samples, count, format);
+	output.insert(output.end(), samples, samples + count * 2);
+    }
+
+    return output;
+}
+
+BOOST_AUTO_TEST_CASE(TestPolyphaseSupported)
+{
+    BOOST_CHECK(Polyphase::isSupported(44100, 48000));
+    BOOST_CHECK(Polyphase::isSupported(48000, 44100));
+    BOOST_CHECK(Polyphase::isSupported(44100, 96000));
+    BOOST_CHECK(Polyphase::isSupported(192000, 44100));
+    BOOST_CHECK(!Polyphase::isSupported(44100, 44101));
+    BOOST_CHECK(!Polyphase::isSupported(0, 44100));
+
+    config::Config config;
+    Polyphase filter(44100, 44101, config);
+    BOOST_CHECK_THROW(filter.init(), filter::FilterException);
+}
+
+BOOST_AUTO_TEST_CASE(TestPolyphaseSine)
+{
+    config::Config config;
+    Polyphase filter(44100, 48000, config, SampleConverter::SCALAR);
+    filter.init();
+
+    std::vector<float> output = resample(filter, generateSine(44100, 1000.0, 44100), 1000);
+
+    // one second of input produces one second of output except the delay of the filter
+    size_t frames = output.size() / 2;
+    BOOST_CHECK(frames > 47950 && frames <= 48000);
+
+    // compare the output with the ideal sine wave after the transient at the start
+    double error = 0.0;
+
+    for (size_t i = 100; i < frames; ++i)
+    {
+	error = std::max(error, std::abs(output[i * 2] - 0.5 * sin(2 * M_PI * 1000.0 * i / 48000)));
+	error = std::max(error, std::abs(output[i * 2 + 1] - 0.5 * cos(2 * M_PI * 1000.0 * i / 48000)));
+    }
+
+    BOOST_CHECK_SMALL(error, 1e-3);
+}
+
+BOOST_AUTO_TEST_CASE(TestPolyphaseReset)
+{
+    config::Config config;
+    Polyphase filter(48000, 44100, config);
+    filter.init();
+
+    std::vector<float> input = generateSine(48000, 440.0, 4800);
+
+    // the chunk size and a reset must not change the output
+    std::vector<float> first = resample(filter, input, 4800);
+    filter.reset();
+    std::vector<float> second = resample(filter, input, 333);
+
+    BOOST_CHECK(first == second);
+}
+
+BOOST_AUTO_TEST_CASE(TestPolyphaseVectorized)
+{
+    config::Config config;
+    std::vector<float> input = generateSine(44100, 3000.0, 8000);
+
+    Polyphase scalar(44100, 48000, config, SampleConverter::SCALAR);
+    scalar.init();
+    std::vector<float> expected = resample(scalar, input, 1024);
+
+    for (SampleConverter::Implementation impl : s_impls)
+    {
+	if (!SampleConverter::isSupported(impl))
+	    continue;
+
+	Polyphase filter(44100, 48000, config, impl);
+	filter.init();
+	BOOST_TEST_MESSAGE("checking " << filter.getName());
+
+	std::vector<float> result = resample(filter, input, 1024);
+	BOOST_REQUIRE_EQUAL(result.size(), expected.size());
+
+	// the order of the additions differs from the scalar implementation
+	for (size_t i = 0; i < result.size(); ++i)
+	    BOOST_CHECK_SMALL(result[i] - expected[i], 1e-5f);
+    }
+}
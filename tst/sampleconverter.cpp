@@ -0,0 +1,154 @@
+/**
+ * This file is part of the Zeppelin music player project.
+ * Copyright (c) 2013-2014 Zoltan Kovacs, Lajos Santa
+ * See http://zeppelin-player.com for more details.
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include <codec/sampleconverter.h>
+
+#include <vector>
+#include <random>
+#include <limits>
+#include <cstring>
+
+using codec::SampleConverter;
+
+// odd number of samples to exercise the scalar tail of the vectorized loops as well
+static const size_t s_count = 1027;
+
+static const SampleConverter::Implementation s_impls[] = {
+    SampleConverter::SSE2,
+    SampleConverter::AVX2,
+    SampleConverter::NEON
+};
+
+template <typename T>
+static std::vector<T> createSamples()
+{
+    std::mt19937 rnd(42);
+    std::uniform_int_distribution<int64_t> dist(std::numeric_limits<T>::min(), std::numeric_limits<T>::max());
+
+    std::vector<T> samples(s_count);
+
+    for (T& s : samples)
+	s = dist(rnd);
+
+    // make sure the extremes (requiring clamping) are covered too
+    samples[0] = std::numeric_limits<T>::min();
+    samples[1] = std::numeric_limits<T>::max();
+    samples[2] = 0;
+
+    return samples;
+}
+
+static bool isIdentical(const std::vector<float>& a, const std::vector<float>& b)
+{
+    return a.size() == b.size() && memcmp(&a[0], &b[0], a.size() * sizeof(float)) == 0;
+}
+
+BOOST_AUTO_TEST_CASE(TestSampleConverterScalar)
+{
+    SampleConverter conv(SampleConverter::SCALAR);
+
+    int16_t s16[] = { -32768, -32767, 0, 16384, 32767 };
+    float f[6];
+
+    conv.s16(s16, f, 5, 32767.0f);
+
+    BOOST_CHECK_EQUAL(f[0], -1.0f);
+    BOOST_CHECK_EQUAL(f[1], -1.0f);
+    BOOST_CHECK_EQUAL(f[2], 0.0f);
+    BOOST_CHECK_EQUAL(f[3], 16384 / 32767.0f);
+    BOOST_CHECK_EQUAL(f[4], 1.0f);
+
+    // 24 bit samples in little endian order
+    uint8_t s24[] = { 0xff, 0xff, 0x7f, 0x00, 0x00, 0x80, 0x01, 0x00, 0x00 };
+
+    conv.s24(s24, f, 3, 0x7fffff);
+
+    BOOST_CHECK_EQUAL(f[0], 1.0f);
+    BOOST_CHECK_EQUAL(f[1], -1.0f);
+    BOOST_CHECK_EQUAL(f[2], 1.0f / 0x7fffff);
+
+    int32_t left[] = { 1, 2, 3 };
+    int32_t right[] = { -1, -2, -3 };
+    const int32_t* planar[] = { left, right };
+
+    conv.s32Planar(planar, 2, f, 3, 4.0f);
+
+    BOOST_CHECK_EQUAL(f[0], 0.25f);
+    BOOST_CHECK_EQUAL(f[1], -0.25f);
+    BOOST_CHECK_EQUAL(f[4], 0.75f);
+    BOOST_CHECK_EQUAL(f[5], -0.75f);
+}
+
+BOOST_AUTO_TEST_CASE(TestSampleConverterVectorized)
+{
+    SampleConverter scalar(SampleConverter::SCALAR);
+
+    std::vector<int8_t> s8 = createSamples<int8_t>();
+    std::vector<int16_t> s16 = createSamples<int16_t>();
+    std::vector<int32_t> s32 = createSamples<int32_t>();
+    std::vector<int32_t> s32r = createSamples<int32_t>();
+    std::vector<uint8_t> s24(s_count * 3);
+
+    for (size_t i = 0; i < s24.size(); ++i)
+	s24[i] = s32[i / 3] >> (8 * (i % 3));
+
+    const int32_t* planar[] = { &s32[0], &s32r[0] };
+
+    // float samples slightly out of the valid range
+    std::vector<float> f32(s_count);
+    std::vector<float> f32r(s_count);
+
+    for (size_t i = 0; i < s_count; ++i)
+    {
+	f32[i] = s16[i] / 30000.0f;
+	f32r[i] = s8[i] / 120.0f;
+    }
+
+    const float* planarFloat[] = { &f32[0], &f32r[0] };
+
+    std::vector<float> expected(s_count * 2);
+    std::vector<float> result(s_count * 2);
+
+    for (SampleConverter::Implementation impl : s_impls)
+    {
+	if (!SampleConverter::isSupported(impl))
+	    continue;
+
+	SampleConverter conv(impl);
+	BOOST_TEST_MESSAGE("checking " << conv.getName());
+
+	scalar.s8(&s8[0], &expected[0], s_count, 0x7f);
+	conv.s8(&s8[0], &result[0], s_count, 0x7f);
+	BOOST_CHECK(isIdentical(expected, result));
+
+	scalar.s16(&s16[0], &expected[0], s_count, 0x7fff);
+	conv.s16(&s16[0], &result[0], s_count, 0x7fff);
+	BOOST_CHECK(isIdentical(expected, result));
+
+	scalar.s24(&s24[0], &expected[0], s_count, 0x7fffff);
+	conv.s24(&s24[0], &result[0], s_count, 0x7fffff);
+	BOOST_CHECK(isIdentical(expected, result));
+
+	// a scale smaller than the range of the samples makes a lot of them clamped
+	scalar.s32(&s32[0], &expected[0], s_count, 0x7fffff);
+	conv.s32(&s32[0], &result[0], s_count, 0x7fffff);
+	BOOST_CHECK(isIdentical(expected, result));
+
+	scalar.s32(&s32[0], &expected[0], s_count, 0x7fffffff);
+	conv.s32(&s32[0], &result[0], s_count, 0x7fffffff);
+	BOOST_CHECK(isIdentical(expected, result));
+
+	scalar.s32Planar(planar, 2, &expected[0], s_count, 0x7fffffff);
+	conv.s32Planar(planar, 2, &result[0], s_count, 0x7fffffff);
+	BOOST_CHECK(isIdentical(expected, result));
+
+	scalar.f32Planar(planarFloat, 2, &expected[0], s_count);
+	conv.f32Planar(planarFloat, 2, &result[0], s_count);
+	BOOST_CHECK(isIdentical(expected, result));
+    }
+}
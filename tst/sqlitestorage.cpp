@@ -0,0 +1,262 @@
+/**
+ * This file is part of the Zeppelin music player project.
+ * Copyright (c) 2013-2014 Zoltan Kovacs, Lajos Santa
+ * See http://zeppelin-player.com for more details.
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include <library/sqlitestorage.h>
+#include <config/config.h>
+#include <utils/mtime.h>
+
+#include <cstdio>
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+using zeppelin::library::File;
+
+struct StorageFixture
+{
+    StorageFixture()
+    {
+	config::Library config;
+	config.m_database = ":memory:";
+	m_storage.open(config);
+
+	m_dirId = m_storage.ensureDirectory("/music", -1);
+    }
+
+    File createFile(const std::string& name, int64_t size, int64_t mtime)
+    {
+	File file(-1);
+	file.m_directoryId = m_dirId;
+	file.m_path = "/music";
+	file.m_name = name;
+	file.m_size = size;
+	file.m_mtime = mtime;
+	return file;
+    }
+
+    library::SqliteStorage m_storage;
+    int m_dirId;
+};
+
+BOOST_FIXTURE_TEST_CASE(TestStorageDirectoryMtime, StorageFixture)
+{
+    // the directory was not scanned yet
+    BOOST_CHECK_EQUAL(m_storage.getDirectoryMtime(m_dirId), -1);
+
+    m_storage.setDirectoryMtime(m_dirId, 1400000000);
+    BOOST_CHECK_EQUAL(m_storage.getDirectoryMtime(m_dirId), 1400000000);
+
+    // the modification time is kept on rescans
+    BOOST_CHECK_EQUAL(m_storage.ensureDirectory("/music", -1), m_dirId);
+    BOOST_CHECK_EQUAL(m_storage.getDirectoryMtime(m_dirId), 1400000000);
+}
+
+BOOST_FIXTURE_TEST_CASE(TestStorageModifiedFile, StorageFixture)
+{
+    File a = createFile("a.mp3", 1000, 100);
+    File b = createFile("b.mp3", 2000, 200);
+
+    // new files have to be parsed
+    BOOST_CHECK(m_storage.addFile(a));
+    BOOST_CHECK(m_storage.addFile(b));
+    BOOST_CHECK_EQUAL(m_storage.getFilesWithoutMetadata().size(), 2);
+
+    // unchanged file
+    File a2 = createFile("a.mp3", 1000, 100);
+    BOOST_CHECK(!m_storage.addFile(a2));
+    BOOST_CHECK_EQUAL(a2.m_id, a.m_id);
+
+    // the size or the modification time changed
+    File a3 = createFile("a.mp3", 1000, 101);
+    BOOST_CHECK(m_storage.addFile(a3));
+    File b2 = createFile("b.mp3", 2001, 200);
+    BOOST_CHECK(m_storage.addFile(b2));
+    BOOST_CHECK_EQUAL(b2.m_id, b.m_id);
+
+    auto files = m_storage.getFilesOfDirectory(m_dirId);
+    BOOST_REQUIRE_EQUAL(files.size(), 2);
+
+    for (const auto& f : files)
+    {
+	if (f->m_name == "a.mp3")
+	{
+	    BOOST_CHECK_EQUAL(f->m_size, 1000);
+	    BOOST_CHECK_EQUAL(f->m_mtime, 101);
+	}
+	else
+	{
+	    BOOST_CHECK_EQUAL(f->m_size, 2001);
+	    BOOST_CHECK_EQUAL(f->m_mtime, 200);
+	}
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(TestStorageMarkFilesOfDirectory, StorageFixture)
+{
+    File a = createFile("a.mp3", 1000, 100);
+    File b = createFile("b.mp3", 2000, 200);
+    m_storage.addFile(a);
+    m_storage.addFile(b);
+
+    int otherId = m_storage.ensureDirectory("/other", -1);
+    File c = createFile("c.mp3", 3000, 300);
+    c.m_directoryId = otherId;
+    c.m_path = "/other";
+    m_storage.addFile(c);
+
+    // the files of the first directory are kept by a rescan without touching them one by one
+    m_storage.clearMark();
+    m_storage.ensureDirectory("/music", -1);
+    m_storage.markFilesOfDirectory(m_dirId);
+    m_storage.deleteNonMarked();
+
+    BOOST_CHECK_EQUAL(m_storage.getFilesOfDirectory(m_dirId).size(), 2);
+    BOOST_CHECK_EQUAL(m_storage.getFiles({}).size(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(TestStorageBatch)
+{
+    // two connections to the same database are needed to see the commits
+    char path[] = "/tmp/zeppelin_storage_XXXXXX";
+    int fd = mkstemp(path);
+    BOOST_REQUIRE(fd >= 0);
+    close(fd);
+
+    {
+	config::Library config;
+	config.m_database = path;
+
+	library::SqliteStorage writer;
+	writer.open(config);
+	library::SqliteStorage reader;
+	reader.open(config);
+
+	int dirId = writer.ensureDirectory("/music", -1);
+
+	writer.beginBatch();
+
+	File file(-1);
+	file.m_directoryId = dirId;
+	file.m_path = "/music";
+	file.m_name = "a.mp3";
+	BOOST_CHECK(writer.addFile(file));
+
+	// the pending writes are visible on the same connection only
+	BOOST_CHECK_EQUAL(writer.getFilesOfDirectory(dirId).size(), 1);
+	BOOST_CHECK_EQUAL(reader.getFilesOfDirectory(dirId).size(), 0);
+
+	// nested batches are committed at the end of the last one
+	writer.beginBatch();
+	writer.endBatch();
+	BOOST_CHECK_EQUAL(reader.getFilesOfDirectory(dirId).size(), 0);
+
+	writer.endBatch();
+	BOOST_CHECK_EQUAL(reader.getFilesOfDirectory(dirId).size(), 1);
+
+	// writes outside of the batches are committed right away even if a batch is in progress
+	writer.beginBatch();
+
+	File other(-1);
+	other.m_directoryId = dirId;
+	other.m_path = "/music";
+	other.m_name = "b.mp3";
+	BOOST_CHECK(writer.addFile(other));
+
+	int playlistId = writer.createPlaylist("playlist");
+	BOOST_CHECK_EQUAL(reader.getPlaylists({playlistId}).size(), 1);
+	BOOST_CHECK_EQUAL(reader.getFilesOfDirectory(dirId).size(), 2);
+
+	writer.endBatch();
+    }
+
+    unlink(path);
+}
+
+BOOST_AUTO_TEST_CASE(TestStorageLazyAlbumPicture)
+{
+    using zeppelin::library::Metadata;
+    using zeppelin::library::Picture;
+
+    char dir[] = "/tmp/zeppelin-storage-XXXXXX";
+    BOOST_REQUIRE(mkdtemp(dir));
+
+    std::string pictureDir = std::string(dir) + "/pictures";
+
+    config::Library config;
+    config.m_database = ":memory:";
+    config.m_pictureDirectory = pictureDir;
+
+    library::SqliteStorage storage;
+    storage.open(config);
+
+    // a media file with the picture at offset 4
+    std::string path = std::string(dir) + "/a.flac";
+    FILE* f = fopen(path.c_str(), "wb");
+    BOOST_REQUIRE(f);
+    fputs("fLaCPICTURE", f);
+    fclose(f);
+
+    struct stat st;
+    BOOST_REQUIRE(stat(path.c_str(), &st) == 0);
+
+    int dirId = storage.ensureDirectory(dir, -1);
+
+    // two albums with the same picture
+    for (const char* album : { "Album1", "Album2" })
+    {
+	File file(-1);
+	file.m_directoryId = dirId;
+	file.m_path = dir;
+	file.m_name = std::string(album) + ".flac";
+	file.m_size = st.st_size;
+	file.m_mtime = utils::getMtime(st);
+	BOOST_REQUIRE(storage.addFile(file));
+	BOOST_REQUIRE(link(path.c_str(), (file.m_path + "/" + file.m_name).c_str()) == 0);
+
+	file.m_metadata.reset(new Metadata("flac"));
+	file.m_metadata->setArtist("Artist");
+	file.m_metadata->setAlbum(album);
+	file.m_metadata->addPicture(Picture::FrontCover, std::make_shared<Picture>("image/jpeg", int64_t(4), 7));
+	storage.setFileMetadata(file);
+    }
+
+    std::vector<int> ids;
+
+    for (const auto& album : storage.getAlbums({}))
+	ids.push_back(album->m_id);
+
+    BOOST_REQUIRE_EQUAL(ids.size(), 2);
+
+    // the data is loaded from the media files at the first request
+    auto pictures = storage.getPicturesOfAlbums(ids);
+    BOOST_REQUIRE_EQUAL(pictures[ids[0]].size(), 1);
+    BOOST_REQUIRE_EQUAL(pictures[ids[1]].size(), 1);
+
+    std::shared_ptr<Picture> picture = pictures[ids[0]][Picture::FrontCover];
+    BOOST_CHECK_EQUAL(picture->getMimeType(), "image/jpeg");
+    BOOST_REQUIRE(picture->getView());
+    BOOST_CHECK_EQUAL(std::string(picture->getView(), picture->getView() + picture->getSize()), "PICTURE");
+    BOOST_CHECK_EQUAL(std::string(picture->getData().begin(), picture->getData().end()), "PICTURE");
+
+    // the albums share the file of the picture store
+    BOOST_CHECK_EQUAL(picture->getPath().compare(0, pictureDir.size(), pictureDir), 0);
+    BOOST_CHECK_EQUAL(pictures[ids[1]][Picture::FrontCover]->getPath(), picture->getPath());
+
+    // the following requests do not need the media files
+    for (const char* file : { "/a.flac", "/Album1.flac", "/Album2.flac" })
+	unlink((std::string(dir) + file).c_str());
+
+    pictures = storage.getPicturesOfAlbums(ids);
+    BOOST_REQUIRE_EQUAL(pictures[ids[0]].size(), 1);
+    BOOST_CHECK_EQUAL(pictures[ids[0]][Picture::FrontCover]->getSize(), 7u);
+
+    unlink(picture->getPath().c_str());
+    rmdir(pictureDir.c_str());
+    rmdir(dir);
+}
@@ -0,0 +1,365 @@
+/**
+ * This file is part of the Zeppelin music player project.
+ * Copyright (c) 2013-2014 Zoltan Kovacs, Lajos Santa
+ * See http://zeppelin-player.com for more details.
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include <library/tagreader.h>
+
+#include <vector>
+#include <string>
+#include <cstring>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+using library::TagReader;
+using zeppelin::library::Picture;
+
+typedef std::vector<uint8_t> Data;
+
+struct TagReaderFixture
+{
+    ~TagReaderFixture()
+    {
+	for (const auto& f : m_files)
+	    unlink(f.c_str());
+    }
+
+    std::string createFile(const std::string& extension, const Data& data)
+    {
+	char name[] = "/tmp/zeppelin-tagreader-XXXXXX";
+	int fd = mkstemp(name);
+	BOOST_REQUIRE(fd >= 0);
+	BOOST_REQUIRE(write(fd, &data[0], data.size()) == static_cast<ssize_t>(data.size()));
+	close(fd);
+
+	std::string file = std::string(name) + "." + extension;
+	BOOST_REQUIRE(rename(name, file.c_str()) == 0);
+	m_files.push_back(file);
+
+	return file;
+    }
+
+    std::vector<std::string> m_files;
+};
+
+static void append(Data& data, const std::string& s)
+{
+    data.insert(data.end(), s.begin(), s.end());
+}
+
+static void appendBE(Data& data, uint32_t value, int bytes)
+{
+    for (int i = bytes - 1; i >= 0; --i)
+	data.push_back(value >> (i * 8));
+}
+
+static void appendLE32(Data& data, uint32_t value)
+{
+    for (int i = 0; i < 4; ++i)
+	data.push_back(value >> (i * 8));
+}
+
+// MPEG 1 layer III, 44100 Hz, stereo, 128 kbit/s frames
+static void appendFrames(Data& data, int count)
+{
+    for (int i = 0; i < count; ++i)
+    {
+	size_t offset = data.size();
+	data.resize(offset + 417);
+	data[offset] = 0xff;
+	data[offset + 1] = 0xfb;
+	data[offset + 2] = 0x90;
+    }
+}
+
+static void appendID3v2Frame(Data& data, const std::string& id, const Data& frame)
+{
+    append(data, id);
+    appendBE(data, frame.size(), 4);
+    appendBE(data, 0, 2);
+    data.insert(data.end(), frame.begin(), frame.end());
+}
+
+static Data textFrame(const std::string& text)
+{
+    Data frame(1, 0);
+    append(frame, text);
+    return frame;
+}
+
+static void appendID3v1(Data& data, const std::string& title, const std::string& album, const std::string& year)
+{
+    size_t offset = data.size();
+    data.resize(offset + 128);
+    memcpy(&data[offset], "TAG", 3);
+    memcpy(&data[offset + 3], title.data(), title.size());
+    memcpy(&data[offset + 63], album.data(), album.size());
+    memcpy(&data[offset + 93], year.data(), year.size());
+}
+
+static void appendApeItem(Data& data, const std::string& key, const std::string& value, uint32_t flags = 0)
+{
+    appendLE32(data, value.size());
+    appendLE32(data, flags);
+    append(data, key);
+    data.push_back(0);
+    append(data, value);
+}
+
+// wraps the data into an Ogg page
+static void appendOggPage(Data& data, const Data& packet, int64_t granule)
+{
+    append(data, "OggS");
+    data.push_back(0);
+    data.push_back(0);
+    appendLE32(data, granule);
+    appendLE32(data, granule >> 32);
+    appendLE32(data, 0x1234);
+    appendLE32(data, 0);
+    appendLE32(data, 0);
+
+    // lacing values, the checksum is not verified by the reader
+    data.push_back(packet.size() / 255 + 1);
+
+    for (size_t i = 0; i < packet.size() / 255; ++i)
+	data.push_back(255);
+
+    data.push_back(packet.size() % 255);
+    data.insert(data.end(), packet.begin(), packet.end());
+}
+
+BOOST_FIXTURE_TEST_CASE(TestTagReaderMp3, TagReaderFixture)
+{
+    Data tag;
+    appendID3v2Frame(tag, "TIT2", textFrame("Title"));
+    appendID3v2Frame(tag, "TALB", textFrame("Album"));
+    appendID3v2Frame(tag, "TYER", textFrame("2014"));
+    appendID3v2Frame(tag, "TRCK", textFrame("3/12"));
+
+    // UTF-16 text with byte order mark
+    Data artist = { 1, 0xff, 0xfe, 'A', 0, 'r', 0, 't', 0, 0xe9, 0, 0, 0 };
+    appendID3v2Frame(tag, "TPE1", artist);
+
+    Data apic = { 0 };
+    append(apic, "image/png");
+    apic.push_back(0);
+    apic.push_back(3);
+    append(apic, "cover");
+    apic.push_back(0);
+    append(apic, "PNGDATA");
+    appendID3v2Frame(tag, "APIC", apic);
+
+    Data data;
+    append(data, "ID3");
+    data.push_back(3);
+    data.push_back(0);
+    data.push_back(0);
+    // syncsafe size
+    appendBE(data, tag.size(), 4);
+    data.insert(data.end(), tag.begin(), tag.end());
+
+    appendFrames(data, 100);
+    // the title is taken from the ID3v2 tag, the missing fields are filled from ID3v1
+    appendID3v1(data, "Other", "", "1999");
+
+    BOOST_REQUIRE(tag.size() < 128);
+
+    auto metadata = TagReader(createFile("mp3", data)).read();
+
+    BOOST_REQUIRE(metadata);
+    BOOST_CHECK_EQUAL(metadata->getCodec(), "mp3");
+    BOOST_CHECK_EQUAL(metadata->getTitle(), "Title");
+    BOOST_CHECK_EQUAL(metadata->getArtist(), "Art\xc3\xa9");
+    BOOST_CHECK_EQUAL(metadata->getAlbum(), "Album");
+    BOOST_CHECK_EQUAL(metadata->getYear(), 2014);
+    BOOST_CHECK_EQUAL(metadata->getTrackIndex(), 3);
+    BOOST_CHECK_EQUAL(metadata->getChannels(), 2);
+    BOOST_CHECK_EQUAL(metadata->getSampleRate(), 44100);
+
+    // 100 frames of 417 bytes at 128 kbit/s
+    BOOST_CHECK_EQUAL(metadata->getLength(), 100 * 417 * 8 / 128000);
+
+    // only the location of the picture is stored
+    auto it = metadata->getPictures().find(Picture::FrontCover);
+    BOOST_REQUIRE(it != metadata->getPictures().end());
+    BOOST_CHECK_EQUAL(it->second->getMimeType(), "image/png");
+    BOOST_CHECK(!it->second->isLoaded());
+    BOOST_CHECK_EQUAL(it->second->getOffset(), 10 + tag.size() - 7);
+    BOOST_CHECK_EQUAL(it->second->getSize(), 7u);
+
+    // the data of unsynchronised tags is not contiguous in the file, it is copied
+    data[5] = 0x80;
+    metadata = TagReader(createFile("mp3", data)).read();
+
+    BOOST_REQUIRE(metadata);
+    it = metadata->getPictures().find(Picture::FrontCover);
+    BOOST_REQUIRE(it != metadata->getPictures().end());
+    BOOST_CHECK(it->second->isLoaded());
+    BOOST_CHECK_EQUAL(std::string(it->second->getData().begin(), it->second->getData().end()), "PNGDATA");
+}
+
+BOOST_FIXTURE_TEST_CASE(TestTagReaderApe, TagReaderFixture)
+{
+    Data items;
+    appendApeItem(items, "Artist", "Artist");
+    appendApeItem(items, "TITLE", "Title");
+    appendApeItem(items, "Cover Art (Back)", std::string("back.jpg\0\xff\xd8\xff\xe0", 13), 0x2);
+
+    Data data;
+    appendFrames(data, 10);
+    data.insert(data.end(), items.begin(), items.end());
+
+    // footer
+    append(data, "APETAGEX");
+    appendLE32(data, 2000);
+    appendLE32(data, items.size() + 32);
+    appendLE32(data, 3);
+    appendLE32(data, 0);
+    data.resize(data.size() + 8);
+
+    appendID3v1(data, "Other", "Album", "");
+
+    auto metadata = TagReader(createFile("mp3", data)).read();
+
+    BOOST_REQUIRE(metadata);
+    BOOST_CHECK_EQUAL(metadata->getArtist(), "Artist");
+    BOOST_CHECK_EQUAL(metadata->getTitle(), "Title");
+    BOOST_CHECK_EQUAL(metadata->getAlbum(), "Album");
+
+    auto it = metadata->getPictures().find(Picture::BackCover);
+    BOOST_REQUIRE(it != metadata->getPictures().end());
+    BOOST_CHECK_EQUAL(it->second->getMimeType(), "image/jpeg");
+    BOOST_CHECK_EQUAL(it->second->getSize(), 4u);
+
+    // the tags are merged into the metadata of the codecs without overwriting the existing fields
+    zeppelin::library::Metadata wv("wv");
+    wv.setTitle("Codec");
+
+    TagReader(createFile("wv", data)).readTags(wv);
+
+    BOOST_CHECK_EQUAL(wv.getTitle(), "Codec");
+    BOOST_CHECK_EQUAL(wv.getArtist(), "Artist");
+}
+
+BOOST_FIXTURE_TEST_CASE(TestTagReaderFlac, TagReaderFixture)
+{
+    Data data;
+    append(data, "fLaC");
+
+    // STREAMINFO: 44100 Hz, 2 channels, 24 bits, 10 seconds
+    data.push_back(0);
+    appendBE(data, 34, 3);
+    data.resize(data.size() + 10);
+    appendBE(data, (44100 << 12) | (1 << 9) | (23 << 4), 4);
+    appendBE(data, 441000, 4);
+    data.resize(data.size() + 16);
+
+    Data comment;
+    appendLE32(comment, 6);
+    append(comment, "vendor");
+    appendLE32(comment, 2);
+    appendLE32(comment, 12);
+    append(comment, "ARTIST=Flac");
+    comment.push_back('!');
+    appendLE32(comment, 13);
+    append(comment, "TRACKNUMBER=7");
+
+    data.push_back(4);
+    appendBE(data, comment.size(), 3);
+    data.insert(data.end(), comment.begin(), comment.end());
+
+    Data picture;
+    appendBE(picture, 3, 4);
+    appendBE(picture, 10, 4);
+    append(picture, "image/jpeg");
+    appendBE(picture, 0, 4);
+    picture.resize(picture.size() + 16);
+    appendBE(picture, 3, 4);
+    append(picture, "JPG");
+
+    // last metadata block
+    data.push_back(0x80 | 6);
+    appendBE(data, picture.size(), 3);
+    data.insert(data.end(), picture.begin(), picture.end());
+
+    auto metadata = TagReader(createFile("flac", data)).read();
+
+    BOOST_REQUIRE(metadata);
+    BOOST_CHECK_EQUAL(metadata->getCodec(), "flac");
+    BOOST_CHECK_EQUAL(metadata->getSampleRate(), 44100);
+    BOOST_CHECK_EQUAL(metadata->getChannels(), 2);
+    BOOST_CHECK_EQUAL(metadata->getSampleSize(), 24);
+    BOOST_CHECK_EQUAL(metadata->getLength(), 10);
+    BOOST_CHECK_EQUAL(metadata->getArtist(), "Flac!");
+    BOOST_CHECK_EQUAL(metadata->getTrackIndex(), 7);
+
+    auto it = metadata->getPictures().find(Picture::FrontCover);
+    BOOST_REQUIRE(it != metadata->getPictures().end());
+    BOOST_CHECK_EQUAL(it->second->getMimeType(), "image/jpeg");
+    BOOST_CHECK_EQUAL(it->second->getOffset(), static_cast<int64_t>(data.size() - 3));
+    BOOST_CHECK_EQUAL(it->second->getSize(), 3u);
+
+    // truncated file
+    data.resize(40);
+    BOOST_CHECK(!TagReader(createFile("flac", data)).read());
+}
+
+BOOST_FIXTURE_TEST_CASE(TestTagReaderOgg, TagReaderFixture)
+{
+    Data id;
+    append(id, "\x01vorbis");
+    appendLE32(id, 0);
+    id.push_back(1);
+    appendLE32(id, 48000);
+    id.resize(30);
+
+    Data comment;
+    append(comment, "\x03vorbis");
+    appendLE32(comment, 0);
+    appendLE32(comment, 2);
+
+    // the comment packet is longer than a segment
+    std::string title = "TITLE=" + std::string(300, 'x');
+    appendLE32(comment, title.size());
+    append(comment, title);
+    appendLE32(comment, 12);
+    append(comment, "ALBUM=Vorbis");
+
+    Data data;
+    appendOggPage(data, id, 0);
+    appendOggPage(data, comment, 0);
+    appendOggPage(data, Data(1000), 48000 * 65);
+
+    auto metadata = TagReader(createFile("ogg", data)).read();
+
+    BOOST_REQUIRE(metadata);
+    BOOST_CHECK_EQUAL(metadata->getCodec(), "ogg");
+    BOOST_CHECK_EQUAL(metadata->getSampleRate(), 48000);
+    BOOST_CHECK_EQUAL(metadata->getChannels(), 1);
+    BOOST_CHECK_EQUAL(metadata->getLength(), 65);
+    BOOST_CHECK_EQUAL(metadata->getTitle(), std::string(300, 'x'));
+    BOOST_CHECK_EQUAL(metadata->getAlbum(), "Vorbis");
+
+    // the extension is matched case insensitively like by the codecs
+    metadata = TagReader(createFile("OGG", data)).read();
+
+    BOOST_REQUIRE(metadata);
+    BOOST_CHECK_EQUAL(metadata->getCodec(), "ogg");
+}
+
+BOOST_FIXTURE_TEST_CASE(TestTagReaderUnsupported, TagReaderFixture)
+{
+    Data data;
+    appendFrames(data, 10);
+
+    // the other formats are left to their codecs
+    BOOST_CHECK(!TagReader(createFile("wv", data)).read());
+
+    // MP3 files without a VBR header and with frames of different bitrates have to be scanned by the decoder
+    data[5 * 417 + 2] = 0xb0;
+    BOOST_CHECK(!TagReader(createFile("mp3", data)).read());
+}